@@ -117,8 +117,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // getAlignedTimesCpp
-NumericMatrix getAlignedTimesCpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, int polyOrd, std::string alignType, double adaptiveRT, std::string normalization, std::string simType, const std::vector<double>& Bp, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, bool hardConstrain, double samples4gradient);
-RcppExport SEXP _DIAlignR_getAlignedTimesCpp(SEXP l1SEXP, SEXP l2SEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP alignTypeSEXP, SEXP adaptiveRTSEXP, SEXP normalizationSEXP, SEXP simTypeSEXP, SEXP BpSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP hardConstrainSEXP, SEXP samples4gradientSEXP) {
+NumericMatrix getAlignedTimesCpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, int polyOrd, std::string alignType, double adaptiveRT, std::string normalization, std::string simType, const std::vector<double>& Bp, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, bool hardConstrain, double samples4gradient, int bandWidth, int coarseFactor, double anchorQuantile, bool approxQuantile);
+RcppExport SEXP _DIAlignR_getAlignedTimesCpp(SEXP l1SEXP, SEXP l2SEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP alignTypeSEXP, SEXP adaptiveRTSEXP, SEXP normalizationSEXP, SEXP simTypeSEXP, SEXP BpSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP hardConstrainSEXP, SEXP samples4gradientSEXP, SEXP bandWidthSEXP, SEXP coarseFactorSEXP, SEXP anchorQuantileSEXP, SEXP approxQuantileSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -140,7 +140,151 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< int >::type kerLen(kerLenSEXP);
     Rcpp::traits::input_parameter< bool >::type hardConstrain(hardConstrainSEXP);
     Rcpp::traits::input_parameter< double >::type samples4gradient(samples4gradientSEXP);
-    rcpp_result_gen = Rcpp::wrap(getAlignedTimesCpp(l1, l2, kernelLen, polyOrd, alignType, adaptiveRT, normalization, simType, Bp, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient));
+    Rcpp::traits::input_parameter< int >::type bandWidth(bandWidthSEXP);
+    Rcpp::traits::input_parameter< int >::type coarseFactor(coarseFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type anchorQuantile(anchorQuantileSEXP);
+    Rcpp::traits::input_parameter< bool >::type approxQuantile(approxQuantileSEXP);
+    rcpp_result_gen = Rcpp::wrap(getAlignedTimesCpp(l1, l2, kernelLen, polyOrd, alignType, adaptiveRT, normalization, simType, Bp, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor, anchorQuantile, approxQuantile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// prepareXICGroupCpp
+SEXP prepareXICGroupCpp(Rcpp::List l1, int kernelLen, int polyOrd, std::string normalization);
+RcppExport SEXP _DIAlignR_prepareXICGroupCpp(SEXP l1SEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP normalizationSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type l1(l1SEXP);
+    Rcpp::traits::input_parameter< int >::type kernelLen(kernelLenSEXP);
+    Rcpp::traits::input_parameter< int >::type polyOrd(polyOrdSEXP);
+    Rcpp::traits::input_parameter< std::string >::type normalization(normalizationSEXP);
+    rcpp_result_gen = Rcpp::wrap(prepareXICGroupCpp(l1, kernelLen, polyOrd, normalization));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getAlignedTimesPreparedCpp
+NumericMatrix getAlignedTimesPreparedCpp(SEXP ref, Rcpp::List l2, int kernelLen, int polyOrd, std::string alignType, double adaptiveRT, std::string simType, const std::vector<double>& Bp, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, bool hardConstrain, double samples4gradient, int bandWidth, int coarseFactor, double anchorQuantile, bool approxQuantile);
+RcppExport SEXP _DIAlignR_getAlignedTimesPreparedCpp(SEXP refSEXP, SEXP l2SEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP alignTypeSEXP, SEXP adaptiveRTSEXP, SEXP simTypeSEXP, SEXP BpSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP hardConstrainSEXP, SEXP samples4gradientSEXP, SEXP bandWidthSEXP, SEXP coarseFactorSEXP, SEXP anchorQuantileSEXP, SEXP approxQuantileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type ref(refSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type l2(l2SEXP);
+    Rcpp::traits::input_parameter< int >::type kernelLen(kernelLenSEXP);
+    Rcpp::traits::input_parameter< int >::type polyOrd(polyOrdSEXP);
+    Rcpp::traits::input_parameter< std::string >::type alignType(alignTypeSEXP);
+    Rcpp::traits::input_parameter< double >::type adaptiveRT(adaptiveRTSEXP);
+    Rcpp::traits::input_parameter< std::string >::type simType(simTypeSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type Bp(BpSEXP);
+    Rcpp::traits::input_parameter< double >::type goFactor(goFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type geFactor(geFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type cosAngleThresh(cosAngleThreshSEXP);
+    Rcpp::traits::input_parameter< bool >::type OverlapAlignment(OverlapAlignmentSEXP);
+    Rcpp::traits::input_parameter< double >::type dotProdThresh(dotProdThreshSEXP);
+    Rcpp::traits::input_parameter< double >::type gapQuantile(gapQuantileSEXP);
+    Rcpp::traits::input_parameter< int >::type kerLen(kerLenSEXP);
+    Rcpp::traits::input_parameter< bool >::type hardConstrain(hardConstrainSEXP);
+    Rcpp::traits::input_parameter< double >::type samples4gradient(samples4gradientSEXP);
+    Rcpp::traits::input_parameter< int >::type bandWidth(bandWidthSEXP);
+    Rcpp::traits::input_parameter< int >::type coarseFactor(coarseFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type anchorQuantile(anchorQuantileSEXP);
+    Rcpp::traits::input_parameter< bool >::type approxQuantile(approxQuantileSEXP);
+    rcpp_result_gen = Rcpp::wrap(getAlignedTimesPreparedCpp(ref, l2, kernelLen, polyOrd, alignType, adaptiveRT, simType, Bp, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor, anchorQuantile, approxQuantile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// prepareGlobalFitCpp
+SEXP prepareGlobalFitCpp(std::string fitType, const std::vector<double>& x, const std::vector<double>& y);
+RcppExport SEXP _DIAlignR_prepareGlobalFitCpp(SEXP fitTypeSEXP, SEXP xSEXP, SEXP ySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type fitType(fitTypeSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type x(xSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type y(ySEXP);
+    rcpp_result_gen = Rcpp::wrap(prepareGlobalFitCpp(fitType, x, y));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getMappedTimesCpp
+NumericVector getMappedTimesCpp(SEXP fit, const std::vector<double>& tRef, const std::vector<double>& tExp);
+RcppExport SEXP _DIAlignR_getMappedTimesCpp(SEXP fitSEXP, SEXP tRefSEXP, SEXP tExpSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type fit(fitSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type tRef(tRefSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type tExp(tExpSEXP);
+    rcpp_result_gen = Rcpp::wrap(getMappedTimesCpp(fit, tRef, tExp));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getLOESSfitsCpp
+List getLOESSfitsCpp(Rcpp::List RTrefs, Rcpp::List RTeXps, double spanvalue, int threads);
+RcppExport SEXP _DIAlignR_getLOESSfitsCpp(SEXP RTrefsSEXP, SEXP RTeXpsSEXP, SEXP spanvalueSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type RTrefs(RTrefsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type RTeXps(RTeXpsSEXP);
+    Rcpp::traits::input_parameter< double >::type spanvalue(spanvalueSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(getLOESSfitsCpp(RTrefs, RTeXps, spanvalue, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getAlignedTimesBatchCpp
+List getAlignedTimesBatchCpp(SEXP ref, Rcpp::List l2s, int kernelLen, int polyOrd, const std::vector<std::string>& alignTypes, const std::vector<double>& adaptiveRTs, std::string simType, Rcpp::List Bps, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, bool hardConstrain, double samples4gradient, int bandWidth, int coarseFactor, double anchorQuantile, int threads, bool approxQuantile);
+RcppExport SEXP _DIAlignR_getAlignedTimesBatchCpp(SEXP refSEXP, SEXP l2sSEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP alignTypesSEXP, SEXP adaptiveRTsSEXP, SEXP simTypeSEXP, SEXP BpsSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP hardConstrainSEXP, SEXP samples4gradientSEXP, SEXP bandWidthSEXP, SEXP coarseFactorSEXP, SEXP anchorQuantileSEXP, SEXP threadsSEXP, SEXP approxQuantileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type ref(refSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type l2s(l2sSEXP);
+    Rcpp::traits::input_parameter< int >::type kernelLen(kernelLenSEXP);
+    Rcpp::traits::input_parameter< int >::type polyOrd(polyOrdSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type alignTypes(alignTypesSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type adaptiveRTs(adaptiveRTsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type simType(simTypeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type Bps(BpsSEXP);
+    Rcpp::traits::input_parameter< double >::type goFactor(goFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type geFactor(geFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type cosAngleThresh(cosAngleThreshSEXP);
+    Rcpp::traits::input_parameter< bool >::type OverlapAlignment(OverlapAlignmentSEXP);
+    Rcpp::traits::input_parameter< double >::type dotProdThresh(dotProdThreshSEXP);
+    Rcpp::traits::input_parameter< double >::type gapQuantile(gapQuantileSEXP);
+    Rcpp::traits::input_parameter< int >::type kerLen(kerLenSEXP);
+    Rcpp::traits::input_parameter< bool >::type hardConstrain(hardConstrainSEXP);
+    Rcpp::traits::input_parameter< double >::type samples4gradient(samples4gradientSEXP);
+    Rcpp::traits::input_parameter< int >::type bandWidth(bandWidthSEXP);
+    Rcpp::traits::input_parameter< int >::type coarseFactor(coarseFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type anchorQuantile(anchorQuantileSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type approxQuantile(approxQuantileSEXP);
+    rcpp_result_gen = Rcpp::wrap(getAlignedTimesBatchCpp(ref, l2s, kernelLen, polyOrd, alignTypes, adaptiveRTs, simType, Bps, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor, anchorQuantile, threads, approxQuantile));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getRunDistancesCpp
+NumericMatrix getRunDistancesCpp(Rcpp::List XICs, int kernelLen, int polyOrd, std::string normalization, std::string simType, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, int threads);
+RcppExport SEXP _DIAlignR_getRunDistancesCpp(SEXP XICsSEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP normalizationSEXP, SEXP simTypeSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type XICs(XICsSEXP);
+    Rcpp::traits::input_parameter< int >::type kernelLen(kernelLenSEXP);
+    Rcpp::traits::input_parameter< int >::type polyOrd(polyOrdSEXP);
+    Rcpp::traits::input_parameter< std::string >::type normalization(normalizationSEXP);
+    Rcpp::traits::input_parameter< std::string >::type simType(simTypeSEXP);
+    Rcpp::traits::input_parameter< double >::type goFactor(goFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type geFactor(geFactorSEXP);
+    Rcpp::traits::input_parameter< double >::type cosAngleThresh(cosAngleThreshSEXP);
+    Rcpp::traits::input_parameter< bool >::type OverlapAlignment(OverlapAlignmentSEXP);
+    Rcpp::traits::input_parameter< double >::type dotProdThresh(dotProdThreshSEXP);
+    Rcpp::traits::input_parameter< double >::type gapQuantile(gapQuantileSEXP);
+    Rcpp::traits::input_parameter< int >::type kerLen(kerLenSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(getRunDistancesCpp(XICs, kernelLen, polyOrd, normalization, simType, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, threads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -174,6 +318,18 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// getAffineAlignObjSlotCpp
+SEXP getAffineAlignObjSlotCpp(SEXP ptr, std::string name);
+RcppExport SEXP _DIAlignR_getAffineAlignObjSlotCpp(SEXP ptrSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type ptr(ptrSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    rcpp_result_gen = Rcpp::wrap(getAffineAlignObjSlotCpp(ptr, name));
+    return rcpp_result_gen;
+END_RCPP
+}
 // doAlignmentCpp
 S4 doAlignmentCpp(NumericMatrix sim, double gap, bool OverlapAlignment);
 RcppExport SEXP _DIAlignR_doAlignmentCpp(SEXP simSEXP, SEXP gapSEXP, SEXP OverlapAlignmentSEXP) {
@@ -201,6 +357,16 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// clearAlignmentPoolCpp
+double clearAlignmentPoolCpp();
+RcppExport SEXP _DIAlignR_clearAlignmentPoolCpp() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(clearAlignmentPoolCpp());
+    return rcpp_result_gen;
+END_RCPP
+}
 // splineFillCpp
 NumericVector splineFillCpp(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& xout);
 RcppExport SEXP _DIAlignR_splineFillCpp(SEXP xSEXP, SEXP ySEXP, SEXP xoutSEXP) {
@@ -215,8 +381,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // getChildXICpp
-List getChildXICpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, int polyOrd, std::string alignType, double adaptiveRT, std::string normalization, std::string simType, const std::vector<double>& Bp, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, bool hardConstrain, double samples4gradient, double wRef, std::string splineMethod, std::string mergeStrategy, bool keepFlanks);
-RcppExport SEXP _DIAlignR_getChildXICpp(SEXP l1SEXP, SEXP l2SEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP alignTypeSEXP, SEXP adaptiveRTSEXP, SEXP normalizationSEXP, SEXP simTypeSEXP, SEXP BpSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP hardConstrainSEXP, SEXP samples4gradientSEXP, SEXP wRefSEXP, SEXP splineMethodSEXP, SEXP mergeStrategySEXP, SEXP keepFlanksSEXP) {
+List getChildXICpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, int polyOrd, std::string alignType, double adaptiveRT, std::string normalization, std::string simType, const std::vector<double>& Bp, double goFactor, double geFactor, double cosAngleThresh, bool OverlapAlignment, double dotProdThresh, double gapQuantile, int kerLen, bool hardConstrain, double samples4gradient, double wRef, std::string splineMethod, std::string mergeStrategy, bool keepFlanks, int bandWidth);
+RcppExport SEXP _DIAlignR_getChildXICpp(SEXP l1SEXP, SEXP l2SEXP, SEXP kernelLenSEXP, SEXP polyOrdSEXP, SEXP alignTypeSEXP, SEXP adaptiveRTSEXP, SEXP normalizationSEXP, SEXP simTypeSEXP, SEXP BpSEXP, SEXP goFactorSEXP, SEXP geFactorSEXP, SEXP cosAngleThreshSEXP, SEXP OverlapAlignmentSEXP, SEXP dotProdThreshSEXP, SEXP gapQuantileSEXP, SEXP kerLenSEXP, SEXP hardConstrainSEXP, SEXP samples4gradientSEXP, SEXP wRefSEXP, SEXP splineMethodSEXP, SEXP mergeStrategySEXP, SEXP keepFlanksSEXP, SEXP bandWidthSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -242,7 +408,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< std::string >::type splineMethod(splineMethodSEXP);
     Rcpp::traits::input_parameter< std::string >::type mergeStrategy(mergeStrategySEXP);
     Rcpp::traits::input_parameter< bool >::type keepFlanks(keepFlanksSEXP);
-    rcpp_result_gen = Rcpp::wrap(getChildXICpp(l1, l2, kernelLen, polyOrd, alignType, adaptiveRT, normalization, simType, Bp, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, wRef, splineMethod, mergeStrategy, keepFlanks));
+    Rcpp::traits::input_parameter< int >::type bandWidth(bandWidthSEXP);
+    rcpp_result_gen = Rcpp::wrap(getChildXICpp(l1, l2, kernelLen, polyOrd, alignType, adaptiveRT, normalization, simType, Bp, goFactor, geFactor, cosAngleThresh, OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, wRef, splineMethod, mergeStrategy, keepFlanks, bandWidth));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -273,12 +440,21 @@ static const R_CallMethodDef CallEntries[] = {
     {"_DIAlignR_getBaseGapPenaltyCpp", (DL_FUNC) &_DIAlignR_getBaseGapPenaltyCpp, 3},
     {"_DIAlignR_areaIntegrator", (DL_FUNC) &_DIAlignR_areaIntegrator, 10},
     {"_DIAlignR_sgolayCpp", (DL_FUNC) &_DIAlignR_sgolayCpp, 3},
-    {"_DIAlignR_getAlignedTimesCpp", (DL_FUNC) &_DIAlignR_getAlignedTimesCpp, 18},
+    {"_DIAlignR_getAlignedTimesCpp", (DL_FUNC) &_DIAlignR_getAlignedTimesCpp, 22},
+    {"_DIAlignR_prepareXICGroupCpp", (DL_FUNC) &_DIAlignR_prepareXICGroupCpp, 4},
+    {"_DIAlignR_getAlignedTimesPreparedCpp", (DL_FUNC) &_DIAlignR_getAlignedTimesPreparedCpp, 21},
+    {"_DIAlignR_prepareGlobalFitCpp", (DL_FUNC) &_DIAlignR_prepareGlobalFitCpp, 3},
+    {"_DIAlignR_getMappedTimesCpp", (DL_FUNC) &_DIAlignR_getMappedTimesCpp, 3},
+    {"_DIAlignR_getLOESSfitsCpp", (DL_FUNC) &_DIAlignR_getLOESSfitsCpp, 4},
+    {"_DIAlignR_getAlignedTimesBatchCpp", (DL_FUNC) &_DIAlignR_getAlignedTimesBatchCpp, 22},
+    {"_DIAlignR_getRunDistancesCpp", (DL_FUNC) &_DIAlignR_getRunDistancesCpp, 13},
     {"_DIAlignR_alignChromatogramsCpp", (DL_FUNC) &_DIAlignR_alignChromatogramsCpp, 20},
+    {"_DIAlignR_getAffineAlignObjSlotCpp", (DL_FUNC) &_DIAlignR_getAffineAlignObjSlotCpp, 2},
     {"_DIAlignR_doAlignmentCpp", (DL_FUNC) &_DIAlignR_doAlignmentCpp, 3},
     {"_DIAlignR_doAffineAlignmentCpp", (DL_FUNC) &_DIAlignR_doAffineAlignmentCpp, 4},
+    {"_DIAlignR_clearAlignmentPoolCpp", (DL_FUNC) &_DIAlignR_clearAlignmentPoolCpp, 0},
     {"_DIAlignR_splineFillCpp", (DL_FUNC) &_DIAlignR_splineFillCpp, 3},
-    {"_DIAlignR_getChildXICpp", (DL_FUNC) &_DIAlignR_getChildXICpp, 22},
+    {"_DIAlignR_getChildXICpp", (DL_FUNC) &_DIAlignR_getChildXICpp, 23},
     {"_DIAlignR_otherChildXICpp", (DL_FUNC) &_DIAlignR_otherChildXICpp, 8},
     {NULL, NULL, 0}
 };
@@ -2,6 +2,7 @@
 #include <cmath>
 #include <math.h>
 #include <algorithm>
+#include <memory>
 #include "simpleFcn.h"
 #include "interface.h"
 #include "chromSimMatrix.h"
@@ -9,6 +10,11 @@
 #include "gapPenalty.h"
 #include "affinealignobj.h"
 #include "affinealignment.h"
+#include "bandedalignment.h"
+#include "fusedalignment.h"
+#include "preparedXICGroup.h"
+#include "batchAlignment.h"
+#include "globalFit.h"
 #include "constrainMat.h"
 #include "integrateArea.h"
 #include "PeakIntegrator.h"
@@ -309,6 +315,93 @@ NumericMatrix sgolayCpp(NumericMatrix chrom, int kernelLen, int polyOrd){
 }
 
 
+namespace {
+  // Smooths chromatograms of the list and prepares them for similarity calculation.
+  PreparedXICGroup* prepareXICGroup(Rcpp::List l, int kernelLen, int polyOrd, NormalizationType normalization){
+    return new PreparedXICGroup(getChromatogramGroup(l, kernelLen, polyOrd), normalization);
+  }
+
+  // Converts aligned times into a two-column matrix. Missing times are NA, others are rounded to two decimals.
+  NumericMatrix alignedTimes2NumericMatrix(const AlignedTimes& aligned){
+    int nrow = aligned.tRef.size();
+    Rcpp::NumericVector A(nrow, NA_REAL);
+    Rcpp::NumericVector B(nrow, NA_REAL);
+    for(int i = 0; i<nrow; i++){
+      A[i] = (aligned.tRef[i] < 0) ? NA_REAL : ::Rf_fround(aligned.tRef[i], 2);
+      B[i] = (aligned.tExp[i] < 0) ? NA_REAL : ::Rf_fround(aligned.tExp[i], 2);
+    }
+    return Rcpp::cbind(A,B);
+  }
+
+  // Collects alignment parameters of getAlignedTimesCpp().
+  XICAlignParams getXICAlignParams(std::string simType, double goFactor, double geFactor,
+                                   double cosAngleThresh, bool OverlapAlignment,
+                                   double dotProdThresh, double gapQuantile, int kerLen,
+                                   bool hardConstrain, double samples4gradient, int bandWidth, int coarseFactor,
+                                   double anchorQuantile, bool approxQuantile){
+    XICAlignParams params;
+    params.simType = getSimilarityType(simType);
+    params.goFactor = goFactor;
+    params.geFactor = geFactor;
+    params.cosAngleThresh = cosAngleThresh;
+    params.OverlapAlignment = OverlapAlignment;
+    params.dotProdThresh = dotProdThresh;
+    params.gapQuantile = gapQuantile;
+    params.kerLen = kerLen;
+    params.hardConstrain = hardConstrain;
+    params.samples4gradient = samples4gradient;
+    params.bandWidth = bandWidth;
+    params.coarseFactor = coarseFactor;
+    params.anchorQuantile = anchorQuantile;
+    params.approxQuantile = approxQuantile;
+    return params;
+  }
+
+  // Aligns two prepared XIC groups and returns aligned times. See getAlignedTimesCpp().
+  NumericMatrix alignPreparedXICGroups(const PreparedXICGroup& g1, const PreparedXICGroup& g2,
+                                       std::string alignType, double adaptiveRT,
+                                       std::string simType, const std::vector<double>& Bp,
+                                       double goFactor, double geFactor,
+                                       double cosAngleThresh, bool OverlapAlignment,
+                                       double dotProdThresh, double gapQuantile, int kerLen,
+                                       bool hardConstrain, double samples4gradient, int bandWidth, int coarseFactor,
+                                       double anchorQuantile, bool approxQuantile){
+    XICAlignParams params = getXICAlignParams(simType, goFactor, geFactor, cosAngleThresh, OverlapAlignment,
+                                              dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor,
+                                              anchorQuantile, approxQuantile);
+    return alignedTimes2NumericMatrix(alignXICGroups(g1, g2, alignType, adaptiveRT, Bp, params));
+  }
+
+  // Alignment of objType = "lazy". It is kept in C++ and its slots are copied to R on first access.
+  struct AffineAlignResult
+  {
+    SimMatrix s; // Similarity matrix after constraining.
+    AffineAlignObj obj;
+    AffineAlignResult(const SimMatrix& sim) : s(sim), obj(sim.n_row+1, sim.n_col+1, true, AlignOutput::medium) {}
+  };
+
+  // Copies a slot of the AffineAlignObj S4 class from the C++ object.
+  SEXP affineAlignObjSlot(const AffineAlignObj& obj, const SimMatrix& s, const std::string& name){
+    if(name == "s") return Vec2NumericMatrix(s.data, s.n_row, s.n_col);
+    if(name == "M") return transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.M));
+    if(name == "A") return transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.A));
+    if(name == "B") return transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.B));
+    if(name == "Traceback") return wrap(EnumToChar(obj.packedTraceback, (s.n_col+1) *(s.n_row+1)));
+    if(name == "path") return transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.Path));
+    if(name == "signalA_len") return wrap(obj.signalA_len);
+    if(name == "signalB_len") return wrap(obj.signalB_len);
+    if(name == "GapOpen") return wrap(obj.GapOpen);
+    if(name == "GapExten") return wrap(obj.GapExten);
+    if(name == "FreeEndGaps") return wrap(obj.FreeEndGaps);
+    if(name == "indexA_aligned") return wrap(obj.indexA_aligned);
+    if(name == "indexB_aligned") return wrap(obj.indexB_aligned);
+    if(name == "score") return wrap(obj.score);
+    if(name == "simScore_forw") return wrap(obj.simScore_forw);
+    if(name == "nGaps") return wrap(obj.nGaps);
+    throw std::invalid_argument("AffineAlignObj does not have a slot named " + name);
+  }
+}
+
 //' Get aligned indices from MS2 extracted-ion chromatograms(XICs) pair.
 //'
 //' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
@@ -336,6 +429,14 @@ NumericMatrix sgolayCpp(NumericMatrix chrom, int kernelLen, int polyOrd){
 //' @param kerLen (integer) In simType = crossCorrelation, length of the kernel used to sum similarity score. Must be an odd number.
 //' @param hardConstrain (logical) if false; indices farther from noBeef distance are filled with distance from linear fit line.
 //' @param samples4gradient (numeric) This parameter modulates penalization of masked indices.
+//' @param bandWidth (integer) If positive, only the cells within (noBeef + bandWidth) samples of the global fit are aligned.
+//' Alignment path cannot leave this band. For alignType = "local" or bandWidth = 0, the full similarity matrix is aligned.
+//' @param coarseFactor (integer) If more than 1 and bandWidth = 0, every coarseFactor-th sample is aligned first. Only the cells
+//' within 8 samples of this coarse path are then aligned at full resolution.
+//' @param anchorQuantile (numeric) If positive and coarseFactor = 1, only the rectangles between chained anchor cells are aligned.
+//' Anchors are co-eluting apices whose similarity is above this quantile of the similarity matrix. Values close to 1, e.g. 0.99, are recommended.
+//' @param approxQuantile (logical) If TRUE, quantiles of the similarity matrix for gapQuantile, dotProdThresh and anchorQuantile are estimated
+//' from a histogram of 1024 bins instead of being selected exactly. The error is at most the range of the similarity matrix divided by 1024.
 //' @return NumericMatrix Aligned indices of l1 and l2.
 //' @examples
 //' data(XIC_QFNNTDIVLLEDFQK_3_DIAlignR, package="DIAlignR")
@@ -355,83 +456,291 @@ NumericMatrix getAlignedTimesCpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, in
                                  double goFactor = 0.125, double geFactor = 40,
                                  double cosAngleThresh = 0.3, bool OverlapAlignment = true,
                                  double dotProdThresh = 0.96, double gapQuantile = 0.5, int kerLen = 9,
-                                 bool hardConstrain = false, double samples4gradient = 100.0){
-  std::vector<std::vector<double> > time1 = getTime(l1);
-  std::vector<std::vector<double> > intensity1 = getIntensity(l1);
-  std::vector<std::vector<double> > time2 = getTime(l2);
-  std::vector<std::vector<double> > intensity2 = getIntensity(l2);
+                                 bool hardConstrain = false, double samples4gradient = 100.0, int bandWidth = 0,
+                                 int coarseFactor = 1, double anchorQuantile = 0.0, bool approxQuantile = false){
+  NormalizationType norm = getNormalizationType(normalization);
+  std::unique_ptr<PreparedXICGroup> g1(prepareXICGroup(l1, kernelLen, polyOrd, norm));
+  std::unique_ptr<PreparedXICGroup> g2(prepareXICGroup(l2, kernelLen, polyOrd, norm));
+  return alignPreparedXICGroups(*g1, *g2, alignType, adaptiveRT, simType, Bp, goFactor, geFactor, cosAngleThresh,
+                                OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor,
+                                anchorQuantile, approxQuantile);
+}
 
-  // Smooth chromatograms
-  if(kernelLen != 0){
-    SavitzkyGolayFilter sgolay(kernelLen, polyOrd);
-    sgolay.setCoeff();
-    for(int i = 0; i<intensity1.size(); i++){
-      sgolay.smoothChroms(intensity1[i]);
-      sgolay.smoothChroms(intensity2[i]);
-    }
+//' Prepare an XIC group for repeated alignment
+//'
+//' Smooths, intersects and normalizes fragment-ion chromatograms once. The returned object is used by
+//' getAlignedTimesPreparedCpp() to align the same reference XICs against many experiment runs.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @param l1 (list) A list of numeric matrix of two columns.
+//' @param kernelLen (integer) length of filter. Must be an odd number.
+//' @param polyOrd (integer) TRUE: remove background from peak signal using estimated noise levels.
+//' @param normalization (char) A character string. Normalization must be selected from (L2, mean or none).
+//' @return (externalptr) A pointer to the prepared XIC group.
+//' @keywords internal
+// [[Rcpp::export]]
+SEXP prepareXICGroupCpp(Rcpp::List l1, int kernelLen, int polyOrd, std::string normalization){
+  Rcpp::XPtr<PreparedXICGroup> ptr(prepareXICGroup(l1, kernelLen, polyOrd, getNormalizationType(normalization)), true);
+  return ptr;
+}
+
+//' Get aligned indices from a prepared reference XIC group and MS2 extracted-ion chromatograms(XICs).
+//'
+//' Same as getAlignedTimesCpp() with the reference XICs prepared by prepareXICGroupCpp().
+//' Normalization is that of the reference. kernelLen and polyOrd must be the same as used for the reference.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @inheritParams getAlignedTimesCpp
+//' @param ref (externalptr) Output of prepareXICGroupCpp() for reference XICs.
+//' @return NumericMatrix Aligned indices of ref and l2.
+//' @keywords internal
+// [[Rcpp::export]]
+NumericMatrix getAlignedTimesPreparedCpp(SEXP ref, Rcpp::List l2, int kernelLen, int polyOrd,
+                                         std::string alignType, double adaptiveRT,
+                                         std::string simType, const std::vector<double>& Bp,
+                                         double goFactor = 0.125, double geFactor = 40,
+                                         double cosAngleThresh = 0.3, bool OverlapAlignment = true,
+                                         double dotProdThresh = 0.96, double gapQuantile = 0.5, int kerLen = 9,
+                                         bool hardConstrain = false, double samples4gradient = 100.0, int bandWidth = 0,
+                                         int coarseFactor = 1, double anchorQuantile = 0.0, bool approxQuantile = false){
+  Rcpp::XPtr<PreparedXICGroup> g1(ref);
+  std::unique_ptr<PreparedXICGroup> g2(prepareXICGroup(l2, kernelLen, polyOrd, g1->normalization));
+  return alignPreparedXICGroups(*g1, *g2, alignType, adaptiveRT, simType, Bp, goFactor, geFactor, cosAngleThresh,
+                                OverlapAlignment, dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor,
+                                anchorQuantile, approxQuantile);
+}
+
+//' Prepare a global fit for repeated evaluation
+//'
+//' Builds the fit between retention times of two runs once. The returned object is used by getMappedTimesCpp()
+//' and getAlignedTimesBatchCpp() to map reference times onto the experiment run without calling R.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @param fitType (char) Must be from "linear", "loess" and "spline".
+//' @param x (numeric) For fitType = "linear", intercept and slope. Otherwise, reference times of knots, e.g. x of
+//' stats::lowess() output. Linear interpolation between knots is identical to stats::approxfun(x, y, ties = mean).
+//' @param y (numeric) Experiment times of knots. Not used for fitType = "linear".
+//' @return (externalptr) A pointer to the global fit.
+//' @keywords internal
+// [[Rcpp::export]]
+SEXP prepareGlobalFitCpp(std::string fitType, const std::vector<double>& x, const std::vector<double>& y){
+  GlobalFitType type = getGlobalFitType(fitType);
+  GlobalFit* fit;
+  if(type == GlobalFitType::linear){
+    if(x.size() != 2) throw std::invalid_argument("A linear fit must have an intercept and a slope.");
+    fit = new GlobalFit(x[0], x[1]);
+  } else {
+    fit = new GlobalFit(x, y, type);
   }
+  Rcpp::XPtr<GlobalFit> ptr(fit, true);
+  return ptr;
+}
 
-  // Make sure that time vector is same for all fragment-ions.
-  xicIntersect(time1, intensity1);
-  xicIntersect(time2, intensity2);
+//' Experiment times mapped by a prepared global fit
+//'
+//' Same as getMappedTimes() with the fit evaluated in native code. If any mapped time is invalid, equally spaced
+//' experiment times are returned.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @param fit (externalptr) Output of prepareGlobalFitCpp().
+//' @param tRef (numeric) Reference times.
+//' @param tExp (numeric) Experiment times.
+//' @return (numeric) Experiment time for each reference time.
+//' @keywords internal
+// [[Rcpp::export]]
+NumericVector getMappedTimesCpp(SEXP fit, const std::vector<double>& tRef, const std::vector<double>& tExp){
+  Rcpp::XPtr<GlobalFit> ptr(fit);
+  return Rcpp::wrap(getMappedTimes(*ptr, tRef, tExp));
+}
 
-  int len = time1[0].size();
-  double samplingTime = (time1[0][len-1] - time1[0][0])/(len-1);
-  int noBeef = ceil(adaptiveRT/samplingTime);
+//' LOESS fits between retention times of many pairs of runs
+//'
+//' Each pair is fitted with the same algorithm as stats::lowess(RT.ref, RT.eXp, f = spanvalue, iter = 3). All pairs
+//' are fitted on a pool of native threads. Residual standard error is calculated as in getRSE().
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @param RTrefs (list) Each element has retention times of features in the reference run of a pair.
+//' @param RTeXps (list) Each element has retention times of the same features in the experiment run of a pair.
+//' @param spanvalue (numeric) Fraction of features that influence each fitted value.
+//' @param threads (integer) Number of threads. Pairs are fitted one after the other if it is 1.
+//' @return (list) Each element is the same as output of getLOESSfit(), with residual standard error in the "RSE" attribute.
+//' @keywords internal
+// [[Rcpp::export]]
+List getLOESSfitsCpp(Rcpp::List RTrefs, Rcpp::List RTeXps, double spanvalue, int threads = 1){
+  int n = RTrefs.size();
+  std::vector<std::vector<double> > refs(n), eXps(n);
+  for(int k = 0; k < n; k++){
+    refs[k] = Rcpp::as<std::vector<double> >(RTrefs[k]);
+    eXps[k] = Rcpp::as<std::vector<double> >(RTeXps[k]);
+  }
+  std::vector<LoessFit> fits = getLOESSfits(refs, eXps, spanvalue, threads);
+  List out(n);
+  for(int k = 0; k < n; k++){
+    List fit = List::create(Named("x") = fits[k].x, Named("y") = fits[k].y,
+                            Named("RT.ref") = RTrefs[k], Named("RT.eXp") = RTeXps[k]);
+    fit.attr("RSE") = std::isnan(fits[k].RSE) ? NA_REAL : fits[k].RSE;
+    out[k] = fit;
+  }
+  out.attr("names") = RTrefs.attr("names");
+  return out;
+}
 
-  SimMatrix s = getSimilarityMatrix(intensity1, intensity2, normalization, simType, cosAngleThresh, dotProdThresh, kerLen);
-  double gapPenalty = getGapPenalty(s, gapQuantile, simType);
-  if (alignType != "local"){
-    SimMatrix MASK;
-    MASK.n_row = time1[0].size();
-    MASK.n_col = time2[0].size();
-    MASK.data.resize(MASK.n_row*MASK.n_col, 0.0);
-    if(alignType == "global"){ // This will give aligned chromatogram for global alignment.
-      noBeef = 0;
-      hardConstrain = true;
-    }
-    calcNoBeefMask2(MASK, time1[0], time2[0], Bp, noBeef, hardConstrain);
-    auto maxIt = max_element(std::begin(s.data), std::end(s.data));
-    double maxVal = *maxIt;
-    constrainSimilarity(s, MASK, -2.0*maxVal/samples4gradient);
+//' Get aligned times of a prepared reference XIC group against many experiment runs.
+//'
+//' Same as calling getAlignedTimesPreparedCpp() for each experiment run. Experiment XICs are smoothed and
+//' prepared first, then all pairs are aligned on a pool of native threads without calling R.
+//' Each pair is independent, an error in one pair does not stop the others.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @inheritParams getAlignedTimesCpp
+//' @param ref (externalptr) Output of prepareXICGroupCpp() for reference XICs.
+//' @param l2s (list) Each element is a list of numeric matrix of two columns, XICs of an experiment run.
+//' @param alignTypes (char) Alignment type of each experiment run. Available alignment methods are "global", "local" and "hybrid".
+//' @param adaptiveRTs (numeric) adaptiveRT of each experiment run.
+//' @param Bps (list) Each element is the Bp of an experiment run, or the output of prepareGlobalFitCpp() for that pair.
+//' A prepared fit is evaluated with getMappedTimesCpp() on the prepared reference and experiment times.
+//' @param threads (integer) Number of threads. Pairs are aligned one after the other if it is 1.
+//' @return (list) Each element is aligned times of ref and an experiment run, or NULL if that pair could not be aligned.
+//' The error message of a failed pair is in the "errors" attribute.
+//' @keywords internal
+// [[Rcpp::export]]
+List getAlignedTimesBatchCpp(SEXP ref, Rcpp::List l2s, int kernelLen, int polyOrd,
+                             const std::vector<std::string>& alignTypes, const std::vector<double>& adaptiveRTs,
+                             std::string simType, Rcpp::List Bps,
+                             double goFactor = 0.125, double geFactor = 40,
+                             double cosAngleThresh = 0.3, bool OverlapAlignment = true,
+                             double dotProdThresh = 0.96, double gapQuantile = 0.5, int kerLen = 9,
+                             bool hardConstrain = false, double samples4gradient = 100.0, int bandWidth = 0,
+                             int coarseFactor = 1, double anchorQuantile = 0.0, int threads = 1, bool approxQuantile = false){
+  Rcpp::XPtr<PreparedXICGroup> g1(ref);
+  int n = l2s.size();
+  if((int)alignTypes.size() != n || (int)adaptiveRTs.size() != n || Bps.size() != n){
+    throw std::invalid_argument("alignTypes, adaptiveRTs and Bps must have one element for each experiment run.");
   }
-  AffineAlignObj obj(s.n_row+1, s.n_col+1); // Initializing C++ AffineAlignObj struct
-  doAffineAlignment(obj, s, gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment); // Performs alignment on s matrix and returns AffineAlignObj struct
-  getAffineAlignedIndices(obj, 9); // Performs traceback and fills aligned indices in AffineAlignObj struct
-
-  // Expand time vector to aligned-indices
-  int nrow = obj.indexA_aligned.size();
-  std::vector<double> tRef(nrow, -1.0);
-  std::vector<double> tExp(nrow, -1.0);
-  for(int i= 0; i<nrow; i++){
-    if(obj.indexA_aligned[i] != 0){
-      tRef[i] = time1[0][obj.indexA_aligned[i]-1];
-    }
-    if(obj.indexB_aligned[i] != 0){
-      tExp[i] = time2[0][obj.indexB_aligned[i]-1];
+  std::vector<std::string> errors(n);
+  // Conversion from R objects and smoothing happen on this thread.
+  std::vector<std::unique_ptr<PreparedXICGroup> > g2(n);
+  std::vector<const PreparedXICGroup*> eXps;
+  std::vector<std::string> types;
+  std::vector<double> rts;
+  std::vector<std::vector<double> > fits;
+  std::vector<int> pairIdx;
+  for(int k = 0; k < n; k++){
+    std::vector<double> Bp;
+    try{
+      g2[k].reset(prepareXICGroup(l2s[k], kernelLen, polyOrd, g1->normalization));
+      if(TYPEOF(Bps[k]) == EXTPTRSXP){
+        Rcpp::XPtr<GlobalFit> fit(Bps[k]);
+        Bp = getMappedTimes(*fit, g1->xic.time, g2[k]->xic.time);
+      } else {
+        Bp = Rcpp::as<std::vector<double> >(Bps[k]);
+      }
+    } catch(const std::exception& e){
+      errors[k] = e.what();
+      continue;
     }
+    eXps.push_back(g2[k].get());
+    types.push_back(alignTypes[k]);
+    rts.push_back(adaptiveRTs[k]);
+    fits.push_back(std::move(Bp));
+    pairIdx.push_back(k);
   }
+  XICAlignParams params = getXICAlignParams(simType, goFactor, geFactor, cosAngleThresh, OverlapAlignment,
+                                            dotProdThresh, gapQuantile, kerLen, hardConstrain, samples4gradient, bandWidth, coarseFactor,
+                                            anchorQuantile, approxQuantile);
+  std::vector<std::string> pairErrors;
+  std::vector<AlignedTimes> aligned = alignXICGroupBatch(*g1, eXps, types, rts, fits, params, threads, pairErrors);
 
-  // Fill missing values like zoo::na.approx
-  interpolateZero(tRef);
-  interpolateZero(tExp);
-
-  // Keep only those values for which there is no missing insert in the reference.
-  int noKeep = std::count(obj.indexA_aligned.begin(), obj.indexA_aligned.end(), 0);
-  Rcpp::NumericVector A(nrow-noKeep, NA_REAL);
-  Rcpp::NumericVector B(nrow-noKeep, NA_REAL);
-
+  List out(n);
+  for(std::size_t m = 0; m < pairIdx.size(); m++){
+    int k = pairIdx[m];
+    if(pairErrors[m].empty()){
+      out[k] = alignedTimes2NumericMatrix(aligned[m]);
+    } else {
+      errors[k] = pairErrors[m];
+    }
+  }
+  out.attr("names") = l2s.attr("names");
+  out.attr("errors") = Rcpp::wrap(errors);
+  return out;
+}
 
-  int j = 0;
-  for(int i = 0; i<nrow; i++){
-    if(obj.indexA_aligned[i] != 0){
-      A[j] = (tRef[i] < 0) ? NA_REAL : ::Rf_fround(tRef[i], 2);
-      B[j] = (tExp[i] < 0) ? NA_REAL : ::Rf_fround(tExp[i], 2);
-      ++j;
+//' Get distances among runs from alignment scores of their XICs
+//'
+//' XICs of the same analyte from all runs are smoothed and prepared, then each pair of runs is aligned with
+//' alignType = "local" on a pool of native threads. Only alignment scores are calculated, without traceback.
+//' Distance between run i and j is 1 - s(i, j)/sqrt(s(i, i) * s(j, j)), where s is the alignment score.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @inheritParams getAlignedTimesCpp
+//' @param XICs (list) Each element is a list of numeric matrix of two columns, XICs of a run.
+//' @param threads (integer) Number of threads. Pairs are aligned one after the other if it is 1.
+//' @return (matrix) Symmetric distance matrix with a row and a column for each run. Distances of a pair that could not
+//' be aligned are NA. Rows and columns of a run whose XICs could not be prepared are NA, and its error message is in
+//' the "errors" attribute, which has an empty string for every other run.
+//' @keywords internal
+// [[Rcpp::export]]
+NumericMatrix getRunDistancesCpp(Rcpp::List XICs, int kernelLen, int polyOrd, std::string normalization,
+                                 std::string simType, double goFactor = 0.125, double geFactor = 40,
+                                 double cosAngleThresh = 0.3, bool OverlapAlignment = true,
+                                 double dotProdThresh = 0.96, double gapQuantile = 0.5, int kerLen = 9,
+                                 int threads = 1){
+  NormalizationType norm = getNormalizationType(normalization);
+  int n = XICs.size();
+  // Conversion from R objects and smoothing happen on this thread.
+  std::vector<std::string> errors(n);
+  std::vector<std::unique_ptr<PreparedXICGroup> > groups(n);
+  std::vector<const PreparedXICGroup*> runs;
+  std::vector<int> runIdx;
+  for(int k = 0; k < n; k++){
+    try{
+      groups[k].reset(prepareXICGroup(XICs[k], kernelLen, polyOrd, norm));
+    } catch(const std::exception& e){
+      errors[k] = e.what();
+      continue;
     }
+    runs.push_back(groups[k].get());
+    runIdx.push_back(k);
   }
+  // Local alignment does not use the global fit, hence, its constraint parameters are left at their defaults.
+  XICAlignParams params;
+  params.simType = getSimilarityType(simType);
+  params.goFactor = goFactor;
+  params.geFactor = geFactor;
+  params.cosAngleThresh = cosAngleThresh;
+  params.OverlapAlignment = OverlapAlignment;
+  params.dotProdThresh = dotProdThresh;
+  params.gapQuantile = gapQuantile;
+  params.kerLen = kerLen;
+  std::vector<double> dist = alignXICGroupDistances(runs, params, threads);
 
-  return Rcpp::cbind(A,B);
+  NumericMatrix out(n, n);
+  std::fill(out.begin(), out.end(), NA_REAL);
+  int m = runs.size();
+  for(int a = 0; a < m; a++){
+    for(int b = 0; b < m; b++){
+      if(!std::isnan(dist[a*m + b])) out(runIdx[a], runIdx[b]) = dist[a*m + b];
+    }
+  }
+  if(!Rf_isNull(XICs.attr("names"))){
+    out.attr("dimnames") = List::create(XICs.attr("names"), XICs.attr("names"));
+  }
+  out.attr("errors") = Rcpp::wrap(errors);
+  return out;
 }
 
 //' Aligns MS2 extracted-ion chromatograms(XICs) pair.
@@ -463,7 +772,8 @@ NumericMatrix getAlignedTimesCpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, in
 //' @param kerLen (integer) In simType = crossCorrelation, length of the kernel used to sum similarity score. Must be an odd number.
 //' @param hardConstrain (logical) if false; indices farther from noBeef distance are filled with distance from linear fit line.
 //' @param samples4gradient (numeric) This parameter modulates penalization of masked indices.
-//' @param objType (char) A character string. Must be either light, medium or heavy.
+//' @param objType (char) A character string. Must be either light, medium, heavy or lazy.
+//' lazy returns an AffineAlignObjLazy. Its slots of AffineAlignObj are copied from C++ only when they are accessed with \code{$}.
 //' @return affineAlignObj (S4class) A S4class object from C++ AffineAlignObj struct.
 //' @examples
 //' data(XIC_QFNNTDIVLLEDFQK_3_DIAlignR, package="DIAlignR")
@@ -513,21 +823,33 @@ S4 alignChromatogramsCpp(Rcpp::List l1, Rcpp::List l2, std::string alignType,
 
   SimMatrix s = getSimilarityMatrix(r1, r2, normalization, simType, cosAngleThresh, dotProdThresh, kerLen);
   double gapPenalty = getGapPenalty(s, gapQuantile, simType);
-  if (alignType == "hybrid"){
-    SimMatrix MASK;
-    MASK.n_row = tA.size();
-    MASK.n_col = tB.size();
-    MASK.data.resize(MASK.n_row*MASK.n_col, 0.0);
-    double A1 = tA[0], A2 = tA[MASK.n_row-1];
-    double B1 = tB[0], B2 = tB[MASK.n_col-1];
-    if(B2p > B1p || B1p <= 0 || B2p <= 0) calcNoBeefMask(MASK, A1, A2, B1, B2, B1p, B2p, noBeef, hardConstrain);
+  // Otherwise, MASK is zero and s is not penalized.
+  if (alignType == "hybrid" && (B2p > B1p || B1p <= 0 || B2p <= 0)){
     auto maxIt = max_element(std::begin(s.data), std::end(s.data));
     double maxVal = *maxIt;
-    constrainSimilarity(s, MASK, -2.0*maxVal/samples4gradient);
+    // Similarity matrix is penalized row-by-row, hence, MASK is not built.
+    NoBeefLinePenalty penalty(tA.size(), tB.size(), tA.front(), tA.back(), tB.front(), B1p, B2p, noBeef, hardConstrain,
+                              -2.0*maxVal/samples4gradient);
+    for(int i = 0; i < s.n_row; i++) penalty.constrainRow(i, &s.data[i*s.n_col]);
+  }
+  if(objType == "lazy"){
+    // Only aligned indices and score are copied now. Other slots are copied by getAffineAlignObjSlotCpp() when accessed.
+    Rcpp::XPtr<AffineAlignResult> ptr(new AffineAlignResult(s), true);
+    doAffineAlignment(ptr->obj, ptr->s, gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment);
+    getAffineAlignedIndices(ptr->obj, 9, AlignOutput::heavy, &ptr->s);
+    S4 x("AffineAlignObjLazy");
+    x.slot("indexA_aligned") = ptr->obj.indexA_aligned;
+    x.slot("indexB_aligned") = ptr->obj.indexB_aligned;
+    x.slot("score") = ptr->obj.score;
+    x.slot("ptr") = ptr;
+    x.slot("cache") = Environment::empty_env().new_child(true);
+    return(x);
   }
-  AffineAlignObj obj(s.n_row+1, s.n_col+1); // Initializing C++ AffineAlignObj struct
+  AlignOutput output = (objType == "light") ? AlignOutput::light : (objType == "medium") ? AlignOutput::medium : AlignOutput::heavy;
+  PooledAffineAlignObj pooled(s.n_row+1, s.n_col+1, output); // C++ AffineAlignObj struct, reused across calls on this thread.
+  AffineAlignObj& obj = *pooled;
   doAffineAlignment(obj, s, gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment); // Performs alignment on s matrix and returns AffineAlignObj struct
-  getAffineAlignedIndices(obj, 9); // Performs traceback and fills aligned indices in AffineAlignObj struct
+  getAffineAlignedIndices(obj, 9, output, &s); // Performs traceback and fills only the outputs of objType in AffineAlignObj struct
 
   if(objType == "light"){
     S4 x("AffineAlignObjLight");  // Creating an empty S4 object of AffineAlignObj class
@@ -548,27 +870,33 @@ S4 alignChromatogramsCpp(Rcpp::List l1, Rcpp::List l2, std::string alignType,
   } else {
     S4 x("AffineAlignObj");  // Creating an empty S4 object of AffineAlignObj class
     // Copying values to slots
-    x.slot("s") = Vec2NumericMatrix(s.data, s.n_row, s.n_col);
-    x.slot("M")  = transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.M));
-    x.slot("A")  = transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.A));
-    x.slot("B")  = transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.B));
-    std::vector<TracebackType> tmp(obj.Traceback, obj.Traceback + 3*(s.n_col+1) *(s.n_row+1) );
-    x.slot("Traceback")  = EnumToChar(tmp);
-    x.slot("path") = transpose(NumericMatrix(s.n_col+1, s.n_row+1, obj.Path));
-    x.slot("signalA_len") = obj.signalA_len;
-    x.slot("signalB_len") = obj.signalB_len;
-    x.slot("GapOpen") = obj.GapOpen;
-    x.slot("GapExten") = obj.GapExten;
-    x.slot("FreeEndGaps") = obj.FreeEndGaps;
-    x.slot("indexA_aligned") = obj.indexA_aligned;
-    x.slot("indexB_aligned") = obj.indexB_aligned;
-    x.slot("score") = obj.score;
-    x.slot("simScore_forw") = getForwardSim(s, obj.simPath);
-    x.slot("nGaps") = obj.nGaps;
+    for(const char* name : {"s", "M", "A", "B", "Traceback", "path", "signalA_len", "signalB_len", "GapOpen", "GapExten",
+                            "FreeEndGaps", "indexA_aligned", "indexB_aligned", "score", "simScore_forw", "nGaps"}){
+      x.slot(name) = affineAlignObjSlot(obj, s, name);
+    }
     return(x);
   }
 }
 
+//' Get a slot of AffineAlignObjLazy
+//'
+//' Copies a slot of AffineAlignObj class from the alignment kept in C++. It is called by \code{$} on AffineAlignObjLazy.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @param ptr (externalptr) ptr slot of an AffineAlignObjLazy.
+//' @param name (char) Name of a slot of AffineAlignObj class.
+//' @return Value of the slot.
+//' @keywords internal
+// [[Rcpp::export]]
+SEXP getAffineAlignObjSlotCpp(SEXP ptr, std::string name){
+  Rcpp::XPtr<AffineAlignResult> result(ptr);
+  // Throws if the pointer is not valid, e.g. the object was serialized and read back.
+  AffineAlignResult* r = result.checked_get();
+  return affineAlignObjSlot(r->obj, r->s, name);
+}
+
 //' Perform non-affine global and overlap alignment on a similarity matrix
 //'
 //' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
@@ -668,18 +996,18 @@ S4 doAlignmentCpp(NumericMatrix sim, double gap, bool OverlapAlignment){
 S4 doAffineAlignmentCpp(NumericMatrix sim, double go, double ge, bool OverlapAlignment){
   int signalA_len = sim.nrow(); // Length of signalA or sequenceA. Expresses along the rows of s.
   int signalB_len = sim.ncol(); // Length of signalB or sequenceB. Expresses along the columns of s.
-  AffineAlignObj obj(signalA_len+1, signalB_len+1); // Initializing C++ AffineAlignObj struct
+  PooledAffineAlignObj pooled(signalA_len+1, signalB_len+1); // C++ AffineAlignObj struct, reused across calls on this thread.
+  AffineAlignObj& obj = *pooled;
   SimMatrix s = NumericMatrix2Vec(sim);
   doAffineAlignment(obj, s, go, ge, OverlapAlignment);  // Performs alignment on s matrix and returns AffineAlignObj struct
-  getAffineAlignedIndices(obj); // Performs traceback and fills aligned indices in AffineAlignObj struct
+  getAffineAlignedIndices(obj, 0, AlignOutput::heavy, &s); // Performs traceback and fills aligned indices in AffineAlignObj struct
   S4 x("AffineAlignObj");  // Creating an empty S4 object of AffineAlignObj class
   // Copying values to slots
   x.slot("s") = sim;
   x.slot("M") = transpose(NumericMatrix(signalB_len+1, signalA_len+1, obj.M));
   x.slot("A") = transpose(NumericMatrix(signalB_len+1, signalA_len+1, obj.A));
   x.slot("B") = transpose(NumericMatrix(signalB_len+1, signalA_len+1, obj.B));
-  std::vector<TracebackType> tmp(obj.Traceback, obj.Traceback + 3*(signalB_len+1) *(signalA_len+1) );
-  x.slot("Traceback")  = EnumToChar(tmp);
+  x.slot("Traceback")  = EnumToChar(obj.packedTraceback, (signalB_len+1) *(signalA_len+1));
   x.slot("path") = transpose(NumericMatrix(signalB_len+1, signalA_len+1, obj.Path));
   x.slot("signalA_len") = obj.signalA_len;
   x.slot("signalB_len") = obj.signalB_len;
@@ -689,11 +1017,28 @@ S4 doAffineAlignmentCpp(NumericMatrix sim, double go, double ge, bool OverlapAli
   x.slot("indexA_aligned") = obj.indexA_aligned;
   x.slot("indexB_aligned") = obj.indexB_aligned;
   x.slot("score") = obj.score;
-  x.slot("simScore_forw") = getForwardSim(s, obj.simPath);
+  x.slot("simScore_forw") = obj.simScore_forw;
   x.slot("nGaps") = obj.nGaps;
   return(x);
 }
 
+//' Release memory kept for affine alignment
+//'
+//' Alignment matrices are kept after \code{doAffineAlignmentCpp} and \code{alignChromatogramsCpp} return, and are reused by
+//' later alignments of a similar size. This frees them, e.g. after a large batch of alignments in a long R session.
+//' @author Shubham Gupta, \email{shubh.gupta@mail.utoronto.ca}
+//' ORCID: 0000-0003-3500-8152
+//' License: (c) Author (2019) + MIT
+//' Date: 2019-03-08
+//' @return (numeric) Number of bytes freed.
+//' @examples
+//' clearAlignmentPoolCpp()
+//' @export
+// [[Rcpp::export]]
+double clearAlignmentPoolCpp(){
+  return PooledAffineAlignObj::clear();
+}
+
 
 //' Interpolate using spline
 //'
@@ -752,63 +1097,73 @@ List getChildXICpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, int polyOrd,
                         double dotProdThresh = 0.96, double gapQuantile = 0.5, int kerLen = 9,
                         bool hardConstrain = false, double samples4gradient = 100.0, double wRef = 0.5,
                         std::string splineMethod = "natural", std::string mergeStrategy = "avg",
-                        bool keepFlanks = true){
-  std::vector<std::vector<double> > time1 = getTime(l1);
-  std::vector<std::vector<double> > intensity1 = getIntensity(l1);
-  std::vector<std::vector<double> > time2 = getTime(l2);
-  std::vector<std::vector<double> > intensity2 = getIntensity(l2);
-
-  // Make sure that time vector is same for all fragment-ions.
-  xicIntersect(time1, intensity1);
-  xicIntersect(time2, intensity2);
+                        bool keepFlanks = true, int bandWidth = 0){
+  // Time vector is same for all fragment-ions of a group.
+  ChromatogramGroup xic1 = getChromatogramGroup(l1);
+  ChromatogramGroup xic2 = getChromatogramGroup(l2);
+  const std::vector<double>& time1 = xic1.time;
+  const std::vector<double>& time2 = xic2.time;
 
   // Smooth chromatograms
-  std::vector<std::vector<double> > intensity1s =intensity1;
-  std::vector<std::vector<double> > intensity2s =intensity2;
+  ChromatogramGroup xic1s = xic1;
+  ChromatogramGroup xic2s = xic2;
   if(kernelLen != 0){
     SavitzkyGolayFilter sgolay(kernelLen, polyOrd);
     sgolay.setCoeff();
-    for(int i = 0; i<intensity1.size(); i++){
-      sgolay.smoothChroms(intensity1s[i]);
-      sgolay.smoothChroms(intensity2s[i]);
-    }
+    for(int i = 0; i<xic1s.nFrag; i++) sgolay.smoothChroms(xic1s.fragment(i), xic1s.len);
+    for(int i = 0; i<xic2s.nFrag; i++) sgolay.smoothChroms(xic2s.fragment(i), xic2s.len);
   }
 
   // Align chromatograms
-  int len = time1[0].size();
-  double samplingTime = (time1[0][len-1] - time1[0][0])/(len-1);
+  int len = time1.size();
+  double samplingTime = (time1[len-1] - time1[0])/(len-1);
   int noBeef = ceil(adaptiveRT/samplingTime);
 
-  SimMatrix s = getSimilarityMatrix(intensity1s, intensity2s, normalization, simType, cosAngleThresh, dotProdThresh, kerLen);
+  SimMatrix s = getSimilarityMatrix(xic1s.view(), xic2s.view(), getNormalizationType(normalization), getSimilarityType(simType),
+                                    cosAngleThresh, dotProdThresh, kerLen);
   double gapPenalty = getGapPenalty(s, gapQuantile, simType);
+  // Similarity matrix is penalized row-by-row during alignment, hence, MASK is not built.
+  std::unique_ptr<NoBeefPenalty> penalty;
   if (alignType != "local"){
-    SimMatrix MASK;
-    MASK.n_row = time1[0].size();
-    MASK.n_col = time2[0].size();
-    MASK.data.resize(MASK.n_row*MASK.n_col, 0.0);
     if(alignType == "global"){ // This will give aligned chromatogram for global alignment.
       noBeef = 0;
       hardConstrain = true;
       samples4gradient = 1;
     }
-    calcNoBeefMask2(MASK, time1[0], time2[0], Bp, noBeef, hardConstrain);
     auto maxIt = max_element(std::begin(s.data), std::end(s.data));
     double maxVal = *maxIt;
-    constrainSimilarity(s, MASK, -2.0*maxVal/samples4gradient);
+    penalty.reset(new NoBeefPenalty(time2, Bp, noBeef, hardConstrain, -2.0*maxVal/samples4gradient));
+  }
+  std::vector<int> indexA_aligned, indexB_aligned;
+  if(bandWidth > 0 && penalty){
+    // Only cells close to the global fit are penalized and filled. noBeef is zero for global alignment.
+    SimBand band;
+    calcNoBeefBand(band, time2, Bp, noBeef + bandWidth);
+    for(int i = 0; i < s.n_row; i++){
+      penalty->constrainRow(i, &s.data[i*s.n_col + band.start[i]], band.start[i], band.end[i]);
+    }
+    BandedAffineAlignObj obj(band);
+    doBandedAffineAlignment(obj, s, gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment);
+    getBandedAffineAlignedIndices(obj);
+    indexA_aligned = std::move(obj.indexA_aligned);
+    indexB_aligned = std::move(obj.indexB_aligned);
+  } else {
+    FusedAffineAlignObj obj(s.n_row+1, s.n_col+1); // Keeps only Traceback and the last row and column of M, A and B.
+    doFusedAffineAlignment(obj, s, penalty.get(), gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment);
+    getFusedAffineAlignedIndices(obj, s, penalty.get());
+    indexA_aligned = std::move(obj.indexA_aligned);
+    indexB_aligned = std::move(obj.indexB_aligned);
   }
-  AffineAlignObj obj(s.n_row+1, s.n_col+1); // Initializing C++ AffineAlignObj struct
-  doAffineAlignment(obj, s, gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment); // Performs alignment on s matrix and returns AffineAlignObj struct
-  getAffineAlignedIndices(obj, 9); // Performs traceback and fills aligned indices in AffineAlignObj struct
 
   // Linear interpolate time and spline-interpolate intensity to fill gaps.
-  std::vector<std::vector<double> > intensity1N = imputeChromatogram(intensity1, time1[0], obj.indexA_aligned);
-  std::vector<std::vector<double> > intensity2N = imputeChromatogram(intensity2, time2[0], obj.indexB_aligned);
+  std::vector<std::vector<double> > intensity1N = imputeChromatogram(xic1.view(), indexA_aligned);
+  std::vector<std::vector<double> > intensity2N = imputeChromatogram(xic2.view(), indexB_aligned);
   std::vector<double> t1 = intensity1N.back();
   std::vector<double> t2 = intensity2N.back();
 
   // Remove flanking region. Remove indices that corresponds to a gap in reference signal.
   std::vector<int> flank = getFlank(t1, t2);
-  std::vector<int> skip = getSkip(obj.indexA_aligned, flank);
+  std::vector<int> skip = getSkip(indexA_aligned, flank);
   std::vector<int> keep = getKeep(t1.size(), skip);
   if(keep.size() == 0) return List::create(R_NilValue);
   std::vector<double> t1NN(keep.size());
@@ -932,34 +1287,19 @@ List otherChildXICpp(Rcpp::List l1, Rcpp::List l2, int kernelLen, int polyOrd, N
   std::vector<double> t3 = Rcpp::as<std::vector<double>>(v);
   std::replace_if(t3.begin(), t3.end(), [](double a){return a!= a;}, -1); // Remove NA values
 
-  std::vector<std::vector<double> > time1 = getTime(l1);
-  std::vector<std::vector<double> > intensity1 = getIntensity(l1);
-  std::vector<std::vector<double> > time2 = getTime(l2);
-  std::vector<std::vector<double> > intensity2 = getIntensity(l2);
-
-  // Smooth chromatograms
-  if(kernelLen != 0){
-    SavitzkyGolayFilter sgolay(kernelLen, polyOrd);
-    sgolay.setCoeff();
-    for(int i = 0; i<intensity1.size(); i++){
-      sgolay.smoothChroms(intensity1[i]);
-      sgolay.smoothChroms(intensity2[i]);
-    }
-  }
-
-  // Make sure that time vector is same for all fragment-ions.
-  xicIntersect(time1, intensity1);
-  xicIntersect(time2, intensity2);
+  // Smooth chromatograms and make sure that time vector is same for all fragment-ions.
+  ChromatogramGroup xic1 = getChromatogramGroup(l1, kernelLen, polyOrd);
+  ChromatogramGroup xic2 = getChromatogramGroup(l2, kernelLen, polyOrd);
 
   // spline-interpolate intensity to fill gaps.
   std::vector<int> flank = getFlank(t1, t2);
   std::vector<int> keep(t1.size());
   std::iota(keep.begin(), keep.end(), 0);
-  std::vector<int> tIndex = getMatchingIdx(t1, time1[0]); // Get index of t1 in time1[0]
+  std::vector<int> tIndex = getMatchingIdx(t1, xic1.time); // Get index of t1 in time of xic1
 
-  std::vector<std::vector<double> > intensity1N = imputeChromatogram1(intensity1, tIndex, time1[0], t1);
-  tIndex = getMatchingIdx(t2, time2[0]);
-  std::vector<std::vector<double> > intensity2N = imputeChromatogram1(intensity2, tIndex, time2[0], t2);
+  std::vector<std::vector<double> > intensity1N = imputeChromatogram1(xic1.view(), tIndex, t1);
+  tIndex = getMatchingIdx(t2, xic2.time);
+  std::vector<std::vector<double> > intensity2N = imputeChromatogram1(xic2.view(), tIndex, t2);
 
   // Get indices for which there is no gap in reference signal.
   keep = getMatchingIdx(childTime, t3); // Match child time in t3. Remove flank.
@@ -199,8 +199,12 @@ public:
   }
 
   void smoothChroms(std::vector<double> & intensity){
+    smoothChroms(intensity.data(), intensity.size());
+  }
+
+  /// Smooths len intensities in place, e.g. a fragment-ion of ChromatogramGroup.
+  void smoothChroms(double* intensity, int len){
     PeakIntegration::MSChromatogram chromatogram;
-    int len = intensity.size();
     chromatogram.resize(len);
     PeakIntegration::MSChromatogram::Iterator it = chromatogram.begin();
     for (int i=0; i<len; ++i, ++it)
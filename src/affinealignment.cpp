@@ -1,28 +1,121 @@
 #include "affinealignment.h"
+#include "affineengine.h"
 #include <exception>
 #include <stdexcept>
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DIALIGN_AVX2_KERNEL
+#include <immintrin.h>
+#endif
 
 // #include "simpleFcn.h"
 // Do not inclue cpp file otherwise compiler will build the Obj through two different path.
 
 namespace {
-  void validate(DIAlign::AffineAlignObj& affineAlignObj, const DIAlign::SimMatrix& s, double go, double ge) {
-    if(go < 0.0){
-      throw std::invalid_argument("Gap opening penalty should be non-negative");
-    }
-    if(ge < 0.0){
-      throw std::invalid_argument("Gap extension penalty should be non-negative");
-    }
-    if(affineAlignObj.signalA_len != s.n_row || affineAlignObj.signalB_len != s.n_col){
-      throw std::invalid_argument("AffineAlignObj should have number of rows and columns +1 each than that of similarity matrix s.");
-    }
-    if(affineAlignObj.signalA_len <= 1 || affineAlignObj.signalB_len <= 1){
-      throw std::invalid_argument("AffineAlignObj must have more than unit size.");
-    }
-    if(s.n_row <= 0 || s.n_col <= 0){
-      throw std::invalid_argument("similarity matrix s must have atleast unit size.");
+#ifdef DIALIGN_AVX2_KERNEL
+  // Fills cells (i, j) with i, j > 0 of M, A, B and Traceback one anti-diagonal (i+j = d) at a time.
+  // Cells of an anti-diagonal depend only on the previous two, hence, four rows are filled together.
+  // Each lane repeats the comparisons of fillAffineCell() with blends, so scores and ties are bit-identical.
+  // First row and column of affineAlignObj must be initialized already.
+  __attribute__((target("avx2")))
+  void fillAntiDiagonalsAVX2(DIAlign::AffineAlignObj& obj, const DIAlign::SimMatrix& s, double go, double ge){
+    using namespace DIAlign::Traceback;
+    int nRow = s.n_row, nCol = s.n_col, COL_SIZE = nCol+1;
+    // M, A and B along anti-diagonals d-2, d-1 and d, indexed by row.
+    std::vector<double> buf(9*(nRow+1));
+    double* diag[3][3];
+    for(int k = 0; k < 3; k++) for(int m = 0; m < 3; m++) diag[k][m] = &buf[(3*k+m)*(nRow+1)];
+    std::vector<double> sd(nRow+1);
+    int code[4];
+
+    const __m256d goV = _mm256_set1_pd(go), geV = _mm256_set1_pd(ge);
+    for(int d = 0; d <= nRow + nCol; d++){
+      double** cur = diag[d % 3];
+      double** d1 = diag[(d+2) % 3]; // anti-diagonal d-1
+      double** d2 = diag[(d+1) % 3]; // anti-diagonal d-2
+      // Cells on the first row and column are copied from the initialized matrices.
+      if(d <= nCol){
+        cur[M][0] = obj.M[d]; cur[A][0] = obj.A[d]; cur[B][0] = obj.B[d];
+      }
+      if(d <= nRow){
+        cur[M][d] = obj.M[d*COL_SIZE]; cur[A][d] = obj.A[d*COL_SIZE]; cur[B][d] = obj.B[d*COL_SIZE];
+      }
+      int lo = std::max(1, d-nCol), hi = std::min(nRow, d-1);
+      for(int i = lo; i <= hi; i++) sd[i] = s.data[(i-1)*nCol + d-i-1];
+
+      auto fillCell = [&](int i){
+        int idx = i*COL_SIZE + d-i;
+        TracebackType tbM = SS, tbA = SS, tbB = SS;
+        double cellM = 0.0, cellA = 0.0, cellB = 0.0;
+        DIAlign::AffineAlignment::fillAffineCell(sd[i], d2[M][i-1], d2[A][i-1], d2[B][i-1],
+                                                 d1[M][i-1], d1[A][i-1], d1[B][i-1],
+                                                 d1[M][i], d1[A][i], d1[B][i], go, ge, cellM, cellA, cellB, tbM, tbA, tbB);
+        cur[M][i] = obj.M[idx] = cellM;
+        cur[A][i] = obj.A[idx] = cellA;
+        cur[B][i] = obj.B[idx] = cellB;
+        obj.packedTraceback[idx] = packTraceback(tbM, tbA, tbB);
+      };
+
+      int i = lo;
+      for(; i+3 <= hi; i += 4){
+        __m256d sij = _mm256_loadu_pd(&sd[i]);
+        __m256d Diago = _mm256_add_pd(_mm256_loadu_pd(&d2[M][i-1]), sij);
+        __m256d InsertInA = _mm256_add_pd(_mm256_loadu_pd(&d2[A][i-1]), sij);
+        __m256d InsertInB = _mm256_add_pd(_mm256_loadu_pd(&d2[B][i-1]), sij);
+        __m256d isDA = _mm256_and_pd(_mm256_cmp_pd(InsertInA, Diago, _CMP_GE_OQ), _mm256_cmp_pd(InsertInA, InsertInB, _CMP_GE_OQ));
+        __m256d isDB = _mm256_and_pd(_mm256_cmp_pd(InsertInB, Diago, _CMP_GE_OQ), _mm256_cmp_pd(InsertInB, InsertInA, _CMP_GE_OQ));
+        __m256d isDM = _mm256_and_pd(_mm256_cmp_pd(Diago, InsertInA, _CMP_GE_OQ), _mm256_cmp_pd(Diago, InsertInB, _CMP_GE_OQ));
+
+        __m256d AfromM = _mm256_sub_pd(_mm256_loadu_pd(&d1[M][i-1]), goV);
+        __m256d AfromA = _mm256_sub_pd(_mm256_loadu_pd(&d1[A][i-1]), geV);
+        __m256d AfromB = _mm256_sub_pd(_mm256_loadu_pd(&d1[B][i-1]), goV);
+        __m256d isTA = _mm256_and_pd(_mm256_cmp_pd(AfromA, AfromM, _CMP_GE_OQ), _mm256_cmp_pd(AfromA, AfromB, _CMP_GE_OQ));
+        __m256d isTB = _mm256_and_pd(_mm256_cmp_pd(AfromB, AfromM, _CMP_GE_OQ), _mm256_cmp_pd(AfromB, AfromA, _CMP_GE_OQ));
+        __m256d isTM = _mm256_and_pd(_mm256_cmp_pd(AfromM, AfromA, _CMP_GE_OQ), _mm256_cmp_pd(AfromM, AfromB, _CMP_GE_OQ));
+
+        __m256d BfromM = _mm256_sub_pd(_mm256_loadu_pd(&d1[M][i]), goV);
+        __m256d BfromA = _mm256_sub_pd(_mm256_loadu_pd(&d1[A][i]), goV);
+        __m256d BfromB = _mm256_sub_pd(_mm256_loadu_pd(&d1[B][i]), geV);
+        __m256d isLA = _mm256_and_pd(_mm256_cmp_pd(BfromA, BfromM, _CMP_GE_OQ), _mm256_cmp_pd(BfromA, BfromB, _CMP_GE_OQ));
+        __m256d isLB = _mm256_and_pd(_mm256_cmp_pd(BfromB, BfromM, _CMP_GE_OQ), _mm256_cmp_pd(BfromB, BfromA, _CMP_GE_OQ));
+        __m256d isLM = _mm256_and_pd(_mm256_cmp_pd(BfromM, BfromA, _CMP_GE_OQ), _mm256_cmp_pd(BfromM, BfromB, _CMP_GE_OQ));
+
+        // A lane with no maximum has NaN scores. Such cells get the zero default of doAffineAlignment().
+        int filled = _mm256_movemask_pd(_mm256_or_pd(_mm256_or_pd(isDA, isDB), isDM)) &
+          _mm256_movemask_pd(_mm256_or_pd(_mm256_or_pd(isTA, isTB), isTM)) &
+          _mm256_movemask_pd(_mm256_or_pd(_mm256_or_pd(isLA, isLB), isLM));
+        if(filled != 0xF){
+          for(int k = 0; k < 4; k++) fillCell(i+k);
+          continue;
+        }
+
+        // Later blends override earlier ones, the same order as the if-statements of fillAffineCell().
+        __m256d cellM = _mm256_blendv_pd(_mm256_blendv_pd(InsertInA, InsertInB, isDB), Diago, isDM);
+        __m256d cellA = _mm256_blendv_pd(_mm256_blendv_pd(AfromA, AfromB, isTB), AfromM, isTM);
+        __m256d cellB = _mm256_blendv_pd(_mm256_blendv_pd(BfromA, BfromB, isLB), BfromM, isLM);
+        // 2-bit codes of PackedTraceback: 1 + source matrix.
+        __m256d tbM = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_set1_pd(1+A), _mm256_set1_pd(1+B), isDB), _mm256_set1_pd(1+M), isDM);
+        __m256d tbA = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_set1_pd(1+A), _mm256_set1_pd(1+B), isTB), _mm256_set1_pd(1+M), isTM);
+        __m256d tbB = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_set1_pd(1+A), _mm256_set1_pd(1+B), isLB), _mm256_set1_pd(1+M), isLM);
+        __m256d packed = _mm256_add_pd(tbM, _mm256_add_pd(_mm256_mul_pd(tbA, _mm256_set1_pd(4.0)), _mm256_mul_pd(tbB, _mm256_set1_pd(16.0))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(code), _mm256_cvtpd_epi32(packed));
+        _mm256_storeu_pd(&cur[M][i], cellM);
+        _mm256_storeu_pd(&cur[A][i], cellA);
+        _mm256_storeu_pd(&cur[B][i], cellB);
+
+        for(int k = 0; k < 4; k++){
+          int idx = (i+k)*COL_SIZE + d-i-k;
+          obj.M[idx] = cur[M][i+k];
+          obj.A[idx] = cur[A][i+k];
+          obj.B[idx] = cur[B][i+k];
+          obj.packedTraceback[idx] = static_cast<PackedTraceback>(code[k]);
+        }
+      }
+      for(; i <= hi; i++) fillCell(i);
     }
   }
+#endif
 }
 
 
@@ -34,19 +127,15 @@ using namespace Traceback;
 namespace AffineAlignment
 {
 
-// It performs affine alignment on similarity matrix and fills three matrices M, A and B, and corresponding traceback matrices.
-void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, double go, double ge, bool OverlapAlignment){
-  validate(affineAlignObj, s, go, ge);
+namespace {
+// Initializes first row and first column of M, A, B and Traceback for affine alignment.
+void initAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, double go, double ge, bool OverlapAlignment){
   int signalA_len = s.n_row;
   int signalB_len = s.n_col;
   affineAlignObj.FreeEndGaps = OverlapAlignment;
   affineAlignObj.GapOpen = go;
   affineAlignObj.GapExten = ge;
 
-  int Traceback_M_index = 0; // First block of Traceback vector corresponds to M matrix.
-  int Traceback_A_index = 1; // Second block of Traceback vector corresponds to A matrix.
-  int Traceback_B_index = 2; // Third block of Traceback vector corresponds to B matrix.
-
   // Initialize first row and first column for affine alignment.
   double Inf = std::numeric_limits<double>::infinity();
   for(int i = 0; i<=signalA_len; i++){
@@ -55,8 +144,8 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
     // Score of the best alignment between ith character of A and 0th character of B that introduces a gap in A. Not possible, hence, First column of B is initialized with -Inf.
     affineAlignObj.B[i*(signalB_len+1)+0] = -Inf;
     // It is impossible for traceback to reach the cells modified above, however, STOP alignment if it happens.
-    affineAlignObj.Traceback[Traceback_M_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+0] = SS; //STOP
-    affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1)) + i*(signalB_len+1)+0] = SS; //STOP
+    affineAlignObj.setTraceback(M, i, 0, SS); //STOP
+    affineAlignObj.setTraceback(B, i, 0, SS); //STOP
     }
   for(int j = 0; j<=signalB_len; j++){
     // Aligning 0th character of signal A with jth character of signal B without a gap. Not possible, hence, First row of M is initialized with -Inf.
@@ -64,8 +153,8 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
     // Score of the best alignment between 0th character of A and jth character of B that results a gap in B. Not possible, hence, First row of A is initialized with -Inf.
     affineAlignObj.A[0*(signalB_len+1)+j] = -Inf;
     // It is impossible for traceback to reach the cells modified above, however, STOP alignment if it happens.
-    affineAlignObj.Traceback[Traceback_M_index*((signalA_len+1)*(signalB_len+1))+ 0*(signalB_len+1)+j] = SS; //STOP
-    affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ 0*(signalB_len+1)+j] = SS; //STOP
+    affineAlignObj.setTraceback(M, 0, j, SS); //STOP
+    affineAlignObj.setTraceback(A, 0, j, SS); //STOP
     }
   affineAlignObj.M[0*(signalB_len+1)+0] = 0; // Match state (0,0) should have zero to begin the alignment.
 
@@ -77,18 +166,18 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
     // Hence Traceback_matrix_A should have TA for these cells, except for Traceback_matrix_A(1,0). This cell indicates first gap and is reached from M(0,0).
     for(int i = 1; i<=signalA_len; i++){
       affineAlignObj.A[i*(signalB_len+1) + 0] = 0;
-      affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+0] = TA; //TOP A
+      affineAlignObj.setTraceback(A, i, 0, TA); //TOP A
       }
-    affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ 1*(signalB_len+1)+0] = TM; //TOP M
+    affineAlignObj.setTraceback(A, 1, 0, TM); //TOP M
     // For overlap alignment, there is no gap penalty for alignment of zero characters of A to jth characters of B that results a gap in A.
     // Hence, aligning jth character of B to gaps in A without any penalty.
     // Since, consecutive elements of B are aligned to consecutive gaps in A. Therefore, we remain in B matrix for such alignment.
     // Hence Traceback_matrix_B should have LB for these cells, except for Traceback_matrix_B(0,1). This cell indicates first gap and is reached from M(0,0).
     for(int j = 1; j<=signalB_len; j++){
       affineAlignObj.B[0*(signalB_len+1)+j] = 0;
-      affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ 0*(signalB_len+1)+j] = LB; //LEFT B
+      affineAlignObj.setTraceback(B, 0, j, LB); //LEFT B
       }
-    affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ 0*(signalB_len+1)+1] = LM; //LEFT M
+    affineAlignObj.setTraceback(B, 0, 1, LM); //LEFT M
     }
   else {
     // In global alignment, penalty for alignment of ith character of A to 0th characters of B that results a gap in B =
@@ -97,25 +186,47 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
     // Hence Traceback_matrix_A should have TA for these cells.
     for(int i = 1; i<=signalA_len; i++){
       affineAlignObj.A[i*(signalB_len+1) + 0] = -(i-1)*ge - go;
-      affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+0] = TA; //TOP A
+      affineAlignObj.setTraceback(A, i, 0, TA); //TOP A
       }
-    affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ 1*(signalB_len+1)+0] = TM; //TOP M
+    affineAlignObj.setTraceback(A, 1, 0, TM); //TOP M
     // In global alignment, penalty for the alignment of zero characters of A to jth characters of B that results a gap in A =
     // GapOpen + (j-1)*GapExten
     // Since, consecutive elements of B are aligned to consecutive gaps in A. Therefore, we remain in B matrix for such alignment.
     // Hence Traceback_matrix_B should have LB for these cells.
     for(int j = 1; j<=signalB_len; j++){
       affineAlignObj.B[0*(signalB_len+1)+j] = -(j-1)*ge - go;
-      affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ 0*(signalB_len+1)+j] = LB; //LEFT B
+      affineAlignObj.setTraceback(B, 0, j, LB); //LEFT B
       }
-    affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ 0*(signalB_len+1)+1] = LM; //LEFT M
+    affineAlignObj.setTraceback(B, 0, 1, LM); //LEFT M
     }
+}
+} // namespace
+
+// It performs affine alignment on similarity matrix and fills three matrices M, A and B, and corresponding traceback matrices.
+void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, double go, double ge, bool OverlapAlignment, bool useSIMD){
+  validateAffineAlignment("AffineAlignObj", affineAlignObj.signalA_len, affineAlignObj.signalB_len, s, NULL, go, ge);
+  initAffineAlignment(affineAlignObj, s, go, ge, OverlapAlignment);
+  int signalA_len = s.n_row;
+  int signalB_len = s.n_col;
+
+#ifdef DIALIGN_AVX2_KERNEL
+  // Writes along anti-diagonals are strided. Once matrices fall out of cache, the scalar row-by-row loop is faster.
+  if(useSIMD && hasSIMDKernel() && (signalA_len+1)*(signalB_len+1) <= (1 << 20)){
+    // Same recurrence and ties as below, vectorized along anti-diagonals.
+    fillAntiDiagonalsAVX2(affineAlignObj, s, go, ge);
+    return;
+  }
+#endif
 
   // Perform dynamic programming to fill matrix M, A and B for affine alignment
   double Diago, InsertInA, InsertInB;
+  TracebackType tbM, tbA, tbB; // Traceback of the current cell, packed once all three are known.
   for(int i=1; i<=signalA_len; i++){
     for(int j=1; j<=signalB_len; j++){
       // Rcpp::Rcout << s.data[(i-1)*s.n_col + j-1] << std::endl;
+      tbM = SS; tbA = SS; tbB = SS; // Kept if scores are not comparable, e.g. NaN.
+      // Scores are zero if not comparable. Every cell is written, hence, reset() does not clear them.
+      affineAlignObj.M[i*(signalB_len+1)+j] = affineAlignObj.A[i*(signalB_len+1)+j] = affineAlignObj.B[i*(signalB_len+1)+j] = 0.0;
       double sI_1J_1 = s.data[(i-1)*s.n_col + j-1]; // signal Ai is aligned to signal Bj. Hence, it will force match state or diagonal alignment.
       Diago = affineAlignObj.M[(i-1)*(signalB_len+1)+j-1] + sI_1J_1; // M(i-1, j-1) means Ai-1 is aligned to Bj-1.
       InsertInA = affineAlignObj.A[(i-1)*(signalB_len+1)+j-1] + sI_1J_1; // A(i-1, j-1) means Ai-1 is aligned to a gap in B.
@@ -123,17 +234,17 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
       // Calculate recursively for matched state or diagonal alignment
       if(InsertInA>=Diago && InsertInA>=InsertInB){
         // given InsertInA in the last alignment and a diagobal alignment in current step, the traceback will be DA.
-        affineAlignObj.Traceback[Traceback_M_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = DA; // DA: Diagonal TrA
+        tbM = DA; // DA: Diagonal TrA
         affineAlignObj.M[i*(signalB_len+1)+j] = InsertInA;
       }
       if(InsertInB>=Diago && InsertInB>=InsertInA){
         // given InsertInB in the last alignment and a diagobal alignment in current step, the traceback will be DB.
-        affineAlignObj.Traceback[Traceback_M_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = DB; // DB: Diagonal TrB
+        tbM = DB; // DB: Diagonal TrB
         affineAlignObj.M[i*(signalB_len+1)+j] = InsertInB;
       }
       if(Diago>=InsertInA && Diago>=InsertInB){
         // Given that signal Ai-1 is aligned to signal Bj-1, signal Ai is aligned to signal Bj. Hence Traceback_matrix_M = DM.
-        affineAlignObj.Traceback[Traceback_M_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = DM; // DM: Diagonal TrM
+        tbM = DM; // DM: Diagonal TrM
         affineAlignObj.M[i*(signalB_len+1)+j] = Diago;
       }
 
@@ -143,17 +254,17 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
       double AfromB = affineAlignObj.B[(i-1)*(signalB_len+1)+j] - go; // Signal Ai-1 (gap) is aligned to signal Bj. Ai is aligned to a gap in B. So a gap in B is introduced, thus, gap opening penalty is subtracted.
       if(AfromA >= AfromM && AfromA >= AfromB){
         // Given signal Ai is aligned to gap and signal Ai-1 is already aligned to gap, The way to traceback is TA (Top from A to A).
-        affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = TA; // TA: Top TrA
+        tbA = TA; // TA: Top TrA
         affineAlignObj.A[i*(signalB_len+1)+j] = AfromA;
         }
       if(AfromB >= AfromM && AfromB >= AfromA){
         // Given signal Ai is aligned to gap and signal Ai-1 (gap) is aligned to Bj, The way to traceback is TB (Top from A to B).
-        affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = TB; // TB: Top TrB
+        tbA = TB; // TB: Top TrB
         affineAlignObj.A[i*(signalB_len+1)+j] = AfromB;
       }
       if(AfromM >= AfromA && AfromM >= AfromB){
         // Given signal Ai is aligned to gap and signal Ai-1 is aligned to Bj, The way to traceback is TM (Top from A to M).
-        affineAlignObj.Traceback[Traceback_A_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = TM; // TM: Top TrM
+        tbA = TM; // TM: Top TrM
         affineAlignObj.A[i*(signalB_len+1)+j] = AfromM;
       }
 
@@ -163,19 +274,20 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
       double BfromB = affineAlignObj.B[i*(signalB_len+1)+j-1] - ge; // Signal Bj-1 is already aligned to a gap. Because  Bj is aligned to a gap also, so gap extension penalty is subtracted.
       if(BfromA >= BfromM && BfromA >= BfromB){
         // Given signal Bj is aligned to a gap and signal Bj-1 (gap) is aligned to signal Ai, The way to traceback is LA (Left from B to A).
-        affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = LA; // LA: Left TrA
+        tbB = LA; // LA: Left TrA
         affineAlignObj.B[i*(signalB_len+1)+j] = BfromA;
         }
       if(BfromB >= BfromM && BfromB >= BfromA){
         // Given signal Bj is aligned to a gap and signal Bj-1 is already aligned to gap, The way to traceback is LB (Left from B to B).
-        affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = LB; // LB: Left TrB
+        tbB = LB; // LB: Left TrB
         affineAlignObj.B[i*(signalB_len+1)+j] = BfromB;
       }
       if(BfromM >= BfromA && BfromM >= BfromB){
         // Given signal Bj is aligned to gap and signal Ai is aligned to Bj-1, The way to traceback is LM (Left from B to M).
-        affineAlignObj.Traceback[Traceback_B_index*((signalA_len+1)*(signalB_len+1))+ i*(signalB_len+1)+j] = LM; // LM: Left TrM
+        tbB = LM; // LM: Left TrM
         affineAlignObj.B[i*(signalB_len+1)+j] = BfromM;
       }
+      affineAlignObj.packedTraceback[i*(signalB_len+1)+j] = packTraceback(tbM, tbA, tbB);
 
       if(affineAlignObj.M[i*(signalB_len+1)+j]>=affineAlignObj.A[i*(signalB_len+1)+j] &&
          affineAlignObj.M[i*(signalB_len+1)+j]>=affineAlignObj.B[i*(signalB_len+1)+j]){
@@ -190,7 +302,69 @@ void doAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, doubl
     }
 }
 
-void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
+// Fills tiles on the same anti-diagonal concurrently. Cells are filled as in doAffineAlignment(), hence, output is identical.
+void doTiledAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, double go, double ge, bool OverlapAlignment,
+                            int nThreads, int tileSize){
+  validateAffineAlignment("AffineAlignObj", affineAlignObj.signalA_len, affineAlignObj.signalB_len, s, NULL, go, ge);
+  if(tileSize <= 0){
+    throw std::invalid_argument("tileSize must be positive.");
+  }
+  initAffineAlignment(affineAlignObj, s, go, ge, OverlapAlignment);
+  int COL_SIZE = s.n_col+1;
+  int nTileRow = (s.n_row + tileSize - 1)/tileSize;
+  int nTileCol = (s.n_col + tileSize - 1)/tileSize;
+  double* M = affineAlignObj.M;
+  double* A = affineAlignObj.A;
+  double* B = affineAlignObj.B;
+  auto fillTile = [&](int ti, int tj){
+    int iEnd = std::min(s.n_row, (ti+1)*tileSize);
+    int jEnd = std::min(s.n_col, (tj+1)*tileSize);
+    for(int i = ti*tileSize + 1; i <= iEnd; i++){
+      for(int j = tj*tileSize + 1; j <= jEnd; j++){
+        int idx = i*COL_SIZE + j;
+        TracebackType tbM = SS, tbA = SS, tbB = SS;
+        M[idx] = A[idx] = B[idx] = 0.0;
+        fillAffineCell(s.data[(i-1)*s.n_col + j-1], M[idx-COL_SIZE-1], A[idx-COL_SIZE-1], B[idx-COL_SIZE-1],
+                       M[idx-COL_SIZE], A[idx-COL_SIZE], B[idx-COL_SIZE], M[idx-1], A[idx-1], B[idx-1],
+                       go, ge, M[idx], A[idx], B[idx], tbM, tbA, tbB);
+        affineAlignObj.packedTraceback[idx] = packTraceback(tbM, tbA, tbB);
+      }
+    }
+  };
+  // No anti-diagonal has more tiles than this, hence, extra threads would only wait at the barrier.
+  int nWorkers = std::max(1, std::min(nThreads, std::min(nTileRow, nTileCol)));
+  Utils::Barrier barrier(nWorkers);
+  // Workers are started once. As many tasks as threads are handed out, hence, each worker runs on its own thread.
+  Utils::parallelFor(nWorkers, nWorkers, [&](int w){
+    // A tile needs its top, left and top-left tiles, which are all on earlier anti-diagonals of tiles.
+    for(int d = 0; d < nTileRow + nTileCol - 1; d++){
+      int tileLo = std::max(0, d - nTileCol + 1);
+      int tileHi = std::min(nTileRow - 1, d);
+      for(int ti = tileLo + w; ti <= tileHi; ti += nWorkers) fillTile(ti, d - ti);
+      barrier.wait();
+    }
+  });
+}
+
+bool hasSIMDKernel(){
+#ifdef DIALIGN_AVX2_KERNEL
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth, AlignOutput output, const SimMatrix* s){
+  bool keepScore = (output != AlignOutput::indices);
+  bool keepPath = (output == AlignOutput::medium || output == AlignOutput::heavy);
+  bool keepSim = (output == AlignOutput::heavy);
+  if(keepPath && !affineAlignObj.Path){
+    throw std::invalid_argument("Path matrix is not allocated for this output.");
+  }
+  if(keepSim && !s){
+    throw std::invalid_argument("Similarity matrix is needed for simScore_forw.");
+  }
   AlignedIndices alignedIdx; // initialize empty struct.
   TracebackType TracebackPointer;
   tbJump MatName; // Matrix name M = 0, A = 1 or B = 2
@@ -199,6 +373,12 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
   int COL_IDX = affineAlignObj.signalB_len;
   int ROW_SIZE = (affineAlignObj.signalA_len)+1;
   int COL_SIZE = (affineAlignObj.signalB_len)+1;
+  std::vector<std::pair<int, int> > pathCells; // Only kept for simScore_forw.
+  // Cells on the alignment path are marked only for the outputs that need them.
+  auto markPath = [&](int i, int j){
+    if(keepPath) affineAlignObj.Path[i*COL_SIZE+j] = true;
+    if(keepSim) pathCells.push_back(std::make_pair(i, j));
+  };
 
   if(affineAlignObj.FreeEndGaps == true){
     /// Overlap Alignment
@@ -211,9 +391,8 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       for (int i = affineAlignObj.signalA_len; i>ROW_IDX; i--){
         alignedIdx.indexA_aligned.push_back(i);
         alignedIdx.indexB_aligned.push_back(NA); // Insert NA in signalB.
-        alignedIdx.score.push_back(affineAlignmentScore); // Insert maxScore instead of score from the matrix M.
+        if(keepScore) alignedIdx.score.push_back(affineAlignmentScore); // Insert maxScore instead of score from the matrix M.
         //affineAlignObj.Path[i*COL_SIZE+COL_IDX] = true;
-        //fillSimPath(affineAlignObj.simPath, bandwidth, i, COL_IDX, ROW_SIZE, COL_SIZE);
         }
       }
     else if (COL_IDX != affineAlignObj.signalB_len){
@@ -221,36 +400,26 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       for (int j = affineAlignObj.signalB_len; j>COL_IDX; j--){
         alignedIdx.indexA_aligned.push_back(NA); // Insert NA in signalA.
         alignedIdx.indexB_aligned.push_back(j);
-        alignedIdx.score.push_back(affineAlignmentScore); // Insert maxScore instead of score from the matrix M.
+        if(keepScore) alignedIdx.score.push_back(affineAlignmentScore); // Insert maxScore instead of score from the matrix M.
         //affineAlignObj.Path[ROW_IDX*COL_SIZE+j] = true;
-        //fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, j, ROW_SIZE, COL_SIZE);
         }
       }
     }
   else {
     // Global Alignment, traceback starts at the bottom-right corner.
     // Search for the matrix which has the highest score at bottom-right corner.
-    double Mscore = affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX];
-    double Ascore = affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX];
-    double Bscore = affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX];
-    if (Mscore >= Ascore && Mscore >= Bscore){
-      affineAlignmentScore = Mscore;
-      MatName = M;
-      }
-    else if(Ascore >= Mscore && Ascore>= Bscore) {
-      affineAlignmentScore = Ascore;
-      MatName = A;
-      }
-    else {
-      affineAlignmentScore = Bscore;
-      MatName = B;
-      }
+    auto getScore = [&](tbJump Mat, int i, int j){
+      const double* Matrix = (Mat == M) ? affineAlignObj.M : ((Mat == A) ? affineAlignObj.A : affineAlignObj.B);
+      return Matrix[i*COL_SIZE+j];
+    };
+    PathCell start;
+    affineAlignmentScore = getAffineStartCell(affineAlignObj.signalA_len, affineAlignObj.signalB_len, false, getScore, start);
+    MatName = start.MatName;
     }
 
-  alignedIdx.score.push_back(affineAlignmentScore);
-  TracebackPointer = affineAlignObj.Traceback[MatName*ROW_SIZE*COL_SIZE+ROW_IDX*COL_SIZE+COL_IDX];
-  affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-  fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+  if(keepScore) alignedIdx.score.push_back(affineAlignmentScore);
+  TracebackPointer = affineAlignObj.getTraceback(MatName, ROW_IDX, COL_IDX);
+  markPath(ROW_IDX, COL_IDX);
   // Traceback path and align row indices to column indices.
 
   while(TracebackPointer != SS){
@@ -267,9 +436,8 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       ROW_IDX = ROW_IDX-1;
       COL_IDX = COL_IDX-1;
       MatName = M;
-      alignedIdx.score.push_back(affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX]);
-      affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-      fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX]);
+      markPath(ROW_IDX, COL_IDX);
       break;}
 
     case DA:
@@ -279,9 +447,8 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       ROW_IDX = ROW_IDX-1;
       COL_IDX = COL_IDX-1;
       MatName = A;
-      alignedIdx.score.push_back(affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX]);
-      affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-      fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX]);
+      markPath(ROW_IDX, COL_IDX);
       break;}
 
     case DB:
@@ -291,9 +458,8 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       ROW_IDX = ROW_IDX-1;
       COL_IDX = COL_IDX-1;
       MatName = B;
-      alignedIdx.score.push_back(affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX]);
-      affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-      fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX]);
+      markPath(ROW_IDX, COL_IDX);
       break;}
 
     case TM:
@@ -302,16 +468,14 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       alignedIdx.indexB_aligned.push_back(NA);
       ROW_IDX = ROW_IDX-1;
       MatName = M;
-      alignedIdx.score.push_back(affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX]);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX]);
       if(COL_IDX != 0){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       else if(!affineAlignObj.FreeEndGaps){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       break;}
 
@@ -321,16 +485,14 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       alignedIdx.indexB_aligned.push_back(NA);
       ROW_IDX = ROW_IDX-1;
       MatName = A;
-      alignedIdx.score.push_back(affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX]);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX]);
       if(COL_IDX != 0){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       else if(!affineAlignObj.FreeEndGaps){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       break;}
 
@@ -340,16 +502,14 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       alignedIdx.indexB_aligned.push_back(NA);
       ROW_IDX = ROW_IDX-1;
       MatName = B;
-      alignedIdx.score.push_back(affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX]);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX]);
       if(COL_IDX != 0){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       else if(!affineAlignObj.FreeEndGaps){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       break;}
 
@@ -359,16 +519,14 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       alignedIdx.indexB_aligned.push_back(COL_IDX);
       COL_IDX = COL_IDX-1;
       MatName = M;
-      alignedIdx.score.push_back(affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX]);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.M[ROW_IDX*COL_SIZE+COL_IDX]);
       if(ROW_IDX != 0){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       else if(!affineAlignObj.FreeEndGaps){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       break;
       }
@@ -379,16 +537,14 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       alignedIdx.indexB_aligned.push_back(COL_IDX);
       COL_IDX = COL_IDX-1;
       MatName = A;
-      alignedIdx.score.push_back(affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX]);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.A[ROW_IDX*COL_SIZE+COL_IDX]);
       if(ROW_IDX != 0){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       else if(!affineAlignObj.FreeEndGaps){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       break;}
 
@@ -398,16 +554,14 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       alignedIdx.indexB_aligned.push_back(COL_IDX);
       COL_IDX = COL_IDX-1;
       MatName = B;
-      alignedIdx.score.push_back(affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX]);
+      if(keepScore) alignedIdx.score.push_back(affineAlignObj.B[ROW_IDX*COL_SIZE+COL_IDX]);
       if(ROW_IDX != 0){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       else if(!affineAlignObj.FreeEndGaps){
         affineAlignObj.nGaps += 1;
-        affineAlignObj.Path[ROW_IDX*COL_SIZE+COL_IDX] = true;
-        fillSimPath(affineAlignObj.simPath, bandwidth, ROW_IDX, COL_IDX, ROW_SIZE, COL_SIZE);
+        markPath(ROW_IDX, COL_IDX);
       }
       break;}
 
@@ -415,99 +569,70 @@ void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth){
       break;
     }
     // Read traceback for the next iteration.
-    TracebackPointer = affineAlignObj.Traceback[MatName*ROW_SIZE*COL_SIZE+ROW_IDX*COL_SIZE+COL_IDX];
+    TracebackPointer = affineAlignObj.getTraceback(MatName, ROW_IDX, COL_IDX);
   }
   // push_back adds values at the end of vector, therefore, reverse the vector.
   std::reverse(std::begin(alignedIdx.indexA_aligned), std::end(alignedIdx.indexA_aligned));
   std::reverse(std::begin(alignedIdx.indexB_aligned), std::end(alignedIdx.indexB_aligned));
-  std::reverse(std::begin(alignedIdx.score), std::end(alignedIdx.score));
-  // remove the first index, since the score-traceback is ahead of aligned indices.
-  alignedIdx.score.erase(alignedIdx.score.begin());
+  if(keepScore){
+    std::reverse(std::begin(alignedIdx.score), std::end(alignedIdx.score));
+    // remove the first index, since the score-traceback is ahead of aligned indices.
+    alignedIdx.score.erase(alignedIdx.score.begin());
+  }
   // Copy aligned indices to alignObj.
   affineAlignObj.indexA_aligned = alignedIdx.indexA_aligned;
   affineAlignObj.indexB_aligned = alignedIdx.indexB_aligned;
   affineAlignObj.score = alignedIdx.score;
+  if(keepSim) affineAlignObj.simScore_forw = getForwardSim(*s, pathCells, bandwidth);
   //return;
 }
 
 // It finds start indices and matrix for tracebackin in case of overlap affine alignment.
 double getOlapAffineAlignStartIndices(double* MatrixM, double* MatrixA, double* MatrixB, int ROW_SIZE, int COL_SIZE, int &OlapStartRow, int &OlapStartCol, tbJump &MatrixName){
-  double maxScore = -std::numeric_limits<double>::infinity(); //- Inf
-  int MaxRowIndex, MaxColIndex;
-  for(int i = 0; i < ROW_SIZE; i++){
-    if(MatrixM[i*COL_SIZE+COL_SIZE-1] >= maxScore){
-      // Search the maximum score along the last column of M matrix
-      MaxRowIndex = i;
-      MaxColIndex = COL_SIZE-1;
-      MatrixName = M;
-      maxScore = MatrixM[i*COL_SIZE+COL_SIZE-1];
-    }
-    else if(MatrixA[i*COL_SIZE+COL_SIZE-1] >= maxScore){
-      // Search the maximum score along the last column of A matrix
-      MaxRowIndex = i;
-      MaxColIndex = COL_SIZE-1;
-      MatrixName = A;
-      maxScore = MatrixA[i*COL_SIZE+COL_SIZE-1];
-      }
-    else if(MatrixB[i*COL_SIZE+COL_SIZE-1] >= maxScore){
-      // Search the maximum score along the last column of B matrix
-      MaxRowIndex = i;
-      MaxColIndex = COL_SIZE-1;
-      MatrixName = B;
-      maxScore = MatrixB[i*COL_SIZE+COL_SIZE-1];
-      }
-    }
-  for (int j = 0; j < COL_SIZE; j++){
-    if(MatrixM[(ROW_SIZE-1)*COL_SIZE+j] >= maxScore){
-      // Search the maximum score along the last row of M matrix
-      MaxRowIndex = ROW_SIZE-1;
-      MaxColIndex = j;
-      MatrixName = M;
-      maxScore = MatrixM[(ROW_SIZE-1)*COL_SIZE+j];
-      }
-    else if(MatrixA[(ROW_SIZE-1)*COL_SIZE+j] >= maxScore){
-      // Search the maximum score along the last row of A matrix
-      MaxRowIndex = ROW_SIZE-1;
-      MaxColIndex = j;
-      MatrixName = A;
-      maxScore = MatrixA[(ROW_SIZE-1)*COL_SIZE+j];
-      }
-    else if(MatrixB[(ROW_SIZE-1)*COL_SIZE+j] >= maxScore){
-      // Search the maximum score along the last row of B matrix
-      MaxRowIndex = ROW_SIZE-1;
-      MaxColIndex = j;
-      MatrixName = B;
-      maxScore = MatrixB[(ROW_SIZE-1)*COL_SIZE+j];
-      }
-    }
+  auto getScore = [&](tbJump MatName, int i, int j){
+    const double* Matrix = (MatName == M) ? MatrixM : ((MatName == A) ? MatrixA : MatrixB);
+    return Matrix[i*COL_SIZE+j];
+  };
+  PathCell start;
+  double maxScore = getAffineStartCell(ROW_SIZE-1, COL_SIZE-1, true, getScore, start);
   // Copy max-score indices to pass-by-reference variables
-  OlapStartRow = MaxRowIndex;
-  OlapStartCol = MaxColIndex;
+  OlapStartRow = start.i;
+  OlapStartCol = start.j;
+  MatrixName = start.MatName;
   return maxScore;
 }
 
-void fillSimPath(bool* simPath, int bandwidth, int ROW_IDX, int COL_IDX, int ROW_SIZE, int COL_SIZE){
-  for (int i = ROW_IDX-bandwidth; i<=ROW_IDX+bandwidth; i++){
-    if(i>=0 && i<ROW_SIZE){
-      simPath[i*COL_SIZE+COL_IDX] = true;
-    }
-  }
-  for (int j = COL_IDX-bandwidth; j<=COL_IDX+bandwidth; j++){
-    if(j>=0 && j<COL_SIZE){
-      simPath[ROW_IDX*COL_SIZE+j] = true;
-    }
-  }
-}
-
-double getForwardSim(const SimMatrix& s, bool* simPath){
+double getForwardSim(const SimMatrix& s, const std::vector<std::pair<int, int> >& pathCells, int bandwidth){
+  std::vector<std::pair<int, int> > cells(pathCells);
+  std::sort(cells.begin(), cells.end()); // Row-wise, so that cells within bandwidth of a row are a sliding window.
+  std::vector<bool> marked(s.n_col+1, false);
+  std::vector<int> cols; // Marked columns of the current row.
   double forwardSim = 0;
-  int COL_SIZE = s.n_col+1;
-  for(int i=0; i<s.n_row; i++){
-    for(int j=0; j<s.n_col; j++){
-      if(simPath[(i+1)*COL_SIZE+(j+1)]){
-        forwardSim += s.data[i*s.n_col + j];
+  std::size_t lo = 0, hi = 0;
+  for(int i = 1; i <= s.n_row; i++){
+    while(lo < cells.size() && cells[lo].first < i - bandwidth) lo++;
+    while(hi < cells.size() && cells[hi].first <= i + bandwidth) hi++;
+    for(std::size_t k = lo; k < hi; k++){
+      // A path cell marks its column within bandwidth rows, and its row within bandwidth columns.
+      int jStart = cells[k].second, jEnd = cells[k].second;
+      if(cells[k].first == i){
+        jStart = std::max(0, jStart - bandwidth);
+        jEnd = std::min(s.n_col, jEnd + bandwidth);
+      }
+      for(int j = jStart; j <= jEnd; j++){
+        if(!marked[j]){
+          marked[j] = true;
+          cols.push_back(j);
+        }
       }
     }
+    // Sum in the order of columns, same as summing over a simPath matrix.
+    std::sort(cols.begin(), cols.end());
+    for(int j : cols){
+      if(j > 0) forwardSim += s.data[(i-1)*s.n_col + j-1];
+      marked[j] = false;
+    }
+    cols.clear();
   }
   return forwardSim;
 }
@@ -6,6 +6,7 @@
 #include "utils.h"
 #include "similarityMatrix.h"
 #include <limits>
+#include <utility>
 
 /**
  * @namespace DIAlign
@@ -30,9 +31,32 @@ namespace AffineAlignment
  * @param go gap opening penalty in alignment path.
  * @param ge gap extension penalty in alignment path.
  * @param OverlapAlignment If true, end gaps are not penalized. For a global-alignment, OverlapAlignment is set false which penalizes end-gaps as regular gaps.
+ * @param useSIMD If true and hasSIMDKernel(), matrices up to 2^20 cells are filled along anti-diagonals with AVX2. Scores and Traceback are identical to the scalar loop.
  *
  */
-void doAffineAlignment(AffineAlignObj&, const SimMatrix& s, double go, double ge, bool OverlapAlignment);
+void doAffineAlignment(AffineAlignObj&, const SimMatrix& s, double go, double ge, bool OverlapAlignment, bool useSIMD = true);
+
+/// Returns true if this CPU can run the AVX2 kernels of doAffineAlignment() and fillAffineRow(). It is checked at runtime.
+bool hasSIMDKernel();
+
+/**
+ * @brief Performs affine alignment as doAffineAlignment(), filling square tiles of M, A and B on several threads.
+ *
+ * A tile depends only on its top, left and top-left neighbours. Hence, tiles on the same anti-diagonal of tiles are
+ * filled concurrently, and anti-diagonals are filled one after the other. Worker threads are started once and wait
+ * at a Utils::Barrier after each anti-diagonal. Each cell is filled with fillAffineCell(), hence, M, A, B and Traceback
+ * are identical to doAffineAlignment(). It pays off only for very large matrices.
+ *
+ * @param affineAlignObj An object of class AffineAlignObj. It must be initialized with appropriate ROW_SIZE and COL_SIZE.
+ * @param s similarity score matrix must be of size (ROW_SIZE - 1) * (COL_SIZE - 1).
+ * @param go gap opening penalty in alignment path.
+ * @param ge gap extension penalty in alignment path.
+ * @param OverlapAlignment If true, end gaps are not penalized.
+ * @param nThreads Number of threads, including the calling thread.
+ * @param tileSize Number of rows and columns in a tile.
+ */
+void doTiledAffineAlignment(AffineAlignObj& affineAlignObj, const SimMatrix& s, double go, double ge, bool OverlapAlignment,
+                            int nThreads, int tileSize = 256);
 
 /**
  * @brief Calculates aligned indices for source signal A and B, additionaly, builds an alignment path matrix with true-hot encoding.
@@ -42,11 +66,16 @@ void doAffineAlignment(AffineAlignObj&, const SimMatrix& s, double go, double ge
  * last column and row of the matrices are searched for the highest score cell.
  * After identifying highest-score cell, Traceback is used to find the path. Simultaneously, number of gaps are
  * calculated and path matrix is filled with true-hot encoding.
+ * Only the outputs that are needed are built. Aligned indices and nGaps are always calculated, score is skipped for
+ * AlignOutput::indices, Path is filled only for medium and heavy, and simScore_forw only for heavy.
  *
  * @param affineAlignObj An object of class AffineAlignObj. Must have been operated by doAffineAlignment() function before.
- * @param bandwidth Not needed. Will be removed.
+ * @param bandwidth Half-width of the band around the path that is summed for simScore_forw.
+ * @param output Outputs that are needed. For medium and heavy, affineAlignObj must have Path allocated.
+ * @param s similarity score matrix passed to doAffineAlignment(). Needed only for AlignOutput::heavy.
  */
-void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth = 0);
+void getAffineAlignedIndices(AffineAlignObj &affineAlignObj, int bandwidth = 0, AlignOutput output = AlignOutput::medium,
+                             const SimMatrix* s = NULL);
 
 /**
  * @brief Calculates the start indices and matrix for the alignment path and returns associated score.
@@ -70,16 +99,43 @@ double getOlapAffineAlignStartIndices(double* MatrixM, double* MatrixA, double*
                                       int &OlapStartCol, Traceback::tbJump &MatrixName);
 
 /**
- * @brief Not needed will be removed.
+ * @brief Sums similarity of the cells within bandwidth of the alignment path, along rows and columns of path cells.
  *
+ * Each cell is counted once. It is calculated from the path cells, hence, a matrix of marked cells is not needed.
+ * @param s similarity score matrix.
+ * @param pathCells (row, column) of path cells in matrix M, i.e. one more than the index of s.
+ * @param bandwidth Half-width of the band around each path cell.
  */
-void fillSimPath(bool* simPath, int bandwidth, int ROW_IDX, int COL_IDX, int ROW_SIZE, int COL_SIZE);
+double getForwardSim(const SimMatrix& s, const std::vector<std::pair<int, int> >& pathCells, int bandwidth);
 
 /**
- * @brief Not needed will be removed.
+ * @brief Fills one cell of M, A and B from its diagonal, top and left neighbours.
  *
+ * Ties are resolved exactly as in doAffineAlignment(): a later comparison overrides an earlier one, hence
+ * M prefers DM > DB > DA, A prefers TM > TB > TA and B prefers LM > LB > LA. If none of the comparisons holds (NaN scores),
+ * the outputs are left untouched.
+ * Alternative alignment engines use this function so that they pick the same path as doAffineAlignment().
  */
-double getForwardSim(const SimMatrix& s, bool* simPath);
+inline void fillAffineCell(double sij, double diagM, double diagA, double diagB,
+                           double topM, double topA, double topB,
+                           double leftM, double leftA, double leftB, double go, double ge,
+                           double& cellM, double& cellA, double& cellB,
+                           Traceback::TracebackType& tbM, Traceback::TracebackType& tbA, Traceback::TracebackType& tbB){
+  double Diago = diagM + sij, InsertInA = diagA + sij, InsertInB = diagB + sij;
+  if(InsertInA>=Diago && InsertInA>=InsertInB){tbM = Traceback::DA; cellM = InsertInA;}
+  if(InsertInB>=Diago && InsertInB>=InsertInA){tbM = Traceback::DB; cellM = InsertInB;}
+  if(Diago>=InsertInA && Diago>=InsertInB){tbM = Traceback::DM; cellM = Diago;}
+
+  double AfromM = topM - go, AfromA = topA - ge, AfromB = topB - go;
+  if(AfromA >= AfromM && AfromA >= AfromB){tbA = Traceback::TA; cellA = AfromA;}
+  if(AfromB >= AfromM && AfromB >= AfromA){tbA = Traceback::TB; cellA = AfromB;}
+  if(AfromM >= AfromA && AfromM >= AfromB){tbA = Traceback::TM; cellA = AfromM;}
+
+  double BfromM = leftM - go, BfromA = leftA - go, BfromB = leftB - ge;
+  if(BfromA >= BfromM && BfromA >= BfromB){tbB = Traceback::LA; cellB = BfromA;}
+  if(BfromB >= BfromM && BfromB >= BfromA){tbB = Traceback::LB; cellB = BfromB;}
+  if(BfromM >= BfromA && BfromM >= BfromB){tbB = Traceback::LM; cellB = BfromM;}
+}
 } // namespace AffineAlignment
 } // namespace DIAlign
 
@@ -1,4 +1,6 @@
 #include "affinealignobj.h"
+#include <map>
+#include <utility>
 
 namespace DIAlign 
 {
@@ -35,5 +37,99 @@ std::vector<char> EnumToChar(std::vector<TracebackType> v) {
   return nv;
 }
 
+// This function expands packed traceback to characters.
+std::vector<char> EnumToChar(const PackedTraceback* v, int n) {
+  std::vector<char> nv(3*n);
+  for (int MatName = M; MatName <= B; MatName++){
+    for (int k = 0; k < n; k++) nv[MatName*n + k] = unpackTraceback(v[k], static_cast<tbJump>(MatName)) + 48;
+  }
+  return nv;
+}
+
 } // namespace Traceback
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Capacity of a size-class: next power of two of len, at least 64.
+  int sizeClass(int len){
+    int capacity = 64;
+    while(capacity < len) capacity *= 2;
+    return capacity;
+  }
+
+  // Idle objects of one thread, keyed by capacity of signal A and B.
+  struct AffineAlignObjPool
+  {
+    std::map<std::pair<int, int>, std::vector<AffineAlignObj*> > idle;
+    std::size_t bytes = 0; // Allocated by the idle objects.
+
+    ~AffineAlignObjPool(){
+      clear();
+    }
+
+    std::size_t clear(){
+      for(auto& bucket : idle){
+        for(AffineAlignObj* obj : bucket.second) delete obj;
+      }
+      idle.clear();
+      std::size_t freed = bytes;
+      bytes = 0;
+      return freed;
+    }
+  };
+
+  AffineAlignObjPool& threadPool(){
+    thread_local AffineAlignObjPool pool;
+    return pool;
+  }
+}
+
+PooledAffineAlignObj::PooledAffineAlignObj(int ROW_SIZE, int COL_SIZE, AlignOutput output){
+  int capacityA = sizeClass(ROW_SIZE-1), capacityB = sizeClass(COL_SIZE-1);
+  if(AffineAlignObj::matrixBytes(capacityA, capacityB) > maxPooledBytes){
+    // Too large to be kept, exact size is allocated.
+    obj_ = new AffineAlignObj(ROW_SIZE, COL_SIZE, true, output);
+    return;
+  }
+  AffineAlignObjPool& pool = threadPool();
+  std::vector<AffineAlignObj*>& bucket = pool.idle[std::make_pair(capacityA, capacityB)];
+  if(bucket.empty()){
+    obj_ = new AffineAlignObj(capacityA+1, capacityB+1, false, output);
+  } else {
+    obj_ = bucket.back();
+    bucket.pop_back();
+    pool.bytes -= obj_->allocatedBytes();
+  }
+  obj_->reset(ROW_SIZE, COL_SIZE, output);
+}
+
+PooledAffineAlignObj::~PooledAffineAlignObj(){
+  int capacityA = obj_->getRowCapacity()-1, capacityB = obj_->getColCapacity()-1;
+  if(capacityA == sizeClass(capacityA) && capacityB == sizeClass(capacityB)){
+    AffineAlignObjPool& pool = threadPool();
+    std::vector<AffineAlignObj*>& bucket = pool.idle[std::make_pair(capacityA, capacityB)];
+    std::size_t bytes = obj_->allocatedBytes();
+    if(bucket.size() < maxPooledPerClass && pool.bytes + bytes <= maxPooledBytes){
+      bucket.push_back(obj_);
+      pool.bytes += bytes;
+      return;
+    }
+  }
+  delete obj_;
+}
+
+std::size_t PooledAffineAlignObj::idleCount(){
+  std::size_t n = 0;
+  for(const auto& bucket : threadPool().idle) n += bucket.second.size();
+  return n;
+}
+
+std::size_t PooledAffineAlignObj::idleBytes(){
+  return threadPool().bytes;
+}
+
+std::size_t PooledAffineAlignObj::clear(){
+  return threadPool().clear();
+}
+
 } // namespace DIAlign
@@ -5,6 +5,7 @@
 #include <cstring>
 #include <vector>
 #include <algorithm>
+#include <cstddef>
 
 /**
  * @namespace DIAlign
@@ -31,13 +32,49 @@ std::ostream& operator<<(std::ostream& out, const TracebackType value);
 
 /// This function converts TracebackType Enum to characters.
 std::vector<char> EnumToChar(std::vector<TracebackType> v);
+
+/**
+ * @brief Traceback of matrices M, A and B at one cell, packed in a byte.
+ *
+ * Bits (2*MatName, 2*MatName+1) keep the source matrix of MatName: 0 for SS, otherwise 1 + source matrix.
+ * Arrow direction is implied by MatName: diagonal for M, top for A and left for B.
+ */
+typedef unsigned char PackedTraceback;
+
+/// Returns the 2-bit code of a TracebackType. It does not keep the arrow direction.
+inline unsigned char packTraceback(TracebackType tb){
+  return (tb == SS) ? 0 : (tb - 1) % 3 + 1;
+}
+
+/// Packs the traceback of matrices M, A and B at one cell.
+inline PackedTraceback packTraceback(TracebackType tbM, TracebackType tbA, TracebackType tbB){
+  return packTraceback(tbM) | (packTraceback(tbA) << 2) | (packTraceback(tbB) << 4);
+}
+
+/// Returns TracebackType of matrix MatName from a packed cell.
+inline TracebackType unpackTraceback(PackedTraceback cell, tbJump MatName){
+  unsigned char code = (cell >> (2*MatName)) & 3;
+  return (code == 0) ? SS : static_cast<TracebackType>(3*MatName + code);
+}
+
+/// This function expands n packed cells to characters in three blocks (M, A, B), same as EnumToChar() of unpacked traceback.
+std::vector<char> EnumToChar(const PackedTraceback* v, int n);
 }
 
+/**
+ * @brief Outputs that are needed from an AffineAlignObj. light, medium and heavy are the same as objType of alignChromatogramsCpp().
+ *
+ * indices: aligned indices and nGaps. light: indices and score. medium: light and Path. heavy: medium, s_data and simScore_forw.
+ * Buffers that an output level does not need are not allocated, their pointers are NULL.
+ */
+enum class AlignOutput {indices, light, medium, heavy};
+
 /**
  * @brief An affine alignment object.
  *
  * This object contains similarity matrix, three matrices M, A and B storing cumulative-scores for dynamic programming.
  * Traceback matrices store source matrix name and direction as matrices are filled with dynamic programming.
+ * They are packed in one byte per cell, i.e. 2 bits for each of M, A and B.
  * Path matrix encode alignment path that results in the highest cumulative score.
  * The aligned indices are also stored for signal A and signal B.
  */
@@ -48,13 +85,12 @@ private:
   int signalB_capacity; ///< Capacity of matrix for signal B (columns).
 
 public:
-  double* s_data; ///< similarity score matrix.
+  double* s_data; ///< similarity score matrix. NULL unless output is AlignOutput::heavy.
   double* M; ///< Match or Mismatch matrix, residues of A and B are aligned without a gap. M(i,j) = Best score upto (i,j) given Ai is aligned to Bj.
   double* A; ///< Insert in sequence A, residue in A is aligned to gap in B. A(i,j) is the best score given that Ai is aligned to a gap in B.
   double* B; ///< Insert in sequence B, residue in B is aligned to gap in A. B(i,j) is the best score given that Bj is aligned to a gap in A.
-  Traceback::TracebackType* Traceback; ///< Traceback matrices store source matrix name and direction as matrices are filled with dynamic programming.
-  bool* Path; ///< Path matrix would represent alignment path through similarity matrix as binary-hot encoding.
-  bool* simPath; ///< Not needed, will be removed.
+  Traceback::PackedTraceback* packedTraceback; ///< Traceback of M, A and B packed in one byte per cell. Use getTraceback() and setTraceback().
+  bool* Path; ///< Path matrix would represent alignment path through similarity matrix as binary-hot encoding. NULL for AlignOutput::indices and light.
   // s_data, M, A and B should be private. Now there is a possibility of memory-leak.
   // TODO Make above variables private.
   int signalA_len; ///< Number of data-points in signal A.
@@ -66,33 +102,28 @@ public:
   std::vector<int> indexB_aligned; ///< Aligned signalB indices after affine alignment.
   std::vector<double> score;  ///< Cumulative score along the aligned path.
   int nGaps; ///< Total number of gaps in the alignment path.
+  double simScore_forw; ///< Sum of similarity of cells within a bandwidth of the alignment path. Calculated only for AlignOutput::heavy.
 
   /**
    * @brief Constructor for AffineAlignObj.
    *
-   * Allocates memory for s_data, M, A, B, Traceback, Path matrices. Initialize them with zero if clearMemory is set true.
+   * Allocates memory for M, A, B, Traceback and the matrices that output needs. Initialize them with zero if clearMemory is set true.
    * @param ROW_SIZE Number of rows in matrix M.
    * @param COL_SIZE Number of columns in matrix M.
    * @param clearMemory If true, matrices are initialized with zero.
+   * @param output Outputs that are needed from this object.
    */
   // Not a default constructor
-  AffineAlignObj(int ROW_SIZE, int COL_SIZE, bool clearMemory = true)
+  AffineAlignObj(int ROW_SIZE, int COL_SIZE, bool clearMemory = true, AlignOutput output = AlignOutput::heavy)
+    : s_data(NULL), M(NULL), A(NULL), B(NULL), packedTraceback(NULL), Path(NULL)
   {
+    signalA_capacity = ROW_SIZE-1;
+    signalB_capacity = COL_SIZE-1;
     allocateMemory_(ROW_SIZE, COL_SIZE);
+    allocateOutput_(output);
 
     // clearMemory means having default zero values.
-    // We could use a for-loop but memset is faster for contiguous location in memory.
-    // It makes byte value = unsigned(int_0)
-    if (clearMemory)
-    {
-      std::memset(s_data, 0, (ROW_SIZE -1) * (COL_SIZE-1) * sizeof(double));
-      std::memset(M, 0, ROW_SIZE * COL_SIZE * sizeof(double));
-      std::memset(A, 0, ROW_SIZE * COL_SIZE * sizeof(double));
-      std::memset(B, 0, ROW_SIZE * COL_SIZE * sizeof(double));
-      std::memset(Traceback, Traceback::SS, 3 * ROW_SIZE * COL_SIZE * sizeof(Traceback::TracebackType));
-      std::memset(Path, 0, ROW_SIZE * COL_SIZE * sizeof(bool));
-      std::memset(simPath, 0, ROW_SIZE * COL_SIZE * sizeof(bool));
-    }
+    if (clearMemory) clearMemory_(ROW_SIZE, COL_SIZE);
 
     signalA_len = ROW_SIZE-1;
     signalB_len = COL_SIZE-1;
@@ -100,13 +131,22 @@ public:
     GapExten = 0.0;
     FreeEndGaps = true;
     nGaps = 0;
-
-    signalA_capacity = ROW_SIZE-1;
-    signalB_capacity = COL_SIZE-1;
+    simScore_forw = 0.0;
   }
 
   /// Reset object to initial state (without allocating new memory)
   void reset(int ROW_SIZE, int COL_SIZE)
+  {
+    reset(ROW_SIZE, COL_SIZE, getOutput());
+  }
+
+  /**
+   * @brief Reset object to initial state for output. Only matrices that output needs and are not there yet are allocated.
+   *
+   * Only the first row and column of M, A, B and Traceback are set to zero, since doAffineAlignment() overwrites every other cell.
+   * Path and s_data are not overwritten by the alignment, hence, they are cleared completely.
+   */
+  void reset(int ROW_SIZE, int COL_SIZE, AlignOutput output)
   {
     if (ROW_SIZE -1 > signalA_capacity || COL_SIZE -1 > signalB_capacity)
     {
@@ -114,16 +154,10 @@ public:
       //std::cout << ROW_SIZE << " vs " << signalA_capacity << std::endl;
       throw 1;
     }
+    allocateOutput_(output);
 
-    // resetting all values to zero.
-    // We could use a for-loop but memset is faster for contiguous location in memory.
-    std::memset(s_data, 0, (ROW_SIZE -1) * (COL_SIZE-1) * sizeof(double));
-    std::memset(M, 0, ROW_SIZE * COL_SIZE * sizeof(double));
-    std::memset(A, 0, ROW_SIZE * COL_SIZE * sizeof(double));
-    std::memset(B, 0, ROW_SIZE * COL_SIZE * sizeof(double));
-    std::memset(Traceback, Traceback::SS, 3 * ROW_SIZE * COL_SIZE * sizeof(Traceback::TracebackType));
-    std::memset(Path, 0, ROW_SIZE * COL_SIZE * sizeof(bool));
-    std::memset(simPath, 0, ROW_SIZE * COL_SIZE * sizeof(bool));
+    // resetting values to zero that the alignment does not overwrite.
+    clearBoundary_(ROW_SIZE, COL_SIZE);
 
     signalA_len = ROW_SIZE-1;
     signalB_len = COL_SIZE-1;
@@ -134,6 +168,47 @@ public:
     indexB_aligned.clear();
     score.clear();
     nGaps = 0;
+    simScore_forw = 0.0;
+  }
+
+  /// Outputs that this object has memory for.
+  AlignOutput getOutput() const
+  {
+    if (s_data) return AlignOutput::heavy;
+    return Path ? AlignOutput::medium : AlignOutput::light;
+  }
+
+  /// Number of rows and columns of matrix M that this object can be reset to.
+  int getRowCapacity() const {return signalA_capacity + 1;}
+  int getColCapacity() const {return signalB_capacity + 1;}
+
+  /// Bytes of M, A, B and Traceback of an object with these capacities, without Path and s_data.
+  static std::size_t matrixBytes(int capacityA, int capacityB)
+  {
+    return (std::size_t)(capacityA + 1) * (capacityB + 1) * (3*sizeof(double) + sizeof(Traceback::PackedTraceback));
+  }
+
+  /// Bytes allocated for the matrices of this object.
+  std::size_t allocatedBytes() const
+  {
+    std::size_t cells = (std::size_t)(signalA_capacity + 1) * (signalB_capacity + 1);
+    std::size_t bytes = matrixBytes(signalA_capacity, signalB_capacity);
+    if (Path) bytes += cells * sizeof(bool);
+    if (s_data) bytes += (std::size_t)signalA_capacity * signalB_capacity * sizeof(double);
+    return bytes;
+  }
+
+  /// Traceback of matrix MatName at (i, j).
+  Traceback::TracebackType getTraceback(Traceback::tbJump MatName, int i, int j) const
+  {
+    return Traceback::unpackTraceback(packedTraceback[i*(signalB_len+1) + j], MatName);
+  }
+
+  /// Sets traceback of matrix MatName at (i, j). Arrow direction of tb must be the one implied by MatName.
+  void setTraceback(Traceback::tbJump MatName, int i, int j, Traceback::TracebackType tb)
+  {
+    Traceback::PackedTraceback& cell = packedTraceback[i*(signalB_len+1) + j];
+    cell = (cell & ~(3 << (2*MatName))) | (Traceback::packTraceback(tb) << (2*MatName));
   }
 
   /**
@@ -141,11 +216,12 @@ public:
    */
   AffineAlignObj& operator=(const AffineAlignObj& rhs)
   {
+    if (this == &rhs) return *this;
     freeMemory_();
     signalA_len = rhs.signalA_len;
-    signalA_capacity = rhs.signalA_capacity;
+    signalA_capacity = rhs.signalA_len;
     signalB_len = rhs.signalB_len;
-    signalB_capacity = rhs.signalB_capacity;
+    signalB_capacity = rhs.signalB_len;
 
     GapOpen = rhs.GapOpen;
     GapExten = rhs.GapExten;
@@ -154,11 +230,13 @@ public:
     indexB_aligned = rhs.indexB_aligned;
     score = rhs.score;
     nGaps = rhs.nGaps;
+    simScore_forw = rhs.simScore_forw;
 
     int ROW_SIZE = rhs.signalA_len + 1;
     int COL_SIZE = rhs.signalB_len + 1;
 
     allocateMemory_(ROW_SIZE, COL_SIZE);
+    allocateOutput_(rhs.getOutput());
     copyData_(rhs, ROW_SIZE, COL_SIZE);
     return *this;
   }
@@ -167,27 +245,9 @@ public:
    * @brief Copy constructor.
    */
   AffineAlignObj(const AffineAlignObj& rhs)
+    : s_data(NULL), M(NULL), A(NULL), B(NULL), packedTraceback(NULL), Path(NULL)
   {
-    freeMemory_();
-
-    signalA_len = rhs.signalA_len;
-    signalA_capacity = rhs.signalA_capacity;
-    signalB_len = rhs.signalB_len;
-    signalB_capacity = rhs.signalB_capacity;
-
-    GapOpen = rhs.GapOpen;
-    GapExten = rhs.GapExten;
-    FreeEndGaps = rhs.FreeEndGaps;
-    indexA_aligned = rhs.indexA_aligned;
-    indexB_aligned = rhs.indexB_aligned;
-    score = rhs.score;
-    nGaps = rhs.nGaps;
-
-    int ROW_SIZE = rhs.signalA_len + 1;
-    int COL_SIZE = rhs.signalB_len + 1;
-
-    allocateMemory_(ROW_SIZE, COL_SIZE);
-    copyData_(rhs, ROW_SIZE, COL_SIZE);
+    *this = rhs;
   }
 
   /// Destructor: frees memory.
@@ -208,38 +268,123 @@ private:
     delete[] M;
     delete[] A;
     delete[] B;
-    delete[] Traceback;
+    delete[] packedTraceback;
     delete[] Path;
-    delete[] simPath;
+    s_data = NULL;
+    Path = NULL;
   }
 
-  /// Allocates memory for s_data, M, A, B, Traceback, Path matrices.
+  /// Allocates memory for M, A, B and Traceback matrices.
   void allocateMemory_(int ROW_SIZE, int COL_SIZE)
   {
     // new allocate memory in heap. Here we just keep the memory address in our object's member.
     // Memory will remain valid outside of this constructor's scope.
     // Therefore, we need to explicitly free it.
-    s_data = new double[(ROW_SIZE -1) * (COL_SIZE-1)];
     M = new double[ROW_SIZE * COL_SIZE];
     A = new double[ROW_SIZE * COL_SIZE];
     B = new double[ROW_SIZE * COL_SIZE];
-    Traceback = new Traceback::TracebackType[3* ROW_SIZE * COL_SIZE];
-    Path = new bool[ROW_SIZE * COL_SIZE];
-    simPath = new bool[ROW_SIZE * COL_SIZE];
+    packedTraceback = new Traceback::PackedTraceback[ROW_SIZE * COL_SIZE];
+  }
+
+  /// Allocates s_data and Path matrices at full capacity if output needs them, otherwise frees them.
+  void allocateOutput_(AlignOutput output)
+  {
+    int ROW_SIZE = signalA_capacity + 1;
+    int COL_SIZE = signalB_capacity + 1;
+    bool needPath = (output == AlignOutput::medium || output == AlignOutput::heavy);
+    bool needHeavy = (output == AlignOutput::heavy);
+    if (needPath && !Path) Path = new bool[ROW_SIZE * COL_SIZE];
+    if (!needPath && Path) {delete[] Path; Path = NULL;}
+    if (needHeavy && !s_data) s_data = new double[(ROW_SIZE -1) * (COL_SIZE-1)];
+    if (!needHeavy && s_data) {delete[] s_data; s_data = NULL;}
+  }
+
+  /// Sets first ROW_SIZE * COL_SIZE cells of allocated matrices to zero.
+  void clearMemory_(int ROW_SIZE, int COL_SIZE)
+  {
+    // We could use a for-loop but memset is faster for contiguous location in memory.
+    // It makes byte value = unsigned(int_0)
+    std::memset(M, 0, ROW_SIZE * COL_SIZE * sizeof(double));
+    std::memset(A, 0, ROW_SIZE * COL_SIZE * sizeof(double));
+    std::memset(B, 0, ROW_SIZE * COL_SIZE * sizeof(double));
+    std::memset(packedTraceback, 0, ROW_SIZE * COL_SIZE * sizeof(Traceback::PackedTraceback));
+    if (Path) std::memset(Path, 0, ROW_SIZE * COL_SIZE * sizeof(bool));
+    if (s_data) std::memset(s_data, 0, (ROW_SIZE -1) * (COL_SIZE-1) * sizeof(double));
+  }
+
+  /// Sets first row and column of M, A, B and Traceback, and the first ROW_SIZE * COL_SIZE cells of Path and s_data to zero.
+  void clearBoundary_(int ROW_SIZE, int COL_SIZE)
+  {
+    std::memset(M, 0, COL_SIZE * sizeof(double));
+    std::memset(A, 0, COL_SIZE * sizeof(double));
+    std::memset(B, 0, COL_SIZE * sizeof(double));
+    std::memset(packedTraceback, 0, COL_SIZE * sizeof(Traceback::PackedTraceback));
+    for (int i = 1; i < ROW_SIZE; i++)
+    {
+      M[i*COL_SIZE] = A[i*COL_SIZE] = B[i*COL_SIZE] = 0.0;
+      packedTraceback[i*COL_SIZE] = 0;
+    }
+    if (Path) std::memset(Path, 0, ROW_SIZE * COL_SIZE * sizeof(bool));
+    if (s_data) std::memset(s_data, 0, (ROW_SIZE -1) * (COL_SIZE-1) * sizeof(double));
   }
 
   /// Memory copy s_data, M, A, B, Traceback, Path matrices.
   void copyData_(const AffineAlignObj& rhs, int ROW_SIZE, int COL_SIZE)
   {
-    std::memcpy(s_data, rhs.s_data, (ROW_SIZE -1) * (COL_SIZE-1) * sizeof(double));
     std::memcpy(M, rhs.M, ROW_SIZE * COL_SIZE * sizeof(double));
     std::memcpy(A, rhs.A, ROW_SIZE * COL_SIZE * sizeof(double));
     std::memcpy(B, rhs.B, ROW_SIZE * COL_SIZE * sizeof(double));
-    std::memcpy(Traceback, rhs.Traceback, 3 *ROW_SIZE * COL_SIZE * sizeof(Traceback::TracebackType));
-    std::memcpy(Path, rhs.Path, ROW_SIZE * COL_SIZE * sizeof(bool));
-    std::memcpy(simPath, rhs.simPath, ROW_SIZE * COL_SIZE * sizeof(bool));
+    std::memcpy(packedTraceback, rhs.packedTraceback, ROW_SIZE * COL_SIZE * sizeof(Traceback::PackedTraceback));
+    if (Path) std::memcpy(Path, rhs.Path, ROW_SIZE * COL_SIZE * sizeof(bool));
+    if (s_data) std::memcpy(s_data, rhs.s_data, (ROW_SIZE -1) * (COL_SIZE-1) * sizeof(double));
   }
 };
+
+/**
+ * @brief An AffineAlignObj borrowed from the pool of the calling thread.
+ *
+ * Pooled objects are bucketed by capacity, which is the next power of two (at least 64) of each signal length. An object of
+ * the same size-class is reset and reused by later alignments on this thread, instead of allocating and zeroing a new one.
+ * The object returns to the pool when PooledAffineAlignObj goes out of scope. At most maxPooledPerClass objects are kept
+ * per size-class, and idle objects of a thread never exceed maxPooledBytes; a size-class whose matrices alone exceed
+ * maxPooledBytes is never pooled and the exact size is allocated. clear() releases the idle objects, it is exported to R as clearAlignmentPoolCpp().
+ */
+class PooledAffineAlignObj
+{
+public:
+  static const std::size_t maxPooledPerClass = 2; ///< Number of idle objects kept per size-class.
+  static const std::size_t maxPooledBytes = 1 << 26; ///< Idle objects of a thread are freed beyond this many bytes.
+
+  /**
+   * @brief Takes an object of ROW_SIZE x COL_SIZE from the pool, or allocates one, and resets it for output.
+   *
+   * @param ROW_SIZE Number of rows in matrix M.
+   * @param COL_SIZE Number of columns in matrix M.
+   * @param output Outputs that are needed from this object.
+   */
+  PooledAffineAlignObj(int ROW_SIZE, int COL_SIZE, AlignOutput output = AlignOutput::heavy);
+
+  /// Returns the object to the pool of this thread.
+  ~PooledAffineAlignObj();
+
+  AffineAlignObj& operator*() {return *obj_;}
+  AffineAlignObj* operator->() {return obj_;}
+
+  /// Number of idle objects in the pool of the calling thread.
+  static std::size_t idleCount();
+
+  /// Bytes allocated by idle objects in the pool of the calling thread.
+  static std::size_t idleBytes();
+
+  /// Frees all idle objects in the pool of the calling thread. Returns the number of bytes freed.
+  static std::size_t clear();
+
+private:
+  PooledAffineAlignObj(const PooledAffineAlignObj&) = delete;
+  PooledAffineAlignObj& operator=(const PooledAffineAlignObj&) = delete;
+
+  AffineAlignObj* obj_;
+};
 } // namespace DIAlign
 
 #endif // AFFINEALIGNOBJ_H
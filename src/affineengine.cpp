@@ -0,0 +1,30 @@
+#include "affineengine.h"
+#include <exception>
+#include <stdexcept>
+
+namespace DIAlign
+{
+namespace AffineAlignment
+{
+
+void validateAffineAlignment(const std::string& objName, int signalA_len, int signalB_len, const SimMatrix& s,
+                             const ConstrainMatrix::NoBeefPenalty* penalty, double go, double ge){
+  if(go < 0.0){
+    throw std::invalid_argument("Gap opening penalty should be non-negative");
+  }
+  if(ge < 0.0){
+    throw std::invalid_argument("Gap extension penalty should be non-negative");
+  }
+  if(signalA_len != s.n_row || signalB_len != s.n_col){
+    throw std::invalid_argument(objName + " should have number of rows and columns +1 each than that of similarity matrix s.");
+  }
+  if(signalA_len <= 1 || signalB_len <= 1){
+    throw std::invalid_argument(objName + " must have more than unit size.");
+  }
+  if(penalty && ((int)penalty->tBp.size() != s.n_row || (int)penalty->tB.size() != s.n_col)){
+    throw std::invalid_argument("Penalty should have timepoints for each row and column of similarity matrix s.");
+  }
+}
+
+} // namespace AffineAlignment
+} // namespace DIAlign
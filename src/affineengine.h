@@ -0,0 +1,192 @@
+#ifndef AFFINEENGINE_H
+#define AFFINEENGINE_H
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include "affinealignobj.h"
+#include "alignment.h"
+#include "constrainMat.h"
+#include "similarityMatrix.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+namespace AffineAlignment
+{
+/// A cell of the alignment path in matrix MatName.
+struct PathCell
+{
+  Traceback::tbJump MatName;
+  int i;
+  int j;
+};
+
+/**
+ * @brief Checks gap penalties and the sizes of an alignment object, s and penalty before affine alignment.
+ *
+ * All affine alignment engines call it, hence, they reject the same inputs with the same messages.
+ * @param objName Name of the alignment object used in messages.
+ * @param signalA_len Number of rows of s expected by the alignment object.
+ * @param signalB_len Number of columns of s expected by the alignment object.
+ * @param s similarity score matrix.
+ * @param penalty Penalty added to each row of s. May be NULL.
+ * @param go gap opening penalty in alignment path.
+ * @param ge gap extension penalty in alignment path.
+ */
+void validateAffineAlignment(const std::string& objName, int signalA_len, int signalB_len, const SimMatrix& s,
+                             const ConstrainMatrix::NoBeefPenalty* penalty, double go, double ge);
+
+/**
+ * @brief Finds the cell where the traceback of an affine alignment starts.
+ *
+ * For overlap alignment, the last column and then the last row are searched. In each cell M is checked before A before B,
+ * and the first one that is not below the maximum so far wins, hence, later cells win ties. This is the search of
+ * getOlapAffineAlignStartIndices(). For global alignment, the matrix with the highest score at the bottom-right corner is selected.
+ * @param signalA_len Number of data-points in signal A.
+ * @param signalB_len Number of data-points in signal B.
+ * @param FreeEndGaps True for overlap alignment.
+ * @param getScore getScore(MatName, i, j) returns the cumulative score. It is called only for the last row and column.
+ * @param start Start-cell of the traceback.
+ * @return The start-cell score that serves as the cumulative score of the alignment.
+ */
+template<typename ScoreFn>
+double getAffineStartCell(int signalA_len, int signalB_len, bool FreeEndGaps, ScoreFn getScore, PathCell& start){
+  const Traceback::tbJump mats[3] = {Traceback::M, Traceback::A, Traceback::B};
+  start = {Traceback::M, signalA_len, signalB_len};
+  if(!FreeEndGaps){
+    // Global Alignment, traceback starts at the bottom-right corner.
+    double Mscore = getScore(Traceback::M, signalA_len, signalB_len);
+    double Ascore = getScore(Traceback::A, signalA_len, signalB_len);
+    double Bscore = getScore(Traceback::B, signalA_len, signalB_len);
+    if (Mscore >= Ascore && Mscore >= Bscore){
+      return Mscore;
+    }
+    else if(Ascore >= Mscore && Ascore>= Bscore) {
+      start.MatName = Traceback::A;
+      return Ascore;
+    }
+    start.MatName = Traceback::B;
+    return Bscore;
+  }
+  double maxScore = -std::numeric_limits<double>::infinity();
+  for(int i = 0; i <= signalA_len; i++){
+    for(int m = 0; m < 3; m++){
+      double val = getScore(mats[m], i, signalB_len);
+      if(val >= maxScore){
+        start = {mats[m], i, signalB_len};
+        maxScore = val;
+        break;
+      }
+    }
+  }
+  for(int j = 0; j <= signalB_len; j++){
+    for(int m = 0; m < 3; m++){
+      double val = getScore(mats[m], signalA_len, j);
+      if(val >= maxScore){
+        start = {mats[m], signalA_len, j};
+        maxScore = val;
+        break;
+      }
+    }
+  }
+  return maxScore;
+}
+
+/**
+ * @brief Calculates aligned indices, cumulative scores and number of gaps of an affine alignment.
+ *
+ * The start-cell is found with getAffineStartCell(), then Traceback is followed until SS, as in getAffineAlignedIndices().
+ * indexA_aligned, indexB_aligned, score and nGaps of obj are overwritten.
+ * @param obj Alignment object with signalA_len, signalB_len, FreeEndGaps and the outputs of getAffineAlignedIndices().
+ * @param getScore getScore(MatName, i, j) returns the cumulative score of the last row and column.
+ * @param getTraceback getTraceback(MatName, i, j) returns the Traceback of any cell.
+ * @param getPathScores getPathScores(path, pathScore) sets pathScore[k] to the cumulative score of path[k], for k > 0.
+ * path[0] is the start-cell and pathScore has the size of path.
+ */
+template<typename Obj, typename ScoreFn, typename TracebackFn, typename PathScoreFn>
+void traceAffinePath(Obj& obj, ScoreFn getScore, TracebackFn getTraceback, PathScoreFn getPathScores){
+  using namespace Traceback;
+  obj.indexA_aligned.clear();
+  obj.indexB_aligned.clear();
+  obj.score.clear();
+  obj.nGaps = 0;
+
+  PathCell start;
+  double affineAlignmentScore = getAffineStartCell(obj.signalA_len, obj.signalB_len, obj.FreeEndGaps, getScore, start);
+  int ROW_IDX = start.i;
+  int COL_IDX = start.j;
+  tbJump MatName = start.MatName;
+  if(ROW_IDX != obj.signalA_len){
+    // Maximum score is obtained in last column. Align all row indices below max-score-index to NA.
+    for (int i = obj.signalA_len; i>ROW_IDX; i--){
+      obj.indexA_aligned.push_back(i);
+      obj.indexB_aligned.push_back(NA);
+      obj.score.push_back(affineAlignmentScore);
+    }
+  }
+  else if (COL_IDX != obj.signalB_len){
+    // Maximum score is obtained in last row. Align all column indices right to max-score-index to NA.
+    for (int j = obj.signalB_len; j>COL_IDX; j--){
+      obj.indexA_aligned.push_back(NA);
+      obj.indexB_aligned.push_back(j);
+      obj.score.push_back(affineAlignmentScore);
+    }
+  }
+
+  // Traceback path and align row indices to column indices.
+  std::vector<PathCell> path(1, start);
+  TracebackType TracebackPointer = getTraceback(MatName, ROW_IDX, COL_IDX);
+  while(TracebackPointer != SS){
+    switch(TracebackPointer){
+    case DM: case DA: case DB:
+      // Go diagonal (Up-Left) to the matrix M, A or B.
+      obj.indexA_aligned.push_back(ROW_IDX);
+      obj.indexB_aligned.push_back(COL_IDX);
+      ROW_IDX = ROW_IDX-1;
+      COL_IDX = COL_IDX-1;
+      MatName = static_cast<tbJump>(TracebackPointer - DM);
+      break;
+    case TM: case TA: case TB:
+      // Go up to the matrix M, A or B.
+      obj.indexA_aligned.push_back(ROW_IDX);
+      obj.indexB_aligned.push_back(NA);
+      ROW_IDX = ROW_IDX-1;
+      MatName = static_cast<tbJump>(TracebackPointer - TM);
+      if(COL_IDX != 0 || !obj.FreeEndGaps) obj.nGaps += 1;
+      break;
+    case LM: case LA: case LB:
+      // Go left to the matrix M, A or B.
+      obj.indexA_aligned.push_back(NA);
+      obj.indexB_aligned.push_back(COL_IDX);
+      COL_IDX = COL_IDX-1;
+      MatName = static_cast<tbJump>(TracebackPointer - LM);
+      if(ROW_IDX != 0 || !obj.FreeEndGaps) obj.nGaps += 1;
+      break;
+    case SS:
+      break;
+    }
+    path.push_back({MatName, ROW_IDX, COL_IDX});
+    TracebackPointer = getTraceback(MatName, ROW_IDX, COL_IDX);
+  }
+
+  std::vector<double> pathScore(path.size());
+  getPathScores(path, pathScore);
+  obj.score.push_back(affineAlignmentScore);
+  for(std::size_t k = 1; k < path.size(); k++) obj.score.push_back(pathScore[k]);
+  // push_back adds values at the end of vector, therefore, reverse the vector.
+  std::reverse(std::begin(obj.indexA_aligned), std::end(obj.indexA_aligned));
+  std::reverse(std::begin(obj.indexB_aligned), std::end(obj.indexB_aligned));
+  std::reverse(std::begin(obj.score), std::end(obj.score));
+  // remove the first index, since the score-traceback is ahead of aligned indices.
+  obj.score.erase(obj.score.begin());
+}
+} // namespace AffineAlignment
+} // namespace DIAlign
+
+#endif // AFFINEENGINE_H
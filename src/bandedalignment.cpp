@@ -0,0 +1,128 @@
+#include "bandedalignment.h"
+#include "affineengine.h"
+#include <exception>
+#include <stdexcept>
+
+namespace DIAlign
+{
+
+using namespace Traceback;
+
+BandedAffineAlignObj::BandedAffineAlignObj(const SimBand& band){
+  if((int)band.start.size() != band.n_row || (int)band.end.size() != band.n_row){
+    throw std::invalid_argument("Band must have start and end for each row.");
+  }
+  signalA_len = band.n_row;
+  signalB_len = band.n_col;
+  colStart.assign(signalA_len+1, 0);
+  colEnd.assign(signalA_len+1, 0);
+  rowOffset.assign(signalA_len+2, 0);
+  for(int i = 1; i <= signalA_len; i++){
+    // Row i-1 of the similarity matrix is row i of M, A and B.
+    colStart[i] = band.start[i-1] + 1;
+    colEnd[i] = band.end[i-1] + 1;
+    if(colStart[i] < 1 || colEnd[i] <= colStart[i] || colEnd[i] > signalB_len + 1){
+      throw std::invalid_argument("Each row of the band must have at least one column within the similarity matrix.");
+    }
+    rowOffset[i+1] = rowOffset[i] + (colEnd[i] - colStart[i]);
+  }
+  std::size_t nCells = rowOffset[signalA_len+1];
+  // Default values are the same as those of a cleared AffineAlignObj.
+  M.assign(nCells, 0.0);
+  A.assign(nCells, 0.0);
+  B.assign(nCells, 0.0);
+  packedTraceback.assign(nCells, 0);
+  GapOpen = 0.0;
+  GapExten = 0.0;
+  FreeEndGaps = true;
+  nGaps = 0;
+}
+
+double BandedAffineAlignObj::getScore(tbJump MatName, int i, int j) const{
+  double Inf = std::numeric_limits<double>::infinity();
+  if(i == 0 || j == 0){
+    // First row and column are initialized as in doAffineAlignment().
+    if(MatName == Traceback::M) return (i == 0 && j == 0) ? 0.0 : -Inf;
+    if(MatName == Traceback::A && j == 0 && i > 0) return FreeEndGaps ? 0.0 : -(i-1)*GapExten - GapOpen;
+    if(MatName == Traceback::B && i == 0 && j > 0) return FreeEndGaps ? 0.0 : -(j-1)*GapExten - GapOpen;
+    return -Inf;
+  }
+  if(!inBand(i, j)) return -Inf;
+  std::size_t idx = rowOffset[i] + (j - colStart[i]);
+  if(MatName == Traceback::M) return M[idx];
+  if(MatName == Traceback::A) return A[idx];
+  return B[idx];
+}
+
+TracebackType BandedAffineAlignObj::getTraceback(tbJump MatName, int i, int j) const{
+  if(i == 0 || j == 0){
+    if(MatName == Traceback::A && j == 0 && i > 0) return (i == 1) ? TM : TA;
+    if(MatName == Traceback::B && i == 0 && j > 0) return (j == 1) ? LM : LB;
+    return SS;
+  }
+  if(!inBand(i, j)) return SS;
+  return unpackTraceback(packedTraceback[rowOffset[i] + (j - colStart[i])], MatName);
+}
+
+namespace AffineAlignment
+{
+
+// It performs affine alignment on the cells inside the band and fills M, A and B, and corresponding traceback.
+void doBandedAffineAlignment(BandedAffineAlignObj& obj, const SimMatrix& s, double go, double ge, bool OverlapAlignment){
+  validateAffineAlignment("BandedAffineAlignObj", obj.signalA_len, obj.signalB_len, s, NULL, go, ge);
+  obj.FreeEndGaps = OverlapAlignment;
+  obj.GapOpen = go;
+  obj.GapExten = ge;
+
+  double Inf = std::numeric_limits<double>::infinity();
+  // Previous row of M, A and B over columns [lo-1, hi) of the current row.
+  std::vector<double> prevM, prevA, prevB;
+  for(int i = 1; i <= obj.signalA_len; i++){
+    int lo = obj.colStart[i], hi = obj.colEnd[i];
+    int width = hi - lo + 1;
+    prevM.assign(width, -Inf);
+    prevA.assign(width, -Inf);
+    prevB.assign(width, -Inf);
+    if(i == 1){
+      for(int j = lo-1; j < hi; j++){
+        prevM[j-lo+1] = obj.getScore(Traceback::M, 0, j);
+        prevB[j-lo+1] = obj.getScore(Traceback::B, 0, j);
+      }
+    } else {
+      if(lo == 1) prevA[0] = obj.getScore(Traceback::A, i-1, 0);
+      int from = std::max(lo-1, obj.colStart[i-1]), to = std::min(hi, obj.colEnd[i-1]);
+      for(int j = from; j < to; j++){
+        std::size_t idx = obj.rowOffset[i-1] + (j - obj.colStart[i-1]);
+        prevM[j-lo+1] = obj.M[idx];
+        prevA[j-lo+1] = obj.A[idx];
+        prevB[j-lo+1] = obj.B[idx];
+      }
+    }
+
+    // Left neighbour of the first cell is either the first column or outside of the band.
+    double leftM = -Inf, leftA = (lo == 1) ? obj.getScore(Traceback::A, i, 0) : -Inf, leftB = -Inf;
+    const double* sRow = &s.data[(i-1)*s.n_col];
+    for(int j = lo; j < hi; j++){
+      std::size_t idx = obj.rowOffset[i] + (j - lo);
+      int k = j - lo; // prev[k] is column j-1, prev[k+1] is column j.
+      TracebackType tbM = SS, tbA = SS, tbB = SS;
+      fillAffineCell(sRow[j-1], prevM[k], prevA[k], prevB[k], prevM[k+1], prevA[k+1], prevB[k+1],
+                     leftM, leftA, leftB, go, ge, obj.M[idx], obj.A[idx], obj.B[idx], tbM, tbA, tbB);
+      obj.packedTraceback[idx] = packTraceback(tbM, tbA, tbB);
+      leftM = obj.M[idx];
+      leftA = obj.A[idx];
+      leftB = obj.B[idx];
+    }
+  }
+}
+
+void getBandedAffineAlignedIndices(BandedAffineAlignObj& obj){
+  auto getScore = [&](tbJump MatName, int i, int j){ return obj.getScore(MatName, i, j); };
+  auto getTraceback = [&](tbJump MatName, int i, int j){ return obj.getTraceback(MatName, i, j); };
+  traceAffinePath(obj, getScore, getTraceback, [&](const std::vector<PathCell>& path, std::vector<double>& pathScore){
+    for(std::size_t k = 1; k < path.size(); k++) pathScore[k] = obj.getScore(path[k].MatName, path[k].i, path[k].j);
+  });
+}
+
+} // namespace AffineAlignment
+} // namespace DIAlign
@@ -0,0 +1,96 @@
+#ifndef BANDEDALIGNMENT_H
+#define BANDEDALIGNMENT_H
+
+#include <vector>
+#include <limits>
+#include "affinealignobj.h"
+#include "affinealignment.h"
+#include "similarityMatrix.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/**
+ * @brief An affine alignment object that stores only the cells inside a DIAlign::SimBand.
+ *
+ * Cumulative-score matrices M, A, B and their Traceback are stored row-by-row for the cells inside the band.
+ * Traceback of M, A and B is packed in one byte per cell, same as in AffineAlignObj.
+ * First row and first column of the matrices are not stored, they are derived from gap penalties on access.
+ * Cells outside of the band have -Inf score and SS traceback.
+ * Therefore, memory and time are proportional to the number of cells in the band instead of ROW_SIZE * COL_SIZE.
+ */
+struct BandedAffineAlignObj
+{
+  std::vector<int> colStart; ///< First column of matrix M stored for each row. Row 0 is not stored.
+  std::vector<int> colEnd; ///< One past the last column of matrix M stored for each row.
+  std::vector<std::size_t> rowOffset; ///< Index of the first stored cell of each row.
+  std::vector<double> M; ///< Match or Mismatch matrix inside the band.
+  std::vector<double> A; ///< Insert in sequence A inside the band.
+  std::vector<double> B; ///< Insert in sequence B inside the band.
+  std::vector<Traceback::PackedTraceback> packedTraceback; ///< Traceback of M, A and B inside the band, packed in one byte per cell.
+  int signalA_len; ///< Number of data-points in signal A.
+  int signalB_len; ///< Number of data-points in signal B.
+  double GapOpen; ///< Penalty for Gap opening. For n consecutive gaps: Penalty = GapOpen + (n-1)*GapExten.
+  double GapExten; ///< Penalty for Gap extension. For n consecutive gaps: Penalty = GapOpen + (n-1)*GapExten.
+  bool FreeEndGaps; ///< True for Overlap alignment.
+  std::vector<int> indexA_aligned; ///< Aligned signalA indices after affine alignment.
+  std::vector<int> indexB_aligned; ///< Aligned signalB indices after affine alignment.
+  std::vector<double> score;  ///< Cumulative score along the aligned path.
+  int nGaps; ///< Total number of gaps in the alignment path.
+
+  /**
+   * @brief Constructor for BandedAffineAlignObj.
+   *
+   * Allocates memory for the cells inside the band. Row i of the similarity matrix corresponds to row i+1 of M, A and B.
+   * @param band Band over the similarity matrix. Each row must have at least one column.
+   */
+  BandedAffineAlignObj(const SimBand& band);
+
+  /// Number of cells stored per matrix.
+  std::size_t size() const {return M.size();}
+
+  /// True if cell (i, j) of M, A and B is stored. First row and column are never stored.
+  bool inBand(int i, int j) const {
+    return i > 0 && i <= signalA_len && j >= colStart[i] && j < colEnd[i];
+  }
+
+  /// Cumulative score of cell (i, j) of matrix MatName. Boundary cells are derived from gap penalties, cells outside the band are -Inf.
+  double getScore(Traceback::tbJump MatName, int i, int j) const;
+
+  /// Traceback of cell (i, j) of matrix MatName. Cells outside the band are SS.
+  Traceback::TracebackType getTraceback(Traceback::tbJump MatName, int i, int j) const;
+};
+
+namespace AffineAlignment
+{
+/**
+ * @brief Performs affine alignment only inside the band of the similarity-score matrix.
+ *
+ * It fills the same recurrence as doAffineAlignment(), with identical tie-breaking, but only for the cells inside the band.
+ * Cells outside the band are unreachable. If the band covers the whole matrix, scores and traceback are the same as from doAffineAlignment().
+ *
+ * @param obj An object of class BandedAffineAlignObj constructed from a band of the same size as s.
+ * @param s similarity score matrix. Only cells inside the band are read.
+ * @param go gap opening penalty in alignment path.
+ * @param ge gap extension penalty in alignment path.
+ * @param OverlapAlignment If true, end gaps are not penalized.
+ */
+void doBandedAffineAlignment(BandedAffineAlignObj& obj, const SimMatrix& s, double go, double ge, bool OverlapAlignment);
+
+/**
+ * @brief Calculates aligned indices for source signal A and B from BandedAffineAlignObj.
+ *
+ * The start-cell search and the traceback are the same as in getAffineAlignedIndices(), hence, the path never leaves the band.
+ * Path matrix is not built.
+ * @param obj An object of class BandedAffineAlignObj. Must have been operated by doBandedAffineAlignment() function before.
+ */
+void getBandedAffineAlignedIndices(BandedAffineAlignObj& obj);
+} // namespace AffineAlignment
+} // namespace DIAlign
+
+#endif // BANDEDALIGNMENT_H
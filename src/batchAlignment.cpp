@@ -0,0 +1,281 @@
+#include "batchAlignment.h"
+#include "gapPenalty.h"
+#include "constrainMat.h"
+#include "bandedalignment.h"
+#include "fusedalignment.h"
+#include "checkpointalignment.h"
+#include "scorealignment.h"
+#include "miscell.h"
+#include "utils.h"
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace DIAlign
+{
+
+using namespace ConstrainMatrix;
+
+namespace AffineAlignment
+{
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Keeps every factor-th element.
+  std::vector<double> decimate(const std::vector<double>& v, int factor){
+    std::vector<double> out;
+    out.reserve(v.size()/factor + 1);
+    for(std::size_t i = 0; i < v.size(); i += factor) out.push_back(v[i]);
+    return out;
+  }
+
+  // Keeps every factor-th sample of each fragment-ion. Intensities are already smoothed, hence, no extra low-pass filter is applied.
+  PreparedXICGroup decimateXICGroup(const PreparedXICGroup& g, int factor){
+    ChromatogramGroup xic(decimate(g.xic.time, factor), g.xic.nFrag);
+    for(int k = 0; k < xic.nFrag; k++){
+      for(int i = 0; i < xic.len; i++) xic.fragment(k)[i] = g.xic.fragment(k)[i*factor];
+    }
+    return PreparedXICGroup(std::move(xic), g.normalization);
+  }
+
+  // Row of the full-resolution matrix M for row r of the coarse matrix M with n_coarse rows.
+  int fullIndex(int r, int factor, int n_coarse, int n_full){
+    if(r == 0) return 0;
+    if(r == n_coarse) return n_full;
+    return (r-1)*factor + 1;
+  }
+
+  // Band of the full-resolution similarity matrix that covers cells within corridor rows and columns of the coarse path.
+  void calcCorridorBand(SimBand& band, const std::vector<int>& indexA_aligned, const std::vector<int>& indexB_aligned,
+                        int n_coarseRow, int n_coarseCol, int factor, int corridor, int n_row, int n_col){
+    // Column range of the path in each row of M, from the steps between consecutive coarse cells.
+    std::vector<int> pathStart(n_row+1, n_col), pathEnd(n_row+1, 0);
+    int r0 = 0, c0 = 0;
+    for(std::size_t k = 0; k <= indexA_aligned.size(); k++){
+      int r1 = (k < indexA_aligned.size() && indexA_aligned[k] != 0) ? indexA_aligned[k] : r0;
+      int c1 = (k < indexB_aligned.size() && indexB_aligned[k] != 0) ? indexB_aligned[k] : c0;
+      if(k == indexA_aligned.size()){
+        // Path is extended to the bottom-right corner.
+        r1 = n_coarseRow;
+        c1 = n_coarseCol;
+      }
+      int R0 = fullIndex(r0, factor, n_coarseRow, n_row), R1 = fullIndex(r1, factor, n_coarseRow, n_row);
+      int C0 = fullIndex(c0, factor, n_coarseCol, n_col), C1 = fullIndex(c1, factor, n_coarseCol, n_col);
+      for(int i = R0; i <= R1; i++){
+        pathStart[i] = std::min(pathStart[i], C0);
+        pathEnd[i] = std::max(pathEnd[i], C1);
+      }
+      r0 = r1;
+      c0 = c1;
+    }
+
+    band.n_row = n_row;
+    band.n_col = n_col;
+    band.start.resize(n_row);
+    band.end.resize(n_row);
+    for(int i = 1; i <= n_row; i++){
+      int lo = n_col, hi = 0;
+      for(int k = std::max(0, i - corridor); k <= std::min(n_row, i + corridor); k++){
+        lo = std::min(lo, pathStart[k]);
+        hi = std::max(hi, pathEnd[k]);
+      }
+      // Column j of M is column j-1 of the similarity matrix.
+      band.start[i-1] = std::min(std::max(1, lo - corridor), n_col) - 1;
+      band.end[i-1] = std::max(std::min(n_col, hi + corridor), band.start[i-1] + 1);
+    }
+  }
+
+  // Aligned indices of g1 and g2. See alignXICGroups().
+  void alignXICGroupIndices(const PreparedXICGroup& g1, const PreparedXICGroup& g2, const std::string& alignType,
+                            double adaptiveRT, const std::vector<double>& Bp, const XICAlignParams& params,
+                            std::vector<int>& indexA_aligned, std::vector<int>& indexB_aligned){
+    const std::vector<double>& time1 = g1.xic.time;
+    const std::vector<double>& time2 = g2.xic.time;
+
+    int len = time1.size();
+    double samplingTime = (time1[len-1] - time1[0])/(len-1);
+    int noBeef = ceil(adaptiveRT/samplingTime);
+    bool hardConstrain = params.hardConstrain;
+
+    // Normalized intensities and their per-sample norms are taken from the prepared groups.
+    SimMatrix s = SimilarityMatrix::getSimilarityMatrix(g1, g2, params.simType, params.cosAngleThresh, params.dotProdThresh, params.kerLen,
+                                                      params.approxQuantile);
+    double gapPenalty = getGapPenalty(s, params.gapQuantile, params.simType, params.approxQuantile);
+    double go = gapPenalty*params.goFactor, ge = gapPenalty*params.geFactor;
+    // Similarity matrix is penalized row-by-row during alignment, hence, MASK is not built.
+    std::unique_ptr<NoBeefPenalty> penalty;
+    if (alignType != "local"){
+      if(alignType == "global"){ // This will give aligned chromatogram for global alignment.
+        noBeef = 0;
+        hardConstrain = true;
+      }
+      auto maxIt = max_element(std::begin(s.data), std::end(s.data));
+      double maxVal = *maxIt;
+      penalty.reset(new NoBeefPenalty(time2, Bp, noBeef, hardConstrain, -2.0*maxVal/params.samples4gradient));
+    }
+    SimBand band;
+    bool banded = false;
+    int factor = params.coarseFactor;
+    if(params.bandWidth > 0 && penalty){
+      // Only cells close to the global fit are penalized and filled. noBeef is zero for global alignment.
+      calcNoBeefBand(band, time2, Bp, noBeef + params.bandWidth);
+      banded = true;
+    } else if(factor > 1 && std::min(g1.size(), g2.size()) >= 2*factor){
+      // Coarse path at 1/factor resolution defines the corridor that is aligned at full resolution.
+      XICAlignParams coarse = params;
+      coarse.coarseFactor = 1;
+      std::vector<int> coarseA, coarseB;
+      PreparedXICGroup c1 = decimateXICGroup(g1, factor), c2 = decimateXICGroup(g2, factor);
+      alignXICGroupIndices(c1, c2, alignType, adaptiveRT, decimate(Bp, factor), coarse, coarseA, coarseB);
+      calcCorridorBand(band, coarseA, coarseB, c1.size(), c2.size(), factor, params.corridor, s.n_row, s.n_col);
+      banded = true;
+    } else if(params.anchorQuantile > 0.0){
+      // Anchors must agree with the global fit, hence, they are selected after the penalty.
+      if(penalty){
+        for(int i = 0; i < s.n_row; i++) penalty->constrainRow(i, &s.data[i*s.n_col]);
+        penalty.reset();
+      }
+      calcAnchorBand(band, getAnchorChain(s, params.anchorQuantile, params.approxQuantile), s.n_row, s.n_col);
+      banded = true;
+    }
+
+    if(banded){
+      if(penalty){
+        for(int i = 0; i < s.n_row; i++){
+          penalty->constrainRow(i, &s.data[i*s.n_col + band.start[i]], band.start[i], band.end[i]);
+        }
+      }
+      BandedAffineAlignObj obj(band);
+      doBandedAffineAlignment(obj, s, go, ge, params.OverlapAlignment);
+      getBandedAffineAlignedIndices(obj);
+      indexA_aligned = std::move(obj.indexA_aligned);
+      indexB_aligned = std::move(obj.indexB_aligned);
+    } else if(s.data.size() > params.checkpointCells){
+      // Traceback of long chromatograms does not fit in memory. Same path as FusedAffineAlignObj, found by recomputing rows.
+      CheckpointAffineAlignObj obj(s.n_row+1, s.n_col+1);
+      doCheckpointAffineAlignment(obj, s, penalty.get(), go, ge, params.OverlapAlignment);
+      getCheckpointAffineAlignedIndices(obj, s, penalty.get());
+      indexA_aligned = std::move(obj.indexA_aligned);
+      indexB_aligned = std::move(obj.indexB_aligned);
+    } else {
+      FusedAffineAlignObj obj(s.n_row+1, s.n_col+1); // Keeps only Traceback and the last row and column of M, A and B.
+      doFusedAffineAlignment(obj, s, penalty.get(), go, ge, params.OverlapAlignment);
+      getFusedAffineAlignedIndices(obj, s, penalty.get());
+      indexA_aligned = std::move(obj.indexA_aligned);
+      indexB_aligned = std::move(obj.indexB_aligned);
+    }
+  }
+} // namespace
+
+AlignedTimes alignXICGroups(const PreparedXICGroup& g1, const PreparedXICGroup& g2, const std::string& alignType,
+                            double adaptiveRT, const std::vector<double>& Bp, const XICAlignParams& params){
+  if(params.simType == SimilarityType::unknown){
+    throw std::invalid_argument("simType must be from dotProductMasked, dotProduct, cosineAngle, cosine2Angle, euclideanDist, covariance, correlation and crossCorrelation.");
+  }
+  if(params.coarseFactor < 1 || params.corridor < 0){
+    throw std::invalid_argument("coarseFactor must be positive and corridor must be non-negative.");
+  }
+  const std::vector<double>& time1 = g1.xic.time;
+  const std::vector<double>& time2 = g2.xic.time;
+  std::vector<int> indexA_aligned, indexB_aligned;
+  alignXICGroupIndices(g1, g2, alignType, adaptiveRT, Bp, params, indexA_aligned, indexB_aligned);
+
+  // Expand time vector to aligned-indices
+  int nrow = indexA_aligned.size();
+  std::vector<double> tRef(nrow, -1.0);
+  std::vector<double> tExp(nrow, -1.0);
+  for(int i= 0; i<nrow; i++){
+    if(indexA_aligned[i] != 0){
+      tRef[i] = time1[indexA_aligned[i]-1];
+    }
+    if(indexB_aligned[i] != 0){
+      tExp[i] = time2[indexB_aligned[i]-1];
+    }
+  }
+
+  // Fill missing values like zoo::na.approx
+  interpolateZero(tRef);
+  interpolateZero(tExp);
+
+  // Keep only those values for which there is no missing insert in the reference.
+  AlignedTimes aligned;
+  int noKeep = std::count(indexA_aligned.begin(), indexA_aligned.end(), 0);
+  aligned.tRef.reserve(nrow-noKeep);
+  aligned.tExp.reserve(nrow-noKeep);
+  for(int i = 0; i<nrow; i++){
+    if(indexA_aligned[i] != 0){
+      aligned.tRef.push_back(tRef[i]);
+      aligned.tExp.push_back(tExp[i]);
+    }
+  }
+  return aligned;
+}
+
+std::vector<AlignedTimes> alignXICGroupBatch(const PreparedXICGroup& ref, const std::vector<const PreparedXICGroup*>& eXps,
+                                             const std::vector<std::string>& alignTypes, const std::vector<double>& adaptiveRTs,
+                                             const std::vector<std::vector<double>>& Bps, const XICAlignParams& params,
+                                             int nThreads, std::vector<std::string>& errors){
+  std::size_t n = eXps.size();
+  if(alignTypes.size() != n || adaptiveRTs.size() != n || Bps.size() != n){
+    throw std::invalid_argument("Each experiment XIC group must have an alignType, adaptiveRT and Bp.");
+  }
+  std::vector<AlignedTimes> aligned(n);
+  errors.assign(n, std::string());
+  // Each task writes only to its own slot, and exceptions are kept per pair.
+  Utils::parallelFor(n, nThreads, [&](int k){
+    try{
+      aligned[k] = alignXICGroups(ref, *eXps[k], alignTypes[k], adaptiveRTs[k], Bps[k], params);
+    } catch(const std::exception& e){
+      errors[k] = e.what();
+    }
+  });
+  return aligned;
+}
+
+double alignXICGroupScore(const PreparedXICGroup& g1, const PreparedXICGroup& g2, const XICAlignParams& params){
+  if(params.simType == SimilarityType::unknown){
+    throw std::invalid_argument("simType must be from dotProductMasked, dotProduct, cosineAngle, cosine2Angle, euclideanDist, covariance, correlation and crossCorrelation.");
+  }
+  SimMatrix s = SimilarityMatrix::getSimilarityMatrix(g1, g2, params.simType, params.cosAngleThresh, params.dotProdThresh, params.kerLen,
+                                                    params.approxQuantile);
+  double gapPenalty = getGapPenalty(s, params.gapQuantile, params.simType, params.approxQuantile);
+  return getAffineAlignmentScore(s, NULL, gapPenalty*params.goFactor, gapPenalty*params.geFactor, params.OverlapAlignment);
+}
+
+std::vector<double> alignXICGroupDistances(const std::vector<const PreparedXICGroup*>& groups, const XICAlignParams& params,
+                                           int nThreads){
+  int n = groups.size();
+  double NaN = std::numeric_limits<double>::quiet_NaN();
+  std::vector<int> pairA, pairB;
+  for(int a = 0; a < n; a++){
+    for(int b = a; b < n; b++){
+      pairA.push_back(a);
+      pairB.push_back(b);
+    }
+  }
+  std::vector<double> score(n*n, NaN);
+  Utils::parallelFor(pairA.size(), nThreads, [&](int k){
+    try{
+      score[pairA[k]*n + pairB[k]] = alignXICGroupScore(*groups[pairA[k]], *groups[pairB[k]], params);
+    } catch(const std::exception&){
+      // Distance of this pair remains NaN.
+    }
+  });
+
+  std::vector<double> dist(n*n, NaN);
+  for(int a = 0; a < n; a++){
+    for(int b = a; b < n; b++){
+      double sAA = score[a*n + a], sBB = score[b*n + b];
+      if(sAA > 0.0 && sBB > 0.0){
+        dist[a*n + b] = dist[b*n + a] = (a == b) ? 0.0 : 1.0 - score[a*n + b]/std::sqrt(sAA*sBB);
+      }
+    }
+  }
+  return dist;
+}
+
+} // namespace AffineAlignment
+} // namespace DIAlign
@@ -0,0 +1,121 @@
+#ifndef BATCHALIGNMENT_H
+#define BATCHALIGNMENT_H
+
+#include <vector>
+#include <string>
+#include "similarityMatrix.h"
+#include "preparedXICGroup.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/**
+ * @brief Parameters of XIC alignment that are shared by all pairs of a batch.
+ *
+ * See getAlignedTimesCpp() for the description of each parameter.
+ */
+struct XICAlignParams
+{
+  SimilarityType simType = SimilarityType::dotProductMasked; ///< Similarity measure between fragment-ion intensities.
+  double goFactor = 0.125; ///< Gap opening penalty, multiplied by base gap-penalty.
+  double geFactor = 40; ///< Gap extension penalty, multiplied by base gap-penalty.
+  double cosAngleThresh = 0.3; ///< Used with SimilarityType::dotProductMasked.
+  bool OverlapAlignment = true; ///< True for alignment with free end-gaps.
+  double dotProdThresh = 0.96; ///< Used with SimilarityType::dotProductMasked.
+  double gapQuantile = 0.5; ///< Quantile of similarity matrix used as base gap-penalty.
+  int kerLen = 9; ///< Used with SimilarityType::crossCorrelation.
+  bool hardConstrain = false; ///< If false, cells farther from noBeef are penalized by their distance from global fit.
+  double samples4gradient = 100.0; ///< Modulates penalization of masked cells.
+  int bandWidth = 0; ///< If positive, only cells within (noBeef + bandWidth) samples of the global fit are aligned.
+  std::size_t checkpointCells = 1 << 22; ///< Full similarity matrices with more cells are aligned with CheckpointAffineAlignObj.
+  int coarseFactor = 1; ///< If more than 1, every coarseFactor-th sample is aligned first, then only the corridor around this path is aligned at full resolution.
+  int corridor = 8; ///< Half-width, in samples, of the full-resolution corridor around the coarse path.
+  double anchorQuantile = 0.0; ///< If positive, only the rectangles between chained anchors above this quantile of the similarity matrix are aligned.
+  bool approxQuantile = false; ///< If true, quantiles for gapQuantile, dotProdThresh and anchorQuantile are estimated from a histogram, see Utils::getApproxQuantile().
+};
+
+/**
+ * @brief Aligned retention times of a reference and an experiment XIC group.
+ *
+ * Only the steps of the alignment path that have a reference sample are kept. Gaps in the experiment are interpolated.
+ * A negative time means that it could not be interpolated, i.e. it is missing.
+ */
+struct AlignedTimes
+{
+  std::vector<double> tRef; ///< Aligned reference time.
+  std::vector<double> tExp; ///< Aligned experiment time.
+};
+
+namespace AffineAlignment
+{
+/**
+ * @brief Aligns two prepared XIC groups and returns aligned times.
+ *
+ * It does not call R API, hence, it can run on any thread.
+ * With params.coarseFactor > 1, the smoothed groups are decimated and aligned first. The full-resolution alignment is then
+ * restricted to the cells within params.corridor samples of the coarse path, as in banded alignment. Similarity matrix
+ * and gap penalties are those of the full-resolution alignment.
+ * With params.anchorQuantile > 0, co-eluting apices are chained with getAnchorChain() on the penalized similarity matrix
+ * and only the band from calcAnchorBand() is aligned. bandWidth takes precedence over coarseFactor, and coarseFactor over anchorQuantile.
+ * @param g1 Reference XIC group.
+ * @param g2 Experiment XIC group. Must have the same normalization and number of fragment-ions as g1.
+ * @param alignType Must be from "global", "local" and "hybrid".
+ * @param adaptiveRT Similarity matrix is not penalized within adaptiveRT of Bp.
+ * @param Bp Experiment time mapped by global fit for each reference time. Not used for alignType = "local".
+ * @param params Parameters of similarity and alignment.
+ */
+AlignedTimes alignXICGroups(const PreparedXICGroup& g1, const PreparedXICGroup& g2, const std::string& alignType,
+                            double adaptiveRT, const std::vector<double>& Bp, const XICAlignParams& params);
+
+/**
+ * @brief Aligns one reference XIC group against many experiment XIC groups on a pool of native threads.
+ *
+ * Pair k aligns eXps[k] with alignTypes[k], adaptiveRTs[k] and Bps[k]. A pair that fails does not stop the others,
+ * its result is empty and errors[k] has the message. Results are the same as those of alignXICGroups() for each pair.
+ * @param ref Reference XIC group.
+ * @param eXps Experiment XIC groups.
+ * @param alignTypes Alignment type of each pair.
+ * @param adaptiveRTs adaptiveRT of each pair.
+ * @param Bps Global fit of each pair.
+ * @param params Parameters of similarity and alignment.
+ * @param nThreads Number of threads, including the calling thread.
+ * @param errors Error message of each pair. Empty string if the pair is aligned.
+ */
+std::vector<AlignedTimes> alignXICGroupBatch(const PreparedXICGroup& ref, const std::vector<const PreparedXICGroup*>& eXps,
+                                             const std::vector<std::string>& alignTypes, const std::vector<double>& adaptiveRTs,
+                                             const std::vector<std::vector<double>>& Bps, const XICAlignParams& params,
+                                             int nThreads, std::vector<std::string>& errors);
+
+/**
+ * @brief Calculates the score of the best local alignment of two prepared XIC groups.
+ *
+ * Similarity matrix and gap penalties are the same as in alignXICGroups() for alignType = "local". Only the score is
+ * calculated with getAffineAlignmentScore(), without Traceback.
+ * @param g1 Reference XIC group.
+ * @param g2 Experiment XIC group. Must have the same normalization and number of fragment-ions as g1.
+ * @param params Parameters of similarity and alignment.
+ */
+double alignXICGroupScore(const PreparedXICGroup& g1, const PreparedXICGroup& g2, const XICAlignParams& params);
+
+/**
+ * @brief Calculates an all-pairs distance matrix among XIC groups of the same analyte from different runs.
+ *
+ * Scores s(i, j) of all pairs i <= j, including self-alignments, are calculated with alignXICGroupScore() on a pool of native threads.
+ * Distance is d(i, j) = 1 - s(i, j)/sqrt(s(i, i) * s(j, j)), hence, it is zero on the diagonal. Distance is NaN if any
+ * of the three scores could not be calculated or a self-alignment score is not positive.
+ * @param groups XIC groups, one per run.
+ * @param params Parameters of similarity and alignment.
+ * @param nThreads Number of threads, including the calling thread.
+ * @return Symmetric distance matrix of groups.size() rows in row-major order.
+ */
+std::vector<double> alignXICGroupDistances(const std::vector<const PreparedXICGroup*>& groups, const XICAlignParams& params,
+                                           int nThreads);
+} // namespace AffineAlignment
+} // namespace DIAlign
+
+#endif // BATCHALIGNMENT_H
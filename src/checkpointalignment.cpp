@@ -0,0 +1,173 @@
+#include "checkpointalignment.h"
+#include "fusedalignment.h"
+#include "affineengine.h"
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+
+namespace DIAlign
+{
+
+using namespace Traceback;
+
+CheckpointAffineAlignObj::CheckpointAffineAlignObj(int ROW_SIZE, int COL_SIZE, int blockSize){
+  if(blockSize <= 0) blockSize = std::max(1, (int)std::ceil(std::sqrt((double)ROW_SIZE)));
+  this->blockSize = blockSize;
+  int nCheck = (ROW_SIZE-1)/blockSize + 1;
+  checkM.assign((std::size_t)nCheck*COL_SIZE, 0.0);
+  checkA.assign((std::size_t)nCheck*COL_SIZE, 0.0);
+  checkB.assign((std::size_t)nCheck*COL_SIZE, 0.0);
+  lastColM.assign(ROW_SIZE, 0.0);
+  lastColA.assign(ROW_SIZE, 0.0);
+  lastColB.assign(ROW_SIZE, 0.0);
+  lastRowM.assign(COL_SIZE, 0.0);
+  lastRowA.assign(COL_SIZE, 0.0);
+  lastRowB.assign(COL_SIZE, 0.0);
+  signalA_len = ROW_SIZE-1;
+  signalB_len = COL_SIZE-1;
+  GapOpen = 0.0;
+  GapExten = 0.0;
+  FreeEndGaps = true;
+  nGaps = 0;
+}
+
+double CheckpointAffineAlignObj::getBoundaryScore(tbJump MatName, int i, int j) const{
+  double Inf = std::numeric_limits<double>::infinity();
+  if(MatName == Traceback::M) return (i == 0 && j == 0) ? 0.0 : -Inf;
+  if(MatName == Traceback::A && j == 0 && i > 0) return FreeEndGaps ? 0.0 : -(i-1)*GapExten - GapOpen;
+  if(MatName == Traceback::B && i == 0 && j > 0) return FreeEndGaps ? 0.0 : -(j-1)*GapExten - GapOpen;
+  return -Inf;
+}
+
+namespace AffineAlignment
+{
+
+// It fills M, A and B row-by-row and keeps every blockSize-th row.
+void doCheckpointAffineAlignment(CheckpointAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty,
+                                 double go, double ge, bool OverlapAlignment){
+  validateAffineAlignment("CheckpointAffineAlignObj", obj.signalA_len, obj.signalB_len, s, penalty, go, ge);
+  obj.FreeEndGaps = OverlapAlignment;
+  obj.GapOpen = go;
+  obj.GapExten = ge;
+  int ROW_SIZE = obj.signalA_len + 1;
+  int COL_SIZE = obj.signalB_len + 1;
+  int K = obj.blockSize;
+
+  std::vector<double> prevM(COL_SIZE), prevA(COL_SIZE), prevB(COL_SIZE);
+  std::vector<double> curM(COL_SIZE), curA(COL_SIZE), curB(COL_SIZE);
+  std::vector<TracebackType> tbM(COL_SIZE), tbA(COL_SIZE), tbB(COL_SIZE); // Traceback is not kept in the forward pass.
+  std::vector<double> sRow(s.n_col);
+  for(int j = 0; j < COL_SIZE; j++){
+    prevM[j] = obj.getBoundaryScore(Traceback::M, 0, j);
+    prevA[j] = obj.getBoundaryScore(Traceback::A, 0, j);
+    prevB[j] = obj.getBoundaryScore(Traceback::B, 0, j);
+  }
+  std::copy(prevM.begin(), prevM.end(), obj.checkM.begin());
+  std::copy(prevA.begin(), prevA.end(), obj.checkA.begin());
+  std::copy(prevB.begin(), prevB.end(), obj.checkB.begin());
+  obj.lastColM[0] = prevM[COL_SIZE-1];
+  obj.lastColA[0] = prevA[COL_SIZE-1];
+  obj.lastColB[0] = prevB[COL_SIZE-1];
+
+  for(int i = 1; i < ROW_SIZE; i++){
+    curM[0] = obj.getBoundaryScore(Traceback::M, i, 0);
+    curA[0] = obj.getBoundaryScore(Traceback::A, i, 0);
+    curB[0] = obj.getBoundaryScore(Traceback::B, i, 0);
+    fillAffineRow(s, penalty, i, go, ge, &prevM[0], &prevA[0], &prevB[0], &curM[0], &curA[0], &curB[0],
+                  &tbM[0], &tbA[0], &tbB[0], sRow);
+    obj.lastColM[i] = curM[COL_SIZE-1];
+    obj.lastColA[i] = curA[COL_SIZE-1];
+    obj.lastColB[i] = curB[COL_SIZE-1];
+    if(i % K == 0){
+      std::size_t offset = (std::size_t)(i/K)*COL_SIZE;
+      std::copy(curM.begin(), curM.end(), obj.checkM.begin() + offset);
+      std::copy(curA.begin(), curA.end(), obj.checkA.begin() + offset);
+      std::copy(curB.begin(), curB.end(), obj.checkB.begin() + offset);
+    }
+    prevM.swap(curM);
+    prevA.swap(curA);
+    prevB.swap(curB);
+  }
+  obj.lastRowM = prevM;
+  obj.lastRowA = prevA;
+  obj.lastRowB = prevB;
+}
+
+void getCheckpointAffineAlignedIndices(CheckpointAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty){
+  int ROW_SIZE = obj.signalA_len + 1;
+  int COL_SIZE = obj.signalB_len + 1;
+  int K = obj.blockSize;
+
+  // Rows of the current block, recomputed from its upper checkpoint.
+  std::size_t blockCells = (std::size_t)std::min(K, ROW_SIZE-1)*COL_SIZE;
+  std::vector<double> blkM(blockCells), blkA(blockCells), blkB(blockCells);
+  std::vector<TracebackType> blkTb(3*blockCells);
+  std::vector<double> sRow(s.n_col);
+  int curBlock = -1;
+  auto loadBlock = [&](int b){
+    int r0 = b*K, r1 = std::min(r0 + K, ROW_SIZE-1);
+    std::size_t offset = (std::size_t)b*COL_SIZE;
+    const double* pM = &obj.checkM[offset];
+    const double* pA = &obj.checkA[offset];
+    const double* pB = &obj.checkB[offset];
+    for(int i = r0+1; i <= r1; i++){
+      std::size_t r = (std::size_t)(i-r0-1)*COL_SIZE;
+      blkM[r] = obj.getBoundaryScore(Traceback::M, i, 0);
+      blkA[r] = obj.getBoundaryScore(Traceback::A, i, 0);
+      blkB[r] = obj.getBoundaryScore(Traceback::B, i, 0);
+      fillAffineRow(s, penalty, i, obj.GapOpen, obj.GapExten, pM, pA, pB, &blkM[r], &blkA[r], &blkB[r],
+                    &blkTb[r], &blkTb[blockCells + r], &blkTb[2*blockCells + r], sRow);
+      pM = &blkM[r];
+      pA = &blkA[r];
+      pB = &blkB[r];
+    }
+    curBlock = b;
+  };
+  // Index of cell (i, j) in the block. i and j must be positive.
+  auto blockIdx = [&](int i, int j){
+    int b = (i-1)/K;
+    if(b != curBlock) loadBlock(b);
+    return (std::size_t)(i-1-b*K)*COL_SIZE + j;
+  };
+  auto getScore = [&](tbJump mat, int i, int j){
+    if(i == 0 || j == 0) return obj.getBoundaryScore(mat, i, j);
+    std::size_t idx = blockIdx(i, j);
+    if(mat == Traceback::M) return blkM[idx];
+    if(mat == Traceback::A) return blkA[idx];
+    return blkB[idx];
+  };
+  auto getTraceback = [&](tbJump mat, int i, int j){
+    if(i == 0 || j == 0){
+      // Same as the first row and column initialized in doAffineAlignment().
+      if(mat == Traceback::A && j == 0 && i > 0) return (i == 1) ? TM : TA;
+      if(mat == Traceback::B && i == 0 && j > 0) return (j == 1) ? LM : LB;
+      return SS;
+    }
+    std::size_t idx = blockIdx(i, j);
+    return blkTb[mat*blockCells + idx];
+  };
+
+  // Start-cell is searched in the last row and column, which are kept. Other cells are read from the current block.
+  auto getStartScore = [&](tbJump mat, int i, int j){
+    if(j == obj.signalB_len){
+      if(mat == Traceback::M) return obj.lastColM[i];
+      if(mat == Traceback::A) return obj.lastColA[i];
+      return obj.lastColB[i];
+    }
+    if(mat == Traceback::M) return obj.lastRowM[j];
+    if(mat == Traceback::A) return obj.lastRowA[j];
+    return obj.lastRowB[j];
+  };
+  // Scores are read while tracing back, because each block is recomputed only once, from the bottom of the path upwards.
+  std::vector<double> tracedScore;
+  auto getTracebackAndScore = [&](tbJump mat, int i, int j){
+    tracedScore.push_back(getScore(mat, i, j));
+    return getTraceback(mat, i, j);
+  };
+  traceAffinePath(obj, getStartScore, getTracebackAndScore, [&](const std::vector<PathCell>& path, std::vector<double>& pathScore){
+    for(std::size_t k = 1; k < path.size(); k++) pathScore[k] = tracedScore[k];
+  });
+}
+
+} // namespace AffineAlignment
+} // namespace DIAlign
@@ -0,0 +1,93 @@
+#ifndef CHECKPOINTALIGNMENT_H
+#define CHECKPOINTALIGNMENT_H
+
+#include <vector>
+#include <limits>
+#include "affinealignobj.h"
+#include "affinealignment.h"
+#include "constrainMat.h"
+#include "similarityMatrix.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/**
+ * @brief An affine alignment object that keeps M, A and B only at checkpoint rows and no Traceback.
+ *
+ * Every blockSize-th row of M, A and B is kept during the fill. During traceback, rows between two checkpoints are
+ * recomputed from the upper checkpoint, one block at a time, together with their Traceback. Each block is recomputed
+ * at most once because the path only moves upward. With blockSize ~ sqrt(ROW_SIZE), memory is
+ * O(sqrt(ROW_SIZE) * COL_SIZE) instead of O(ROW_SIZE * COL_SIZE), for about twice the fill time.
+ */
+struct CheckpointAffineAlignObj
+{
+  std::vector<double> checkM; ///< Rows 0, blockSize, 2*blockSize, ... of matrix M.
+  std::vector<double> checkA; ///< Rows 0, blockSize, 2*blockSize, ... of matrix A.
+  std::vector<double> checkB; ///< Rows 0, blockSize, 2*blockSize, ... of matrix B.
+  std::vector<double> lastColM; ///< Last column of matrix M.
+  std::vector<double> lastColA; ///< Last column of matrix A.
+  std::vector<double> lastColB; ///< Last column of matrix B.
+  std::vector<double> lastRowM; ///< Last row of matrix M.
+  std::vector<double> lastRowA; ///< Last row of matrix A.
+  std::vector<double> lastRowB; ///< Last row of matrix B.
+  int signalA_len; ///< Number of data-points in signal A.
+  int signalB_len; ///< Number of data-points in signal B.
+  int blockSize; ///< Number of rows between two checkpoints.
+  double GapOpen; ///< Penalty for Gap opening. For n consecutive gaps: Penalty = GapOpen + (n-1)*GapExten.
+  double GapExten; ///< Penalty for Gap extension. For n consecutive gaps: Penalty = GapOpen + (n-1)*GapExten.
+  bool FreeEndGaps; ///< True for Overlap alignment.
+  std::vector<int> indexA_aligned; ///< Aligned signalA indices after affine alignment.
+  std::vector<int> indexB_aligned; ///< Aligned signalB indices after affine alignment.
+  std::vector<double> score;  ///< Cumulative score along the aligned path.
+  int nGaps; ///< Total number of gaps in the alignment path.
+
+  /**
+   * @brief Constructor for CheckpointAffineAlignObj.
+   *
+   * @param ROW_SIZE Number of rows in matrix M.
+   * @param COL_SIZE Number of columns in matrix M.
+   * @param blockSize Number of rows between two checkpoints. If not positive, ceil(sqrt(ROW_SIZE)) is used.
+   */
+  CheckpointAffineAlignObj(int ROW_SIZE, int COL_SIZE, int blockSize = 0);
+
+  /// Score of the first row or column of matrix MatName at (i, j), as initialized in doAffineAlignment().
+  double getBoundaryScore(Traceback::tbJump MatName, int i, int j) const;
+};
+
+namespace AffineAlignment
+{
+/**
+ * @brief Performs affine alignment keeping only checkpoint rows of M, A and B.
+ *
+ * Rows are filled with fillAffineRow() as in doFusedAffineAlignment(), hence, scores and ties are identical to
+ * doAffineAlignment() on s constrained by penalty.
+ *
+ * @param obj An object of class CheckpointAffineAlignObj. It must be initialized with ROW_SIZE and COL_SIZE one more than that of s.
+ * @param s similarity score matrix. It is not modified.
+ * @param penalty Penalty added to each row of s. If NULL, s is aligned as it is.
+ * @param go gap opening penalty in alignment path.
+ * @param ge gap extension penalty in alignment path.
+ * @param OverlapAlignment If true, end gaps are not penalized.
+ */
+void doCheckpointAffineAlignment(CheckpointAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty,
+                                 double go, double ge, bool OverlapAlignment);
+
+/**
+ * @brief Calculates aligned indices for source signal A and B from CheckpointAffineAlignObj.
+ *
+ * Start-cell search and traceback are the same as in getAffineAlignedIndices(). indexA_aligned, indexB_aligned,
+ * score and nGaps are identical to those from AffineAlignObj.
+ * @param obj An object of class CheckpointAffineAlignObj. Must have been operated by doCheckpointAffineAlignment() function before.
+ * @param s similarity score matrix passed to doCheckpointAffineAlignment().
+ * @param penalty penalty passed to doCheckpointAffineAlignment().
+ */
+void getCheckpointAffineAlignedIndices(CheckpointAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty);
+} // namespace AffineAlignment
+} // namespace DIAlign
+
+#endif // CHECKPOINTALIGNMENT_H
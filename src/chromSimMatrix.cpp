@@ -2,6 +2,7 @@
 #include <functional>
 #include <algorithm>
 #include <cmath>
+#include <stdexcept>
 
 namespace DIAlign
 {
@@ -9,6 +10,236 @@ namespace DIAlign
 namespace SimilarityMatrix
 {
 
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Pointer to the first sample of each fragment-ion. Kernels below are shared by vectors of vectors and by ChromatogramView.
+  typedef std::vector<const double*> Fragments;
+
+  Fragments fragments(const std::vector<std::vector<double> >& vov){
+    Fragments d(vov.size());
+    for (std::size_t k = 0; k < vov.size(); k++) d[k] = vov[k].data();
+    return d;
+  }
+
+  Fragments fragments(const ChromatogramView& v){
+    Fragments d(v.nFrag);
+    for (int k = 0; k < v.nFrag; k++) d[k] = v.fragment(k);
+    return d;
+  }
+
+  // Sum of fragment-ion intensities at each of len samples.
+  std::vector<double> perSampleSum(const Fragments& d, int len){
+    std::vector<double> sum(len, 0.0);
+    int n_frag = d.size();
+    for (int i = 0; i < len; i++){
+      for (int fragIon = 0; fragIon < n_frag; fragIon++){
+        sum[i] += d[fragIon][i];
+      }
+    }
+    return sum;
+  }
+
+  // Sum of squares of fragment-ion intensities at each of len samples.
+  std::vector<double> perSampleSqrSum(const Fragments& d, int len){
+    std::vector<double> mag(len, 0.0);
+    int n_frag = d.size();
+    for (int i = 0; i < len; i++){
+      for (int fragIon = 0; fragIon < n_frag; fragIon++){
+        mag[i] += d[fragIon][i] * d[fragIon][i];
+      }
+    }
+    return mag;
+  }
+
+  // Element-wise kernels take d1 of s.n_row and d2 of s.n_col samples.
+  void addXcorr(const double* d1, const double* d2, SimMatrix& s, int halfKer){
+    int nrow = s.n_row;
+    int ncol = s.n_col;
+    // Sum of products over the kernel along the diagonal through (i, j), in the order of the kernel.
+    auto kernelSum = [&](int i, int j){
+      double sum = 0.0;
+      for(int temp = -halfKer; temp < halfKer+1; ++temp){
+        int row = i + temp;
+        int col = j + temp;
+        if(row < 0 || col < 0 || row >= nrow || col >=ncol) continue;
+        sum += d1[row]*d2[col]; // summing product of vectors across fragment-ions.
+      }
+      return sum;
+    };
+    // Kernel of (i, j) is that of (i-1, j-1) shifted by one along the diagonal. The sum is slided from the previous row,
+    // and recomputed every few cells of a diagonal so that rounding errors do not accumulate. Cost does not depend on halfKer.
+    int reanchor = std::max(2*halfKer + 1, 32);
+    std::vector<double> prevSum(ncol, 0.0), curSum(ncol, 0.0);
+    for (int i = 0; i < nrow; i++){
+      for(int j = 0; j < ncol; j++){
+        double sum;
+        if(std::min(i, j) % reanchor == 0){
+          sum = kernelSum(i, j);
+        } else {
+          sum = prevSum[j-1];
+          if(i + halfKer < nrow && j + halfKer < ncol) sum += d1[i+halfKer]*d2[j+halfKer];
+          if(i-1-halfKer >= 0 && j-1-halfKer >= 0) sum -= d1[i-1-halfKer]*d2[j-1-halfKer];
+        }
+        curSum[j] = sum;
+        // Number of kernel positions inside the matrix.
+        int first = std::max(-halfKer, -std::min(i, j));
+        int last = std::min(halfKer, std::min(nrow-1-i, ncol-1-j));
+        double count = last - first + 1;
+        s.data[i*ncol + j] += sum/count; // normalizing cross-correlation.
+      }
+      std::swap(prevSum, curSum);
+    }
+  }
+
+  void addOuterProd(const double* d1, const double* d2, SimMatrix& s){
+    int nrow = s.n_row;
+    int ncol = s.n_col;
+    for (int i = 0; i < nrow; i++){
+      for(int j = 0; j < ncol; j++){
+        s.data[i*ncol + j] += d1[i]*d2[j]; // Summing outer product of vectors across fragment-ions.
+      }
+    }
+  }
+
+  void addOuterProdMeanSub(const double* d1, const double* d2, SimMatrix& s, const std::vector<double>& mean1, const std::vector<double>& mean2){
+    int nrow = s.n_row;
+    int ncol = s.n_col;
+    for (int i = 0; i < nrow; i++){
+      for(int j = 0; j < ncol; j++){
+        s.data[i*ncol + j] += (d1[i]-mean1[i])*(d2[j]-mean2[j]); // Summing outer product of vectors across fragment-ions.
+      }
+    }
+  }
+
+  void addOuterEucl(const double* d1, const double* d2, SimMatrix& s){
+    int nrow = s.n_row;
+    int ncol = s.n_col;
+    for (int i = 0; i < nrow; i++){
+      for(int j = 0; j < ncol; j++){
+        s.data[i*ncol + j] += (d1[i]-d2[j]) * (d1[i]-d2[j]); // Summing outer product of vectors across fragment-ions.
+      }
+    }
+  }
+
+  void addOuterCosine(const double* d1, const double* d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s){
+    int nrow = s.n_row;
+    int ncol = s.n_col;
+    for (int i = 0; i < nrow; i++){
+      for(int j = 0; j < ncol; j++){
+        s.data[i*ncol + j] += d1[i]*d2[j]/((d1_mag[i]+1e-06)*(d2_mag[j]+1e-06)); // Summing outer product of vectors across fragment-ions.
+      }
+    }
+  }
+
+  // See BlockedSumOuterProd().
+  void blockedSumOuterProd(const Fragments& d1, const Fragments& d2, SimMatrix& s){
+    int n_frag = d1.size();
+    int nrow = s.n_row;
+    int ncol = s.n_col;
+    // 256 columns of s and of each d2 vector take 2 KB each, which leaves L1 cache for a few fragment-ions.
+    const int blockSize = 256;
+    for (int j0 = 0; j0 < ncol; j0 += blockSize){
+      int j1 = std::min(j0 + blockSize, ncol);
+      for (int i = 0; i < nrow; i++){
+        double* sRow = &s.data[i*ncol];
+        for (int fragIon = 0; fragIon < n_frag; fragIon++){
+          double a = d1[fragIon][i];
+          const double* b = d2[fragIon];
+          for(int j = j0; j < j1; j++){
+            sRow[j] += a*b[j]; // Summing outer product of vectors across fragment-ions.
+          }
+        }
+      }
+    }
+  }
+
+  void sumXcorr(const Fragments& d1, const Fragments& d2, SimMatrix& s, int kerLen){
+    // Calculate outer dot-product for each fragment-ion and sum element-wise
+    int n_frag = d1.size();
+    for (int fragIon = 0; fragIon < n_frag; fragIon++){
+      addXcorr(d1[fragIon], d2[fragIon], s, (kerLen-1)/2);
+    }
+  }
+
+  void sumOuterCov(const Fragments& d1, const Fragments& d2, const std::vector<double>& d1_mean, const std::vector<double>& d2_mean, SimMatrix& s){
+    // Calculate outer dot-product for each fragment-ion and sum element-wise
+    int n_frag = d1.size();
+    for (int fragIon = 0; fragIon < n_frag; fragIon++){
+      addOuterProdMeanSub(d1[fragIon], d2[fragIon], s, d1_mean, d2_mean);
+    }
+    std::transform(s.data.begin(), s.data.end(), s.data.begin(), std::bind(std::divides<double>(), std::placeholders::_1, n_frag-1));
+  }
+
+  void sumOuterCorr(const Fragments& d1, const Fragments& d2, const std::vector<double>& d1_sum, const std::vector<double>& d2_sum,
+                    const std::vector<double>& d1_squareSum, const std::vector<double>& d2_squareSum, SimMatrix& s){
+    // Calculate outer dot-product for all fragment-ions in one pass over s.
+    int n_frag = d1.size();
+    blockedSumOuterProd(d1, d2, s);
+    double var1, var2 = 0.0;
+
+    for (int i = 0; i < s.n_row; i++){
+      for(int j = 0; j < s.n_col; j++){
+        var1 = n_frag*d1_squareSum[i]-d1_sum[i]*d1_sum[i];
+        var2 = n_frag*d2_squareSum[j]-d2_sum[j]*d2_sum[j];
+        if(var1 < 0.0 || var2 <= 0.0){
+          // Rcpp::Rcout << "In SumOuterCorr the standard deviation is zero" << std::endl;
+          s.data[i*s.n_col+j] = 0; // TODO: What to output in this case?
+        }
+        else
+          s.data[i*s.n_col+j] = (n_frag*s.data[i*s.n_col+j] - d1_sum[i]*d2_sum[j])/sqrt(var1*var2); // Summing outer product of vectors across fragment-ions.
+      }
+    }
+  }
+
+  void sumOuterEucl(const Fragments& d1, const Fragments& d2, SimMatrix& s){
+    // Calculate outer-euclidean distance for each sample.
+    int n_frag = d1.size();
+    for (int fragIon = 0; fragIon < n_frag; fragIon++){
+      addOuterEucl(d1[fragIon], d2[fragIon], s);
+    }
+    // Take sqrt to get eucledian distance from the sum of squared-differences.
+    // TODO std::ptr_fun<double, double> Why? Effectively calls std::pointer_to_unary_function<Arg,Result>(f)
+    std::transform(s.data.begin(), s.data.end(), s.data.begin(), [](double f){return sqrt(f);});
+    // Convert distance into similarity.
+    distToSim(s, 1.0, 1.0); // distance = Numerator/(offset + similarity)
+  }
+
+  void sumOuterCosine(const Fragments& d1, const Fragments& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s){
+    int n_frag = d1.size();
+    for (int fragIon = 0; fragIon < n_frag; fragIon++){
+      addOuterCosine(d1[fragIon], d2[fragIon], d1_mag, d2_mag, s);
+    }
+    clamp(s.data, -1.0, 1.0); // Clamp the cosine similarity between -1.0 and 1.0
+  }
+
+  void sumOuterProdMasked(const Fragments& d1, const Fragments& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag,
+                          SimMatrix& s, double cosAngleThresh, double dotProdThresh, bool approxQuantile = false){
+    blockedSumOuterProd(d1, d2, s);
+    double Quant = approxQuantile ? Utils::getApproxQuantile(s.data, dotProdThresh) : Utils::getQuantile(s.data, dotProdThresh);
+
+    // Cells below the quantile are kept if 1.0 > cosAngleThresh. Hence, cosine is needed only for the cells above it.
+    double keepBelowQuant = (1.0 > cosAngleThresh) ? 1.0 : 0.0;
+    int n_frag = d1.size();
+    for (int i = 0; i < s.n_row; i++){
+      for(int j = 0; j < s.n_col; j++){
+        double& sij = s.data[i*s.n_col + j];
+        if(sij < Quant){
+          sij = sij * keepBelowQuant;
+          continue;
+        }
+        // Same summation as ElemWiseOuterCosine() over fragment-ions, followed by clamp().
+        double cosAngle = 0.0;
+        for (int fragIon = 0; fragIon < n_frag; fragIon++){
+          cosAngle += d1[fragIon][i]*d2[fragIon][j]/((d1_mag[i]+1e-06)*(d2_mag[j]+1e-06));
+        }
+        cosAngle = (cosAngle > 1.0) ? 1.0 : cosAngle;
+        cosAngle = (cosAngle < -1.0) ? -1.0 : cosAngle;
+        sij = (cos2Angle(cosAngle) > cosAngleThresh) ? sij * 1.0 : sij * 0.0;
+      }
+    }
+  }
+}
+
 double meanVecOfVec(const std::vector<std::vector<double> >& vov){
   double average = 0.0;
   // Sum-up mean of each vector using Range-based for loop.
@@ -26,53 +257,24 @@ double eucLenVecOfVec(const std::vector<std::vector<double> >& vov){
 
 // Eucledian length at each time-point.
 std::vector<double> perSampleEucLenVecOfVec(const std::vector<std::vector<double> >& vov){
-  std::vector<double> mag;
-  mag.resize(vov[0].size(), 0.0);
-  int n_frag = vov.size();
-  for (int i = 0; i < mag.size(); i++){
-    for (int fragIon = 0; fragIon < n_frag; fragIon++){
-      mag[i] += vov[fragIon][i] * vov[fragIon][i];
-    }
-    mag[i] = std::sqrt(mag[i]);
-  }
+  std::vector<double> mag = perSampleSqrSum(fragments(vov), vov[0].size());
+  for (auto& m : mag) m = std::sqrt(m);
   return mag;
 }
 
 std::vector<double> perSampleSqrSumVecOfVec(const std::vector<std::vector<double> >& vov){
-  std::vector<double> mag;
-  mag.resize(vov[0].size(), 0.0);
-  int n_frag = vov.size();
-  for (int i = 0; i < mag.size(); i++){
-    for (int fragIon = 0; fragIon < n_frag; fragIon++){
-      mag[i] += vov[fragIon][i] * vov[fragIon][i];
-    }
-  }
-  return mag;
+  return perSampleSqrSum(fragments(vov), vov[0].size());
 }
 
 std::vector<double> perSampleMeanVecOfVec(const std::vector<std::vector<double> >& vov){
-  std::vector<double> mean;
-  mean.resize(vov[0].size(), 0.0);
+  std::vector<double> mean = perSampleSum(fragments(vov), vov[0].size());
   int n_frag = vov.size();
-  for (int i = 0; i < mean.size(); i++){
-    for (int fragIon = 0; fragIon < n_frag; fragIon++){
-      mean[i] += vov[fragIon][i];
-    }
-    mean[i] = mean[i]/n_frag;
-  }
+  for (auto& m : mean) m = m/n_frag;
   return mean;
 }
 
 std::vector<double> perSampleSumVecOfVec(const std::vector<std::vector<double> >& vov){
-  std::vector<double> sum;
-  sum.resize(vov[0].size(), 0.0);
-  int n_frag = vov.size();
-  for (int i = 0; i < sum.size(); i++){
-    for (int fragIon = 0; fragIon < n_frag; fragIon++){
-      sum[i] += vov[fragIon][i];
-    }
-  }
-  return sum;
+  return perSampleSum(fragments(vov), vov[0].size());
 }
 
 // TODO Understand this code
@@ -101,6 +303,39 @@ std::vector<std::vector<double>> L2NormalizeVecOfVec(const std::vector<std::vect
   return vov_new;
 }
 
+void divideVecOfVecInto(const std::vector<std::vector<double>>& vov, double num, std::vector<std::vector<double>>& out){
+  out.resize(vov.size());
+  for (std::size_t k = 0; k < vov.size(); k++){
+    out[k].resize(vov[k].size());
+    std::transform(vov[k].begin(), vov[k].end(), out[k].begin(), std::bind(std::divides<double>(), std::placeholders::_1, num + 1e-08));
+  }
+}
+
+const std::vector<std::vector<double>>& normalizeVecOfVec(const std::vector<std::vector<double>>& vov, NormalizationType Norm,
+                                                          std::vector<std::vector<double>>& scratch){
+  if(Norm == NormalizationType::mean) return normalizeVecOfVec<NormalizationType::mean>(vov, scratch);
+  if(Norm == NormalizationType::L2) return normalizeVecOfVec<NormalizationType::L2>(vov, scratch);
+  return vov;
+}
+
+SimilarityType getSimilarityType(const std::string& SimType){
+  if (SimType == "dotProductMasked") return SimilarityType::dotProductMasked;
+  if (SimType == "dotProduct") return SimilarityType::dotProduct;
+  if (SimType == "cosineAngle") return SimilarityType::cosineAngle;
+  if (SimType == "cosine2Angle") return SimilarityType::cosine2Angle;
+  if (SimType == "euclideanDist") return SimilarityType::euclideanDist;
+  if (SimType == "covariance") return SimilarityType::covariance;
+  if (SimType == "correlation") return SimilarityType::correlation;
+  if (SimType == "crossCorrelation") return SimilarityType::crossCorrelation;
+  return SimilarityType::unknown;
+}
+
+NormalizationType getNormalizationType(const std::string& Normalization){
+  if(Normalization == "mean") return NormalizationType::mean;
+  if(Normalization == "L2") return NormalizationType::L2;
+  return NormalizationType::none;
+}
+
 // TODO: Protect against divide-by-zero
 std::vector<std::vector<double>> divideVecOfVec(const std::vector<std::vector<double>>& d, double num){
   std::vector<std::vector<double>> result;
@@ -113,57 +348,25 @@ std::vector<std::vector<double>> divideVecOfVec(const std::vector<std::vector<do
 void ElemWiseSumXcorr(const std::vector<double>& d1, const std::vector<double>& d2, SimMatrix& s, int halfKer){
   DIALIGN_PRECONDITION(s.n_row == d1.size(), "Data vector size (vector 1) needs to equal matrix dimension");
   DIALIGN_PRECONDITION(s.n_col == d2.size(), "Data vector size (vector 2) needs to equal matrix dimension");
-  int nrow = d1.size();
-  int ncol = d2.size();
-  for (int i = 0; i < nrow; i++){
-    for(int j = 0; j < ncol; j++){
-      double count = 0.0, sum = 0.0;
-      for(int temp = -halfKer; temp < halfKer+1; ++temp){
-        int row = i + temp;
-        int col = j + temp;
-        if(row < 0 || col < 0 || row >= nrow || col >=ncol) continue;
-        count += 1.0;
-        sum += d1[row]*d2[col]; // summing product of vectors across fragment-ions.
-      }
-      s.data[i*ncol + j] += sum/count; // normalizing cross-correlation.
-    }
-  }
+  addXcorr(d1.data(), d2.data(), s, halfKer);
 }
 
 void ElemWiseSumOuterProd(const std::vector<double>& d1, const std::vector<double>& d2, SimMatrix& s){
   DIALIGN_PRECONDITION(s.n_row == d1.size(), "Data vector size (vector 1) needs to equal matrix dimension");
   DIALIGN_PRECONDITION(s.n_col == d2.size(), "Data vector size (vector 2) needs to equal matrix dimension");
-  int nrow = d1.size();
-  int ncol = d2.size();
-  for (int i = 0; i < nrow; i++){
-    for(int j = 0; j < ncol; j++){
-      s.data[i*ncol + j] += d1[i]*d2[j]; // Summing outer product of vectors across fragment-ions.
-    }
-  }
+  addOuterProd(d1.data(), d2.data(), s);
 }
 
 void ElemWiseSumOuterProdMeanSub(const std::vector<double>& d1, const std::vector<double>& d2, SimMatrix& s, const std::vector<double>& mean1, const std::vector<double>& mean2){
   DIALIGN_PRECONDITION(s.n_row == d1.size(), "Data vector size (vector 1) needs to equal matrix dimension");
   DIALIGN_PRECONDITION(s.n_col == d2.size(), "Data vector size (vector 2) needs to equal matrix dimension");
-  int nrow = d1.size();
-  int ncol = d2.size();
-  for (int i = 0; i < nrow; i++){
-    for(int j = 0; j < ncol; j++){
-      s.data[i*ncol + j] += (d1[i]-mean1[i])*(d2[j]-mean2[j]); // Summing outer product of vectors across fragment-ions.
-    }
-  }
+  addOuterProdMeanSub(d1.data(), d2.data(), s, mean1, mean2);
 }
 
 void ElemWiseSumOuterEucl(const std::vector<double>& d1, const std::vector<double>& d2, SimMatrix& s){
   DIALIGN_PRECONDITION(s.n_row == d1.size(), "Data vector size (vector 1) needs to equal matrix dimension");
   DIALIGN_PRECONDITION(s.n_col == d2.size(), "Data vector size (vector 2) needs to equal matrix dimension");
-  int nrow = d1.size();
-  int ncol = d2.size();
-  for (int i = 0; i < nrow; i++){
-    for(int j = 0; j < ncol; j++){
-      s.data[i*ncol + j] += (d1[i]-d2[j]) * (d1[i]-d2[j]); // Summing outer product of vectors across fragment-ions.
-    }
-  }
+  addOuterEucl(d1.data(), d2.data(), s);
 }
 
 void ElemWiseOuterCosine(const std::vector<double>& d1, const std::vector<double>& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s){
@@ -171,271 +374,297 @@ void ElemWiseOuterCosine(const std::vector<double>& d1, const std::vector<double
   DIALIGN_PRECONDITION(s.n_col == d2.size(), "Data vector size (vector 2) needs to equal matrix dimension");
   DIALIGN_PRECONDITION(d1_mag.size() == d1.size(), "Data vector size (vector 1) needs to equal matrix dimension");
   DIALIGN_PRECONDITION(d2_mag.size() == d2.size(), "Data vector size (vector 2) needs to equal matrix dimension");
-  int nrow = s.n_row;
-  int ncol = s.n_col;
-  for (int i = 0; i < nrow; i++){
-    for(int j = 0; j < ncol; j++){
-      s.data[i*ncol + j] += d1[i]*d2[j]/((d1_mag[i]+1e-06)*(d2_mag[j]+1e-06)); // Summing outer product of vectors across fragment-ions.
-    }
+  addOuterCosine(d1.data(), d2.data(), d1_mag, d2_mag, s);
+}
+
+void BlockedSumOuterProd(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s){
+  DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
+  int n_frag = d1.size();
+  for (int fragIon = 0; fragIon < n_frag; fragIon++){
+    DIALIGN_PRECONDITION(s.n_row == d1[fragIon].size(), "Data vector size (vector 1) needs to equal matrix dimension");
+    DIALIGN_PRECONDITION(s.n_col == d2[fragIon].size(), "Data vector size (vector 2) needs to equal matrix dimension");
   }
+  blockedSumOuterProd(fragments(d1), fragments(d2), s);
 }
 
-void SumXcorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s, int kerLen){
+void SumXcorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s, int kerLen){
   DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
   DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
   DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
   DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
   DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
-  std::vector<std::vector<double>> d1_new, d2_new;
-  if(Normalization == "mean"){
-    // Mean normalize each vector of vector.
-    d1_new = meanNormalizeVecOfVec(d1);
-    d2_new = meanNormalizeVecOfVec(d2);
-  } else if(Normalization == "L2"){
-    // L2 normalize each vector of vector.
-    d1_new = L2NormalizeVecOfVec(d1);
-    d2_new = L2NormalizeVecOfVec(d2);
-  } else {
-    d1_new = d1;
-    d2_new = d2;
-  }
-  // Calculate outer dot-product for each fragment-ion and sum element-wise
-  int n_frag = d1.size();
-  for (int fragIon = 0; fragIon < n_frag; fragIon++){
-    ElemWiseSumXcorr(d1_new[fragIon], d2_new[fragIon], s, (kerLen-1)/2);
-  }
+  sumXcorr(fragments(d1), fragments(d2), s, kerLen);
 }
 
-void SumOuterProd(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+void SumOuterProd(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s){
   DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
   DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
   DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
   DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
   DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
-  std::vector<std::vector<double>> d1_new, d2_new;
-  if(Normalization == "mean"){
-    // Mean normalize each vector of vector.
-    d1_new = meanNormalizeVecOfVec(d1);
-    d2_new = meanNormalizeVecOfVec(d2);
-  } else if(Normalization == "L2"){
-    // L2 normalize each vector of vector.
-    d1_new = L2NormalizeVecOfVec(d1);
-    d2_new = L2NormalizeVecOfVec(d2);
-  } else {
-    d1_new = d1;
-    d2_new = d2;
-  }
-  // Calculate outer dot-product for each fragment-ion and sum element-wise
-  int n_frag = d1.size();
-  for (int fragIon = 0; fragIon < n_frag; fragIon++){
-    ElemWiseSumOuterProd(d1_new[fragIon], d2_new[fragIon], s);
-  }
+  // Calculate outer dot-product for all fragment-ions in one pass over s.
+  blockedSumOuterProd(fragments(d1), fragments(d2), s);
 }
 
-void SumOuterCov(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+void SumOuterCov(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s){
+  DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
+  SumOuterCov(d1, d2, perSampleMeanVecOfVec(d1), perSampleMeanVecOfVec(d2), s);
+}
+
+void SumOuterCov(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_mean, const std::vector<double>& d2_mean, SimMatrix& s){
   DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
   DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
   DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
   DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
   DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
-  std::vector<std::vector<double>> d1_new, d2_new;
-  if(Normalization == "mean"){
-    // Mean normalize each vector of vector.
-    d1_new = meanNormalizeVecOfVec(d1);
-    d2_new = meanNormalizeVecOfVec(d2);
-  } else if(Normalization == "L2"){
-    // L2 normalize each vector of vector.
-    d1_new = L2NormalizeVecOfVec(d1);
-    d2_new = L2NormalizeVecOfVec(d2);
-  } else {
-    d1_new = d1;
-    d2_new = d2;
-  }
-  std::vector<double> d1_mean = perSampleMeanVecOfVec(d1_new);
-  std::vector<double> d2_mean = perSampleMeanVecOfVec(d2_new);
-  // Calculate outer dot-product for each fragment-ion and sum element-wise
-  int n_frag = d1.size();
-  for (int fragIon = 0; fragIon < n_frag; fragIon++){
-    ElemWiseSumOuterProdMeanSub(d1_new[fragIon], d2_new[fragIon], s, d1_mean, d2_mean);
-  }
-  std::transform(s.data.begin(), s.data.end(), s.data.begin(), std::bind(std::divides<double>(), std::placeholders::_1, n_frag-1));
+  sumOuterCov(fragments(d1), fragments(d2), d1_mean, d2_mean, s);
 }
 
-void SumOuterCorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+void SumOuterCorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s){
+  DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
+  SumOuterCorr(d1, d2, perSampleSumVecOfVec(d1), perSampleSumVecOfVec(d2), perSampleSqrSumVecOfVec(d1), perSampleSqrSumVecOfVec(d2), s);
+}
+
+void SumOuterCorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_sum, const std::vector<double>& d2_sum,
+                  const std::vector<double>& d1_squareSum, const std::vector<double>& d2_squareSum, SimMatrix& s){
   DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
   DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
   DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
   DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
   DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
-  std::vector<std::vector<double>> d1_new, d2_new;
-  if(Normalization == "mean"){
-    // Mean normalize each vector of vector.
-    d1_new = meanNormalizeVecOfVec(d1);
-    d2_new = meanNormalizeVecOfVec(d2);
-  } else if(Normalization == "L2"){
-    // L2 normalize each vector of vector.
-    d1_new = L2NormalizeVecOfVec(d1);
-    d2_new = L2NormalizeVecOfVec(d2);
-  } else {
-    d1_new = d1;
-    d2_new = d2;
-  }
-  std::vector<double> d1_sum = perSampleSumVecOfVec(d1_new);
-  std::vector<double> d2_sum = perSampleSumVecOfVec(d2_new);
-  std::vector<double> d1_squareSum = perSampleSqrSumVecOfVec(d1_new);
-  std::vector<double> d2_squareSum = perSampleSqrSumVecOfVec(d2_new);
-  // Calculate outer dot-product for each fragment-ion and sum element-wise
-  int n_frag = d1.size();
-  for (int fragIon = 0; fragIon < n_frag; fragIon++){
-    ElemWiseSumOuterProd(d1_new[fragIon], d2_new[fragIon], s);
-  }
-  double var1, var2 = 0.0;
-
-  for (int i = 0; i < s.n_row; i++){
-    for(int j = 0; j < s.n_col; j++){
-      var1 = n_frag*d1_squareSum[i]-d1_sum[i]*d1_sum[i];
-      var2 = n_frag*d2_squareSum[j]-d2_sum[j]*d2_sum[j];
-      if(var1 < 0.0 || var2 <= 0.0){
-        // Rcpp::Rcout << "In SumOuterCorr the standard deviation is zero" << std::endl;
-        s.data[i*s.n_col+j] = 0; // TODO: What to output in this case?
-      }
-      else
-        s.data[i*s.n_col+j] = (n_frag*s.data[i*s.n_col+j] - d1_sum[i]*d2_sum[j])/sqrt(var1*var2); // Summing outer product of vectors across fragment-ions.
-    }
-  }
+  sumOuterCorr(fragments(d1), fragments(d2), d1_sum, d2_sum, d1_squareSum, d2_squareSum, s);
 }
 
-void SumOuterEucl(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+void SumOuterEucl(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s){
   DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
   DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
   DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
   DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
   DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
-  std::vector<std::vector<double>> d1_new, d2_new;
-  if(Normalization == "mean"){
-    // Mean normalize each vector of vector.
-    d1_new = meanNormalizeVecOfVec(d1);
-    d2_new = meanNormalizeVecOfVec(d2);
-  } else if(Normalization == "L2"){
-    // L2 normalize each vector of vector.
-    d1_new = L2NormalizeVecOfVec(d1);
-    d2_new = L2NormalizeVecOfVec(d2);
-  } else {
-    d1_new = d1;
-    d2_new = d2;
-  }
-  // Calculate outer-euclidean distance for each sample.
-  int n_frag = d1.size();
-  for (int fragIon = 0; fragIon < n_frag; fragIon++){
-    ElemWiseSumOuterEucl(d1_new[fragIon], d2_new[fragIon], s);
-  }
-  // Take sqrt to get eucledian distance from the sum of squared-differences.
-  // TODO std::ptr_fun<double, double> Why? Effectively calls std::pointer_to_unary_function<Arg,Result>(f)
-  std::transform(s.data.begin(), s.data.end(), s.data.begin(), [](double f){return sqrt(f);});
-  // Convert distance into similarity.
-  distToSim(s, 1.0, 1.0); // distance = Numerator/(offset + similarity)
+  sumOuterEucl(fragments(d1), fragments(d2), s);
 }
 
-void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s){
+  DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
+  // No normalization needed for calculating cosine similarity.
+  SumOuterCosine(d1, d2, perSampleEucLenVecOfVec(d1), perSampleEucLenVecOfVec(d2), s);
+}
+
+void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s){
+  DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
+  DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
+  DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
+  DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
+  sumOuterCosine(fragments(d1), fragments(d2), d1_mag, d2_mag, s);
+}
+
+void SumOuterProdMasked(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s, double cosAngleThresh, double dotProdThresh){
+  DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
+  SumOuterProdMasked(d1, d2, perSampleEucLenVecOfVec(d1), perSampleEucLenVecOfVec(d2), s, cosAngleThresh, dotProdThresh);
+}
+
+void SumOuterProdMasked(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag,
+                        SimMatrix& s, double cosAngleThresh, double dotProdThresh){
   DIALIGN_PRECONDITION(!d1.empty(), "Vector of vectors cannot be empty");
   DIALIGN_PRECONDITION(d1.size() == d2.size(), "Number of fragments needs to be equal");
   DIALIGN_PRECONDITION(s.data.size() == s.n_col * s.n_row , "Similarity matrix length needs to be consistent");
   DIALIGN_PRECONDITION(s.n_row == d1[0].size(), "Data vector size (vector 1) needs to equal matrix dimension (row)");
   DIALIGN_PRECONDITION(s.n_col == d2[0].size(), "Data vector size (vector 2) needs to equal matrix dimension (column)");
+  sumOuterProdMasked(fragments(d1), fragments(d2), d1_mag, d2_mag, s, cosAngleThresh, dotProdThresh);
+}
+
+void SumXcorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s, int kerLen){
   std::vector<std::vector<double>> d1_new, d2_new;
-  if(Normalization == "mean"){
-    // Mean normalize each vector of vector.
-    d1_new = meanNormalizeVecOfVec(d1);
-    d2_new = meanNormalizeVecOfVec(d2);
-  }
-  else if(Normalization == "L2"){
-    // L2 normalize each vector of vector.
-    d1_new = L2NormalizeVecOfVec(d1);
-    d2_new = L2NormalizeVecOfVec(d2);
-  }
-  else {
-    d1_new = d1;
-    d2_new = d2;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumXcorr(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s, kerLen);
+}
+
+void SumOuterProd(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+  std::vector<std::vector<double>> d1_new, d2_new;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumOuterProd(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s);
+}
+
+void SumOuterCov(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+  std::vector<std::vector<double>> d1_new, d2_new;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumOuterCov(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s);
+}
+
+void SumOuterCorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+  std::vector<std::vector<double>> d1_new, d2_new;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumOuterCorr(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s);
+}
+
+void SumOuterEucl(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+  std::vector<std::vector<double>> d1_new, d2_new;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumOuterEucl(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s);
+}
+
+void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s){
+  std::vector<std::vector<double>> d1_new, d2_new;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumOuterCosine(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s);
+}
+
+void SumOuterProdMasked(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization,
+                        SimMatrix& s, double cosAngleThresh, double dotProdThresh){
+  std::vector<std::vector<double>> d1_new, d2_new;
+  NormalizationType norm = getNormalizationType(Normalization);
+  SumOuterProdMasked(normalizeVecOfVec(d1, norm, d1_new), normalizeVecOfVec(d2, norm, d2_new), s, cosAngleThresh, dotProdThresh);
+}
+
+double meanVecOfVec(const ChromatogramView& v){
+  double average = 0.0;
+  for (int k = 0; k < v.nFrag; k++) average += std::accumulate(v.fragment(k), v.fragment(k) + v.len, 0.0)/v.len;
+  return average / v.nFrag;
+}
+
+double eucLenVecOfVec(const ChromatogramView& v){
+  double sos = 0.0; // sum of squares
+  for (int k = 0; k < v.nFrag; k++) sos += std::accumulate(v.fragment(k), v.fragment(k) + v.len, 0.0, square<double>());
+  return std::sqrt(sos);
+}
+
+std::vector<double> perSampleEucLenVecOfVec(const ChromatogramView& v){
+  std::vector<double> mag = perSampleSqrSum(fragments(v), v.len);
+  for (auto& m : mag) m = std::sqrt(m);
+  return mag;
+}
+
+std::vector<double> perSampleSqrSumVecOfVec(const ChromatogramView& v){
+  return perSampleSqrSum(fragments(v), v.len);
+}
+
+std::vector<double> perSampleMeanVecOfVec(const ChromatogramView& v){
+  std::vector<double> mean = perSampleSum(fragments(v), v.len);
+  for (auto& m : mean) m = m/v.nFrag;
+  return mean;
+}
+
+std::vector<double> perSampleSumVecOfVec(const ChromatogramView& v){
+  return perSampleSum(fragments(v), v.len);
+}
+
+void divideVecOfVecInto(const ChromatogramView& v, double num, ChromatogramGroup& out){
+  if(out.nFrag != v.nFrag || out.len != v.len) out = ChromatogramGroup(std::vector<double>(v.len), v.nFrag);
+  std::copy(v.time, v.time + v.len, out.time.begin());
+  for (int k = 0; k < v.nFrag; k++){
+    std::transform(v.fragment(k), v.fragment(k) + v.len, out.fragment(k), std::bind(std::divides<double>(), std::placeholders::_1, num + 1e-08));
   }
-  // No normalization needed for calculating cosine similarity.
-  std::vector<double> d1_mag = perSampleEucLenVecOfVec(d1_new);
-  std::vector<double> d2_mag = perSampleEucLenVecOfVec(d2_new);
-  int n_frag = d1.size();
-  for (int fragIon = 0; fragIon < n_frag; fragIon++){
-    ElemWiseOuterCosine(d1_new[fragIon], d2_new[fragIon], d1_mag, d2_mag, s);
+}
+
+ChromatogramView normalizeVecOfVec(const ChromatogramView& v, NormalizationType Norm, ChromatogramGroup& scratch){
+  if(Norm == NormalizationType::none) return v;
+  double num = (Norm == NormalizationType::mean) ? meanVecOfVec(v) : eucLenVecOfVec(v);
+  divideVecOfVecInto(v, num, scratch);
+  return scratch.view();
+}
+
+void SumXcorr(const ChromatogramView& d1, const ChromatogramView& d2, SimMatrix& s, int kerLen){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  sumXcorr(fragments(d1), fragments(d2), s, kerLen);
+}
+
+void SumOuterProd(const ChromatogramView& d1, const ChromatogramView& d2, SimMatrix& s){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  blockedSumOuterProd(fragments(d1), fragments(d2), s);
+}
+
+void SumOuterCov(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_mean, const std::vector<double>& d2_mean, SimMatrix& s){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  sumOuterCov(fragments(d1), fragments(d2), d1_mean, d2_mean, s);
+}
+
+void SumOuterCorr(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_sum, const std::vector<double>& d2_sum,
+                  const std::vector<double>& d1_squareSum, const std::vector<double>& d2_squareSum, SimMatrix& s){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  sumOuterCorr(fragments(d1), fragments(d2), d1_sum, d2_sum, d1_squareSum, d2_squareSum, s);
+}
+
+void SumOuterEucl(const ChromatogramView& d1, const ChromatogramView& d2, SimMatrix& s){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  sumOuterEucl(fragments(d1), fragments(d2), s);
+}
+
+void SumOuterCosine(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  sumOuterCosine(fragments(d1), fragments(d2), d1_mag, d2_mag, s);
+}
+
+void SumOuterProdMasked(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag,
+                        SimMatrix& s, double cosAngleThresh, double dotProdThresh, bool approxQuantile){
+  DIALIGN_PRECONDITION(d1.nFrag > 0, "Chromatogram group cannot be empty");
+  DIALIGN_PRECONDITION(d1.nFrag == d2.nFrag, "Number of fragments needs to be equal");
+  DIALIGN_PRECONDITION(s.n_row == d1.len && s.n_col == d2.len, "Data vector size needs to equal matrix dimension");
+  sumOuterProdMasked(fragments(d1), fragments(d2), d1_mag, d2_mag, s, cosAngleThresh, dotProdThresh, approxQuantile);
+}
+
+namespace {
+  // Instantiates getSimilarityMatrix() for the normalization chosen at run-time.
+  template<SimilarityType Sim>
+  void dispatchNormalization(NormalizationType Norm, const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2,
+                             SimMatrix& s, NormalizationScratch& scratch, double cosAngleThresh, double dotProdThresh, int kerLen){
+    if(Norm == NormalizationType::mean)
+      getSimilarityMatrix<Sim, NormalizationType::mean>(d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    else if(Norm == NormalizationType::L2)
+      getSimilarityMatrix<Sim, NormalizationType::L2>(d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    else
+      getSimilarityMatrix<Sim, NormalizationType::none>(d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
   }
-  clamp(s.data, -1.0, 1.0); // Clamp the cosine similarity between -1.0 and 1.0
 }
 
 SimMatrix getSimilarityMatrix(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, \
                               const std::string Normalization, const std::string SimType, double cosAngleThresh, \
                               double dotProdThresh, int kerLen){
   SimMatrix s;
-  s.n_row = d1[0].size();
-  s.n_col = d2[0].size();
-  s.data.resize(s.n_row*s.n_col, 0.0);
-  if (SimType == "dotProductMasked"){
-    //Rcpp::Rcout << "dotProductMasked" << std::endl;
-    SumOuterProd(d1, d2, Normalization, s);
-#if 0
-    static SimMatrix s2; // TODO: static matrix is faster here (but prevents multithreading)
-#else
-    SimMatrix s2;
-#endif
-    s2.n_row = s.n_row;
-    s2.n_col = s.n_col;
-    s2.data.resize(s.n_row*s.n_col, 0.0);
-    SumOuterCosine(d1, d2, Normalization, s2);
-#if 1
-    // Optimization: store all values between 0 and 1/2*pi (1.57) in a lookup
-    // table spaced 0.01 instead of re-computing for each value
-    int N = 157;
-    static std::vector<double> lookup_table;
-    static bool filled = false;
-    if (!filled)
-    {
-      lookup_table.resize(N, 0);
-      for (int k = 0; k < N; k++) lookup_table[k] = std::cos(2*std::acos(k/100.0));
-      filled = true;
-    }
-
-    for (auto& i : s2.data)
-    {
-      // i = std::cos(2*std::acos(i));
-      if (std::fabs(i) < N/100.0) i = lookup_table[ std::floor(std::fabs(i)*100) ];
-      else i = -1;
-    }
-#else
-    for(auto& i : s2.data) i = std::cos(2*std::acos(i));
-#endif
-    double Quant = Utils::getQuantile(s.data, dotProdThresh);
-    std::vector<double> MASK;
-    MASK.resize(s.n_row*s.n_col, 0.0);
-    for(int i = 0; i < MASK.size(); i++){
-      MASK[i] = (s.data[i] < Quant) ? 0.0 : 1.0;
-      MASK[i] = (MASK[i]*s2.data[i] + (1.0-MASK[i]) > cosAngleThresh) ? 1.0 : 0.0;
-      s.data[i] = s.data[i] * MASK[i];
-    }
-  }
-  else if (SimType == "dotProduct")
-    SumOuterProd(d1, d2, Normalization, s);
-  else if(SimType == "cosineAngle")
-    SumOuterCosine(d1, d2, Normalization, s);
-  else if(SimType == "cosine2Angle"){
-    SumOuterCosine(d1, d2, Normalization, s);
-    for(auto& i : s.data) i = std::cos(2*std::acos(i));
-    clamp(s.data, -1.0, 1.0); // Clamp the cosine similarity between -1.0 and 1.0
-  }
-  else if(SimType == "euclideanDist")
-    SumOuterEucl(d1, d2, Normalization, s);
-  else if(SimType == "covariance")
-    SumOuterCov(d1, d2, Normalization, s);
-  else if(SimType == "correlation")
-    SumOuterCorr(d1, d2, Normalization, s);
-  else if(SimType == "crossCorrelation")
-    SumXcorr(d1, d2, Normalization, s, kerLen);
-  else{
+  NormalizationScratch scratch;
+  NormalizationType Norm = getNormalizationType(Normalization);
+  switch(getSimilarityType(SimType)){
+  case SimilarityType::dotProductMasked:
+    dispatchNormalization<SimilarityType::dotProductMasked>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::dotProduct:
+    dispatchNormalization<SimilarityType::dotProduct>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::cosineAngle:
+    dispatchNormalization<SimilarityType::cosineAngle>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::cosine2Angle:
+    dispatchNormalization<SimilarityType::cosine2Angle>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::euclideanDist:
+    dispatchNormalization<SimilarityType::euclideanDist>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::covariance:
+    dispatchNormalization<SimilarityType::covariance>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::correlation:
+    dispatchNormalization<SimilarityType::correlation>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  case SimilarityType::crossCorrelation:
+    dispatchNormalization<SimilarityType::crossCorrelation>(Norm, d1, d2, s, scratch, cosAngleThresh, dotProdThresh, kerLen);
+    break;
+  default:
     // Rcpp::Rcout << "getChromSimMat should have value from given choices only!" << std::endl;
+    s.n_row = d1[0].size();
+    s.n_col = d2[0].size();
+    s.data.resize(s.n_row*s.n_col, 0.0);
   }
   return s;
 }
@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <numeric>
+#include <string>
+#include <cmath>
 #include "utils.h"
 #include "similarityMatrix.h"
+#include "chromatogramGroup.h"
 
 /**
  * @namespace DIAlign
@@ -27,6 +30,13 @@ namespace SimilarityMatrix
     }
   };
 
+  /// Returns cos(2*theta) given cosAngle = cos(theta), using the identity cos(2*theta) = 2*cos(theta)^2 - 1.
+  ///
+  /// It is exact up to rounding for cosAngle in [-1, 1], has no lookup table or other shared state, hence, it can be called from concurrent alignments.
+  inline double cos2Angle(double cosAngle){
+    return 2.0*cosAngle*cosAngle - 1.0;
+  }
+
   /// Returns the average value of vector of vectors.
   double meanVecOfVec(const std::vector<std::vector<double>>& vov);
 
@@ -62,6 +72,31 @@ namespace SimilarityMatrix
   /// Returns a vector of vector with values divided by num.
   std::vector<std::vector<double>> divideVecOfVec(const std::vector<std::vector<double>>& vov, double num);
 
+  /// Writes values of vov divided by num into out. Memory of out is reused if it already has the shape of vov.
+  void divideVecOfVecInto(const std::vector<std::vector<double>>& vov, double num, std::vector<std::vector<double>>& out);
+
+  /// Returns vov normalized with Norm.
+  ///
+  /// For NormalizationType::none, vov itself is returned and nothing is copied. Otherwise, normalized values are written into scratch
+  /// and scratch is returned. Values are the same as those of meanNormalizeVecOfVec() and L2NormalizeVecOfVec().
+  template<NormalizationType Norm>
+  inline const std::vector<std::vector<double>>& normalizeVecOfVec(const std::vector<std::vector<double>>& vov, std::vector<std::vector<double>>& scratch){
+    if(Norm == NormalizationType::none) return vov;
+    double num = (Norm == NormalizationType::mean) ? meanVecOfVec(vov) : eucLenVecOfVec(vov);
+    divideVecOfVecInto(vov, num, scratch);
+    return scratch;
+  }
+
+  /// Same as normalizeVecOfVec<Norm>() with Norm selected at run-time.
+  const std::vector<std::vector<double>>& normalizeVecOfVec(const std::vector<std::vector<double>>& vov, NormalizationType Norm,
+                                                            std::vector<std::vector<double>>& scratch);
+
+  /// Returns the SimilarityType named SimType. Names that are not from the choices of getSimilarityMatrix() are SimilarityType::unknown.
+  SimilarityType getSimilarityType(const std::string& SimType);
+
+  /// Returns the NormalizationType named Normalization. Names other than "mean" and "L2" are NormalizationType::none.
+  NormalizationType getNormalizationType(const std::string& Normalization);
+
   /// Adds cross-correlation of a kernel(-+ halfLen) between d1 and d2 in similarity matrix s.
   void ElemWiseSumXcorr(const std::vector<double>& d1, const std::vector<double>& d2, SimMatrix& s, int halfKer);
 
@@ -77,6 +112,48 @@ namespace SimilarityMatrix
   /// Adds outer prodict of cosAng(d1,d2) in similarity matrix s.
   void ElemWiseOuterCosine(const std::vector<double>& d1, const std::vector<double>& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s);
 
+  /// Adds sum of outer products of d1[k] and d2[k] over all fragment-ions k in similarity matrix s, i.e. s += D1' * D2.
+  ///
+  /// Columns of s are processed in blocks so that a block of s and the matching block of every d2 vector stay in L1 cache,
+  /// hence, s is traversed once instead of once per fragment-ion. The inner loop is a contiguous multiply-add that the compiler vectorizes.
+  /// Each cell accumulates fragment-ions in the same order as repeated ElemWiseSumOuterProd(), therefore, results are identical.
+  void BlockedSumOuterProd(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s);
+
+  /// Sums ElemWiseSumXcorr() of already normalized d1 vectors with d2 vectors.
+  void SumXcorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s, int kerLen);
+
+  /// Sums outer products of already normalized d1 vectors with d2 vectors.
+  void SumOuterProd(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s);
+
+  /// Sums ElemWiseSumOuterProdMeanSub() of already normalized d1 vectors with d2 vectors.
+  void SumOuterCov(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s);
+
+  /// Sums correlation coefficient of already normalized d1 vectors with d2 vectors.
+  void SumOuterCorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s);
+
+  /// Sums ElemWiseSumOuterEucl() of already normalized d1 vectors with d2 vectors and converts distance to similarity.
+  void SumOuterEucl(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s);
+
+  /// Sums ElemWiseOuterCosine() of already normalized d1 vectors with d2 vectors.
+  void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s);
+
+  /// Same as SumOuterProdMasked() for already normalized d1 and d2.
+  void SumOuterProdMasked(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s, double cosAngleThresh, double dotProdThresh);
+
+  /// Same as SumOuterCov() for already normalized d1 and d2 with their perSampleMeanVecOfVec().
+  void SumOuterCov(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_mean, const std::vector<double>& d2_mean, SimMatrix& s);
+
+  /// Same as SumOuterCorr() for already normalized d1 and d2 with their perSampleSumVecOfVec() and perSampleSqrSumVecOfVec().
+  void SumOuterCorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_sum, const std::vector<double>& d2_sum,
+                    const std::vector<double>& d1_squareSum, const std::vector<double>& d2_squareSum, SimMatrix& s);
+
+  /// Same as SumOuterCosine() for already normalized d1 and d2 with their perSampleEucLenVecOfVec().
+  void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s);
+
+  /// Same as SumOuterProdMasked() for already normalized d1 and d2 with their perSampleEucLenVecOfVec().
+  void SumOuterProdMasked(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag,
+                          SimMatrix& s, double cosAngleThresh, double dotProdThresh);
+
   /// Given Normalization modifies d1 and d2, and subsequently sums ElemWiseSumXcorr() of d1 vectors with d2 vectors (d1 and d2 must be of same length).
   void SumXcorr(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s, int kerLen);
 
@@ -95,8 +172,70 @@ namespace SimilarityMatrix
   /// Given Normalization modifies d1 and d2, and subsequently sums ElemWiseOuterCosine() of d1 vectors with d2 vectors (d1 and d2 must be of same length).
   void SumOuterCosine(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization, SimMatrix& s);
 
+  /// Given Normalization modifies d1 and d2, sums their outer products and keeps dot-products that are not angularly dissimilar.
+  ///
+  /// Dot-products above the dotProdThresh quantile are forced to zero if cos(2*theta) of d1 and d2 is not higher than cosAngleThresh.
+  /// Normalized vectors are shared by the dot-product and the cosine, and the cosine is calculated only for the cells above the quantile,
+  /// therefore, neither a cosine similarity matrix nor a mask matrix is allocated.
+  void SumOuterProdMasked(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, const std::string Normalization,
+                          SimMatrix& s, double cosAngleThresh, double dotProdThresh);
+
+  /// Scratch memory for normalized chromatograms. Passing the same object to repeated getSimilarityMatrix() calls avoids allocations.
+  struct NormalizationScratch
+  {
+    std::vector<std::vector<double>> d1; ///< Normalized signal A.
+    std::vector<std::vector<double>> d2; ///< Normalized signal B.
+  };
+
+  /// Calculates similarity matrix between d1 and d2 vector of vectors with similarity type and normalization fixed at compile-time.
+  ///
+  /// It gives the same matrix as the string-based getSimilarityMatrix(). Nothing is copied for NormalizationType::none,
+  /// otherwise d1 and d2 are normalized into scratch. s is resized and its memory is reused.
+  /// Sim must not be SimilarityType::unknown.
+  template<SimilarityType Sim, NormalizationType Norm>
+  void getSimilarityMatrix(const std::vector<std::vector<double>>& d1, const std::vector<std::vector<double>>& d2, SimMatrix& s,
+                           NormalizationScratch& scratch, double cosAngleThresh, double dotProdThresh, int kerLen){
+    static_assert(Sim != SimilarityType::unknown, "Similarity type must be known at compile-time");
+    s.n_row = d1[0].size();
+    s.n_col = d2[0].size();
+    s.data.assign(s.n_row*s.n_col, 0.0);
+    const std::vector<std::vector<double>>& d1_new = normalizeVecOfVec<Norm>(d1, scratch.d1);
+    const std::vector<std::vector<double>>& d2_new = normalizeVecOfVec<Norm>(d2, scratch.d2);
+    switch(Sim){
+    case SimilarityType::dotProductMasked:
+      SumOuterProdMasked(d1_new, d2_new, s, cosAngleThresh, dotProdThresh);
+      break;
+    case SimilarityType::dotProduct:
+      SumOuterProd(d1_new, d2_new, s);
+      break;
+    case SimilarityType::cosineAngle:
+      SumOuterCosine(d1_new, d2_new, s);
+      break;
+    case SimilarityType::cosine2Angle:
+      SumOuterCosine(d1_new, d2_new, s);
+      for(auto& i : s.data) i = cos2Angle(i);
+      clamp(s.data, -1.0, 1.0); // Clamp the cosine similarity between -1.0 and 1.0
+      break;
+    case SimilarityType::euclideanDist:
+      SumOuterEucl(d1_new, d2_new, s);
+      break;
+    case SimilarityType::covariance:
+      SumOuterCov(d1_new, d2_new, s);
+      break;
+    case SimilarityType::correlation:
+      SumOuterCorr(d1_new, d2_new, s);
+      break;
+    case SimilarityType::crossCorrelation:
+      SumXcorr(d1_new, d2_new, s, kerLen);
+      break;
+    default:
+      break;
+    }
+  }
+
   /// Returns a similarity matrix between d1 and d2 vector of vectors.
   ///
+  /// Normalization and SimType are converted to NormalizationType and SimilarityType once, and the matching getSimilarityMatrix<Sim, Norm>() is called.
   /// First d1 and d2 are normalized, subsequently, similarity matrix is calculated with appropriate SimType.
   /// For SimType = dotProductMasked, matrix is further modified with cosAngleThresh and dotProdThresh parameters.
   /// For SimType == "cosine2Angle", matrix is constrained between -1.0 and 1.0.
@@ -111,6 +250,69 @@ namespace SimilarityMatrix
                                 const std::string Normalization, const std::string SimType, double cosAngleThresh,
                                 double dotProdThresh, int kerLen);
 
+  /// Same as meanVecOfVec() for the fragment-ions of v.
+  double meanVecOfVec(const ChromatogramView& v);
+
+  /// Same as eucLenVecOfVec() for the fragment-ions of v.
+  double eucLenVecOfVec(const ChromatogramView& v);
+
+  /// Same as perSampleEucLenVecOfVec() for the fragment-ions of v.
+  std::vector<double> perSampleEucLenVecOfVec(const ChromatogramView& v);
+
+  /// Same as perSampleSqrSumVecOfVec() for the fragment-ions of v.
+  std::vector<double> perSampleSqrSumVecOfVec(const ChromatogramView& v);
+
+  /// Same as perSampleMeanVecOfVec() for the fragment-ions of v.
+  std::vector<double> perSampleMeanVecOfVec(const ChromatogramView& v);
+
+  /// Same as perSampleSumVecOfVec() for the fragment-ions of v.
+  std::vector<double> perSampleSumVecOfVec(const ChromatogramView& v);
+
+  /// Writes intensities of v divided by num, and the time axis of v, into out. Memory of out is reused if it already has the shape of v.
+  void divideVecOfVecInto(const ChromatogramView& v, double num, ChromatogramGroup& out);
+
+  /// Returns v normalized with Norm. For NormalizationType::none, v itself is returned, otherwise a view of scratch is returned.
+  ChromatogramView normalizeVecOfVec(const ChromatogramView& v, NormalizationType Norm, ChromatogramGroup& scratch);
+
+  /// Same as SumXcorr() for already normalized chromatogram groups.
+  void SumXcorr(const ChromatogramView& d1, const ChromatogramView& d2, SimMatrix& s, int kerLen);
+
+  /// Same as SumOuterProd() for already normalized chromatogram groups.
+  void SumOuterProd(const ChromatogramView& d1, const ChromatogramView& d2, SimMatrix& s);
+
+  /// Same as SumOuterCov() for already normalized chromatogram groups with their perSampleMeanVecOfVec().
+  void SumOuterCov(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_mean, const std::vector<double>& d2_mean, SimMatrix& s);
+
+  /// Same as SumOuterCorr() for already normalized chromatogram groups with their perSampleSumVecOfVec() and perSampleSqrSumVecOfVec().
+  void SumOuterCorr(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_sum, const std::vector<double>& d2_sum,
+                    const std::vector<double>& d1_squareSum, const std::vector<double>& d2_squareSum, SimMatrix& s);
+
+  /// Same as SumOuterEucl() for already normalized chromatogram groups.
+  void SumOuterEucl(const ChromatogramView& d1, const ChromatogramView& d2, SimMatrix& s);
+
+  /// Same as SumOuterCosine() for already normalized chromatogram groups with their perSampleEucLenVecOfVec().
+  void SumOuterCosine(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag, SimMatrix& s);
+
+  /// Same as SumOuterProdMasked() for already normalized chromatogram groups with their perSampleEucLenVecOfVec().
+  /// If approxQuantile is true, the dotProdThresh quantile is estimated by Utils::getApproxQuantile().
+  void SumOuterProdMasked(const ChromatogramView& d1, const ChromatogramView& d2, const std::vector<double>& d1_mag, const std::vector<double>& d2_mag,
+                          SimMatrix& s, double cosAngleThresh, double dotProdThresh, bool approxQuantile = false);
+
+  /// Returns a similarity matrix between two chromatogram groups.
+  ///
+  /// It is identical to the string-based getSimilarityMatrix() on the intensities of d1 and d2. d1 and d2 are copied into
+  /// PreparedXICGroup objects and the similarity is calculated by getSimilarityMatrix() of PreparedXICGroup, hence, both
+  /// share one dispatch on SimType. It is defined in preparedXICGroup.cpp.
+  /// @param d1 corresponds to signal A.
+  /// @param d2 corresponds to signal B. Must have the same number of fragment-ions as d1.
+  /// @param Norm Normalization applied to d1 and d2.
+  /// @param SimType Similarity type. Must not be SimilarityType::unknown.
+  /// @param cosAngleThresh In simType = dotProductMasked mode, angular similarity should be higher than cosAngleThresh otherwise similarity is forced to zero.
+  /// @param dotProdThresh In simType = dotProductMasked mode, values in similarity matrix higher than dotProdThresh quantile are checked for angular similarity.
+  /// @param kerLen In simType = crossCorrelation, length of the kernel used to sum similarity score. Must be an odd number.
+  SimMatrix getSimilarityMatrix(const ChromatogramView& d1, const ChromatogramView& d2, NormalizationType Norm, SimilarityType SimType,
+                                double cosAngleThresh, double dotProdThresh, int kerLen);
+
 } // namespace SimilarityMatrix
 } // namespace DIAlign
 
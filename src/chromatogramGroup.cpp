@@ -0,0 +1,52 @@
+#include "chromatogramGroup.h"
+#include "miscell.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace DIAlign
+{
+
+ChromatogramGroup::ChromatogramGroup(): nFrag(0), len(0), stride(0){}
+
+ChromatogramGroup::ChromatogramGroup(std::vector<double> time, int nFrag):
+  time(std::move(time)), nFrag(nFrag){
+  if(nFrag < 0){
+    throw std::invalid_argument("Number of fragment-ions must not be negative.");
+  }
+  len = this->time.size();
+  stride = paddedLength(len);
+  intensity.assign(static_cast<std::size_t>(nFrag)*stride, 0.0);
+}
+
+ChromatogramGroup::ChromatogramGroup(std::vector<std::vector<double>> time, std::vector<std::vector<double>> intensity){
+  if(time.empty() || time.size() != intensity.size()){
+    throw std::invalid_argument("Each fragment-ion must have a time and an intensity vector.");
+  }
+  // Make sure that time vector is same for all fragment-ions.
+  xicIntersect(time, intensity);
+  *this = ChromatogramGroup(std::move(time[0]), intensity.size());
+  for(int k = 0; k < nFrag; k++) std::copy(intensity[k].begin(), intensity[k].end(), fragment(k));
+}
+
+ChromatogramView ChromatogramGroup::view() const{
+  ChromatogramView v;
+  v.time = time.data();
+  v.intensity = intensity.data();
+  v.nFrag = nFrag;
+  v.len = len;
+  v.stride = stride;
+  return v;
+}
+
+std::vector<std::vector<double>> ChromatogramGroup::intensityVecOfVec() const{
+  std::vector<std::vector<double>> vov(nFrag);
+  for(int k = 0; k < nFrag; k++) vov[k].assign(fragment(k), fragment(k) + len);
+  return vov;
+}
+
+int ChromatogramGroup::paddedLength(int len){
+  const int perLine = ChromatogramAlignment/sizeof(double);
+  return (len + perLine - 1)/perLine*perLine;
+}
+
+} // namespace DIAlign
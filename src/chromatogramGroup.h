@@ -0,0 +1,129 @@
+#ifndef CHROMATOGRAMGROUP_H
+#define CHROMATOGRAMGROUP_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/// Alignment of intensity buffers in bytes. It is the size of a cache line and of an AVX-512 register.
+const std::size_t ChromatogramAlignment = 64;
+
+/**
+ * @brief Allocator that returns memory aligned at Alignment bytes.
+ *
+ * Memory is taken from operator new with Alignment extra bytes, the address returned by operator new is stored just before
+ * the aligned block so that it can be released. Hence, it does not need aligned_alloc of C++17.
+ */
+template<typename T, std::size_t Alignment = ChromatogramAlignment>
+struct AlignedAllocator
+{
+  typedef T value_type;
+  template<typename U> struct rebind {typedef AlignedAllocator<U, Alignment> other;};
+
+  AlignedAllocator() noexcept {}
+  template<typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+  T* allocate(std::size_t n){
+    void* raw = ::operator new(n*sizeof(T) + Alignment + sizeof(void*));
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+    std::uintptr_t aligned = (start + Alignment - 1) & ~static_cast<std::uintptr_t>(Alignment - 1);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<T*>(aligned);
+  }
+
+  void deallocate(T* p, std::size_t) noexcept {
+    ::operator delete(reinterpret_cast<void**>(p)[-1]);
+  }
+};
+
+template<typename T, typename U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {return true;}
+
+template<typename T, typename U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {return false;}
+
+/**
+ * @brief Non-owning read-only view of a chromatogram group.
+ *
+ * Intensities of fragment-ion k are intensity[k*stride + i] for i in [0, len). All fragment-ions share the time axis.
+ * The view is valid as long as the viewed memory is, it is cheap to copy and can be shared by threads.
+ */
+struct ChromatogramView
+{
+  const double* time; ///< Shared time axis of len samples.
+  const double* intensity; ///< Fragment-major intensities.
+  int nFrag; ///< Number of fragment-ions.
+  int len; ///< Number of samples of each fragment-ion.
+  int stride; ///< Distance between the first samples of consecutive fragment-ions. At least len.
+
+  /// Returns intensities of fragment-ion k.
+  const double* fragment(int k) const {return intensity + static_cast<std::size_t>(k)*stride;}
+
+  /// Returns intensity of fragment-ion k at sample i.
+  double operator()(int k, int i) const {return fragment(k)[i];}
+};
+
+/**
+ * @brief Fragment-ion chromatograms of a peptide in a single contiguous buffer.
+ *
+ * Fragment-ions share one time vector, intensities are stored fragment-major in one buffer aligned at ChromatogramAlignment.
+ * Each fragment-ion is padded with zeros to a multiple of ChromatogramAlignment bytes, hence, every fragment-ion starts at an
+ * aligned address as well. Compared to a vector of vectors, there is a single allocation for all intensities and loops over
+ * samples and fragment-ions walk contiguous memory.
+ */
+struct ChromatogramGroup
+{
+  std::vector<double> time; ///< Shared time axis.
+  std::vector<double, AlignedAllocator<double>> intensity; ///< Fragment-major intensities of nFrag x stride samples.
+  int nFrag; ///< Number of fragment-ions.
+  int len; ///< Number of samples of each fragment-ion.
+  int stride; ///< len padded to a multiple of ChromatogramAlignment bytes.
+
+  /// Constructor for an empty ChromatogramGroup.
+  ChromatogramGroup();
+
+  /**
+   * @brief Constructor for a ChromatogramGroup with zero intensities.
+   *
+   * @param time Shared time axis.
+   * @param nFrag Number of fragment-ions. Must not be negative.
+   */
+  ChromatogramGroup(std::vector<double> time, int nFrag);
+
+  /**
+   * @brief Constructor for a ChromatogramGroup from a vector of vectors.
+   *
+   * Fragment-ions are intersected to a common time range with xicIntersect(), therefore, time vectors may have different ranges.
+   * @param time Time vectors of fragment-ions.
+   * @param intensity Intensity vectors of fragment-ions. Must be of same size as time.
+   */
+  ChromatogramGroup(std::vector<std::vector<double>> time, std::vector<std::vector<double>> intensity);
+
+  /// Returns intensities of fragment-ion k.
+  double* fragment(int k) {return intensity.data() + static_cast<std::size_t>(k)*stride;}
+
+  /// Returns intensities of fragment-ion k.
+  const double* fragment(int k) const {return intensity.data() + static_cast<std::size_t>(k)*stride;}
+
+  /// Returns a read-only view of the group.
+  ChromatogramView view() const;
+
+  /// Returns intensities as a vector of vectors, one per fragment-ion.
+  std::vector<std::vector<double>> intensityVecOfVec() const;
+
+  /// Number of doubles of a fragment-ion with len samples, including padding.
+  static int paddedLength(int len);
+};
+
+} // namespace DIAlign
+
+#endif // CHROMATOGRAMGROUP_H
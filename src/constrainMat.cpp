@@ -1,21 +1,56 @@
 #include "constrainMat.h"
+#include <stdexcept>
 
 namespace DIAlign
 {
 namespace ConstrainMatrix
 {
 
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Columns [lo, hi) of tB that calcNoBeefMask2() leaves unpenalized for a global fit at mapped.
+  // Same test as NoBeefPenalty::mask(). Excluded cells form a prefix on the left and a suffix on the right of mapped.
+  void unpenalizedRange(const std::vector<double>& tB, double mapped, double deltaTime, int noBeef, int& lo, int& hi){
+    auto leftOut = [&](double t){ return t < mapped && round(std::abs((mapped - t)/deltaTime)) > noBeef; };
+    auto rightIn = [&](double t){ return !(t > mapped && round(std::abs((mapped - t)/deltaTime)) > noBeef); };
+    lo = std::partition_point(tB.begin(), tB.end(), leftOut) - tB.begin();
+    hi = std::partition_point(tB.begin() + lo, tB.end(), rightIn) - tB.begin();
+  }
+
+  // unpenalizedRange() of each row of tBp. If tBp is non-decreasing, excluded prefix and included prefix of tB only grow
+  // from one row to the next, hence, all rows are found in a single sweep over tB in O(n_row + n_col).
+  // Otherwise, e.g. with NaN in tBp, each row is found by binary search.
+  void unpenalizedRanges(const std::vector<double>& tB, const std::vector<double>& tBp, double deltaTime, int noBeef,
+                         std::vector<int>& start, std::vector<int>& end){
+    int n_row = tBp.size(), n_col = tB.size();
+    start.resize(n_row);
+    end.resize(n_row);
+    bool sorted = true;
+    for(int i = 0; i < n_row && sorted; i++) sorted = !std::isnan(tBp[i]) && (i == 0 || tBp[i-1] <= tBp[i]);
+    if(!sorted){
+      for(int i = 0; i < n_row; i++) unpenalizedRange(tB, tBp[i], deltaTime, noBeef, start[i], end[i]);
+      return;
+    }
+    int lo = 0, hi = 0;
+    for(int i = 0; i < n_row; i++){
+      double mapped = tBp[i];
+      while(lo < n_col && tB[lo] < mapped && round(std::abs((mapped - tB[lo])/deltaTime)) > noBeef) lo++;
+      hi = std::max(hi, lo);
+      while(hi < n_col && !(tB[hi] > mapped && round(std::abs((mapped - tB[hi])/deltaTime)) > noBeef)) hi++;
+      start[i] = lo;
+      end[i] = hi;
+    }
+  }
+} // namespace
+
 // TODO Use ascii art
 // TODO Make sure A1 < A2, B1 < B2 and B1p < B2p
 // TODO Make sure same deltaTime
 
 void calcNoBeefMask(SimMatrix& MASK, double A1, double A2, double B1, double B2, double B1p, double B2p, int noBeef, bool hardConstrain){
-  // This equation is to from parallel lines: slope = (A2-A1)/(B2-B1) =
-  // (y-A1)/(x- B1). Also, we are considering a very simple linear fit with
-  // slope ~= 1. This will allow a fitting line to cross square only at
-  // adjacent sides. If the slope comes out to be deviating too much from 1,
-  // then this equation will fail and also in that case better to fit
-  // non-linear boundaries for No-Beef region.
+  // Row y of A is mapped to B by linear interpolation between B1p and B2p.
+  // Cells within noBeef columns of the mapped column are not penalized. As
+  // the strip is derived per row, the slope of the fit may be far from one.
   /***
    * mmB1pmmmmmmmB2pmmm
    * A1mmmmmmmmmmmmmmmm
@@ -24,44 +59,10 @@ void calcNoBeefMask(SimMatrix& MASK, double A1, double A2, double B1, double B2,
    * mmmmmmmmmmmmmmmmmm
    * A2mmmmmmmmmmmmmmmm
    */
-  double deltaTime = (A2-A1)/(MASK.n_row-1);
-  int idx = floor((B1p - B1)/deltaTime) + 1; // Index of tB which will correspond to B1p.
-  int leftTri1[2] = {idx-noBeef, 0}; // (X,Y) coordinate of imaginary left triangle.
-  int rightTri1[2] = {idx+noBeef, 0};
-  idx = ceil((B2p - B1)/deltaTime); // Index of tB which will correspond to B2p.
-  int leftTri2[2] = {idx-noBeef, MASK.n_row-1};
-  int rightTri2[2] = {idx+noBeef, MASK.n_row-1}; // Considering our square starts at (0,0)
-  double distFromLeftBndry = 0.0, distFromRightBndry = 0.0;
-  double lessThanLeftTri = 0.0, greaterThanRightTri = 0.0;
-  if(hardConstrain){
+  NoBeefLinePenalty penalty(MASK.n_row, MASK.n_col, A1, A2, B1, B1p, B2p, noBeef, hardConstrain, 1.0);
+  for(int y = 0; y < MASK.n_row; y++){
     for(int x = 0; x < MASK.n_col; x++){
-      for(int y = 0; y < MASK.n_row; y++){
-        lessThanLeftTri = y-leftTri1[1] - (leftTri2[1]-leftTri1[1])*(x-leftTri1[0])/(leftTri2[0]-leftTri1[0]);
-        greaterThanRightTri = y-rightTri1[1] - (rightTri2[1]-rightTri1[1])*(x-rightTri1[0])/(rightTri2[0]-rightTri1[0]);
-        if(lessThanLeftTri<=0 && greaterThanRightTri>=0)
-          MASK.data[y*MASK.n_col + x] = 0.0;
-        else
-          MASK.data[y*MASK.n_col + x] = 1.0;
-      }
-    }
-  }
-  else {
-    for(int x = 0; x < MASK.n_col; x++){
-      for(int y = 0; y < MASK.n_row; y++){
-        // distance of point (X0, Y0) from a line that passes through P1 and P2.
-        // distance(P1, P2, (X0, Y0)) <- -((Y2-Y1)X0 - (X2-X1)Y0 + X2*Y1 -
-        // Y2*X1)/sqrt((Y2-Y1)^2 +(X2-X1)^2)
-        distFromLeftBndry = -((leftTri2[1]-leftTri1[1])*x - (leftTri2[0]-leftTri1[0])*y + leftTri2[0]*leftTri1[1] -
-          leftTri2[1]*leftTri1[0])/sqrt((leftTri2[1]-leftTri1[1])*(leftTri2[1]-leftTri1[1]) + (leftTri2[0]-leftTri1[0])*(leftTri2[0]-leftTri1[0]));
-        distFromRightBndry = -((rightTri2[1]-rightTri1[1])*x - (rightTri2[0]-rightTri1[0])*y + rightTri2[0]*rightTri1[1] -
-          rightTri2[1]*rightTri1[0])/sqrt((rightTri2[1]-rightTri1[1])*(rightTri2[1]-rightTri1[1]) + (rightTri2[0]-rightTri1[0])*(rightTri2[0]-rightTri1[0]));
-        if(distFromLeftBndry<=0 && distFromRightBndry>=0)
-          MASK.data[y*MASK.n_col + x] = 0.0;
-        else if(distFromLeftBndry > 0.0)
-          MASK.data[y*MASK.n_col + x] = distFromLeftBndry;
-        else if(distFromRightBndry < 0.0)
-          MASK.data[y*MASK.n_col + x] = -distFromRightBndry;
-      }
+      MASK.data[y*MASK.n_col + x] = penalty.mask(y, x);
     }
   }
 }
@@ -72,21 +73,179 @@ void constrainSimilarity(SimMatrix& s, const SimMatrix& MASK, double constrainVa
     s.data[i] += constrainVal*MASK.data[i];
 }
 
-void calcNoBeefMask2(SimMatrix& MASK, std::vector<double> tA, std::vector<double> tB,
-                     std::vector<double> tBp, int noBeef, bool hardConstrain){
-  double deltaTime = (tB.back() - tB.front())/(tB.size()-1);
-  double mapped = 0.0;
-  double dist = 0.0;
+void calcNoBeefMask2(SimMatrix& MASK, const std::vector<double>& tA, const std::vector<double>& tB,
+                     const std::vector<double>& tBp, int noBeef, bool hardConstrain){
+  NoBeefPenalty penalty(tB, tBp, noBeef, hardConstrain, 1.0);
   for(int i = 0; i < MASK.n_row; i++){
     for(int j = 0; j < MASK.n_col; j++){
-      dist = std::abs((tBp[i] - tB[j])/deltaTime);
-      if(round(dist) > noBeef){
-        MASK.data[i*MASK.n_col + j] = (hardConstrain) ? 1.0 : (dist-noBeef);
-      } else{
-        MASK.data[i*MASK.n_col + j] = 0.0;
+      MASK.data[i*MASK.n_col + j] = penalty.mask(i, j);
+    }
+  }
+}
+
+void calcNoBeefBand(SimBand& band, const std::vector<double>& tB, const std::vector<double>& tBp, int noBeef){
+  band.n_row = tBp.size();
+  band.n_col = tB.size();
+  band.start.resize(band.n_row);
+  band.end.resize(band.n_row);
+  if(band.n_row == 0 || band.n_col == 0) return;
+  double deltaTime = (tB.back() - tB.front())/(tB.size()-1);
+  unpenalizedRanges(tB, tBp, deltaTime, noBeef, band.start, band.end);
+  for(int i = 0; i < band.n_row; i++){
+    int lo = band.start[i], hi = band.end[i];
+    if(lo >= hi){
+      // Global fit maps outside of the window. Keep the nearest cell.
+      lo = std::min(lo, band.n_col-1);
+      hi = lo + 1;
+    }
+    band.start[i] = lo;
+    band.end[i] = hi;
+  }
+
+  // Make the band a connected staircase.
+  band.start[0] = 0;
+  band.end[band.n_row-1] = band.n_col;
+  for(int i = band.n_row-2; i >= 0; i--) band.start[i] = std::min(band.start[i], band.start[i+1]);
+  for(int i = 1; i < band.n_row; i++){
+    band.end[i] = std::max(band.end[i], band.end[i-1]);
+    band.start[i] = std::min(band.start[i], band.end[i-1]);
+  }
+}
+
+std::vector<std::pair<int, int> > getAnchorChain(const SimMatrix& s, double anchorQuantile, bool approxQuantile){
+  std::vector<std::pair<int, int> > chain;
+  if(s.n_row == 0 || s.n_col == 0) return chain;
+  if(anchorQuantile < 0.0 || anchorQuantile > 1.0){
+    throw std::invalid_argument("anchorQuantile must be between 0 and 1.");
+  }
+  double thresh = approxQuantile ? Utils::getApproxQuantile(s.data, anchorQuantile) : Utils::getQuantile(s.data, anchorQuantile);
+  // Column of the highest score in each row, and row of the highest score in each column. First one wins a tie.
+  std::vector<int> rowBest(s.n_row, 0), colBest(s.n_col, 0);
+  for(int i = 0; i < s.n_row; i++){
+    const double* row = &s.data[i*s.n_col];
+    for(int j = 0; j < s.n_col; j++){
+      if(row[j] > row[rowBest[i]]) rowBest[i] = j;
+      if(row[j] > s.data[colBest[j]*s.n_col + j]) colBest[j] = i;
+    }
+  }
+  std::vector<std::pair<int, int> > cand;
+  std::vector<double> value;
+  for(int i = 0; i < s.n_row; i++){
+    int j = rowBest[i];
+    double v = s.data[i*s.n_col + j];
+    if(colBest[j] == i && v >= thresh && v > 0.0){
+      cand.push_back(std::make_pair(i, j));
+      value.push_back(v);
+    }
+  }
+  if(cand.empty()) return chain;
+
+  // Candidates have distinct rows and are sorted by row. Heaviest chain with increasing columns.
+  int n = cand.size();
+  std::vector<double> best(value);
+  std::vector<int> prev(n, -1);
+  int last = 0;
+  for(int k = 0; k < n; k++){
+    for(int m = 0; m < k; m++){
+      if(cand[m].second < cand[k].second && best[m] + value[k] > best[k]){
+        best[k] = best[m] + value[k];
+        prev[k] = m;
       }
     }
+    if(best[k] > best[last]) last = k;
+  }
+  for(int k = last; k >= 0; k = prev[k]) chain.push_back(cand[k]);
+  std::reverse(chain.begin(), chain.end());
+  return chain;
+}
+
+void calcAnchorBand(SimBand& band, const std::vector<std::pair<int, int> >& anchors, int n_row, int n_col){
+  band.n_row = n_row;
+  band.n_col = n_col;
+  band.start.assign(n_row, n_col);
+  band.end.assign(n_row, 0);
+  if(n_row == 0 || n_col == 0) return;
+  // Points of the chain in matrix M. Anchor (i, j) of s is cell (i+1, j+1) of M.
+  std::vector<std::pair<int, int> > points;
+  points.push_back(std::make_pair(0, 0));
+  for(const auto& a : anchors) points.push_back(std::make_pair(a.first + 1, a.second + 1));
+  points.push_back(std::make_pair(n_row, n_col));
+  for(std::size_t k = 1; k < points.size(); k++){
+    int r0 = points[k-1].first, c0 = points[k-1].second;
+    int r1 = points[k].first, c1 = points[k].second;
+    // Columns c0..c1 of M are columns c0-1..c1-1 of s. Row 0 of M is not in s.
+    for(int r = std::max(r0, 1); r <= r1; r++){
+      band.start[r-1] = std::min(band.start[r-1], std::max(c0 - 1, 0));
+      band.end[r-1] = std::max(band.end[r-1], c1);
+    }
+  }
+}
+
+NoBeefPenalty::NoBeefPenalty(const std::vector<double>& tB, const std::vector<double>& tBp, int noBeef, bool hardConstrain, double constrainVal):
+  tB(tB), tBp(tBp), noBeef(noBeef), hardConstrain(hardConstrain), constrainVal(constrainVal){
+  deltaTime = (tB.back() - tB.front())/(tB.size()-1);
+  unpenalizedRanges(tB, tBp, deltaTime, noBeef, bandStart, bandEnd);
+}
+
+void NoBeefPenalty::constrainRow(int i, double* row, int jStart, int jEnd) const{
+  // MASK is zero in [bandStart[i], bandEnd[i]), adding zero does not change the score.
+  int lo = std::min(std::max(bandStart[i], jStart), jEnd);
+  int hi = std::min(std::max(bandEnd[i], lo), jEnd);
+  if(hardConstrain){
+    for(int j = jStart; j < lo; j++) row[j-jStart] += constrainVal;
+    for(int j = hi; j < jEnd; j++) row[j-jStart] += constrainVal;
+    return;
+  }
+  // Outside of the unpenalized columns round(dist) > noBeef, hence, MASK is dist-noBeef.
+  for(int j = jStart; j < lo; j++)
+    row[j-jStart] += constrainVal*(std::abs((tBp[i] - tB[j])/deltaTime) - noBeef);
+  for(int j = hi; j < jEnd; j++)
+    row[j-jStart] += constrainVal*(std::abs((tBp[i] - tB[j])/deltaTime) - noBeef);
+}
+
+NoBeefLinePenalty::NoBeefLinePenalty(int n_row, int n_col, double A1, double A2, double B1, double B1p, double B2p, int noBeef,
+                                     bool hardConstrain, double constrainVal):
+  n_row(n_row), n_col(n_col), noBeef(noBeef), hardConstrain(hardConstrain), constrainVal(constrainVal){
+  double deltaTime = (A2-A1)/(n_row-1);
+  startIdx = floor((B1p - B1)/deltaTime) + 1; // Index of tB which will correspond to B1p.
+  endIdx = ceil((B2p - B1)/deltaTime); // Index of tB which will correspond to B2p.
+  // Boundaries are parallel to the fit, their distance from a cell is the column offset times the cosine of the fit angle.
+  double slope = (n_row > 1) ? static_cast<double>(endIdx - startIdx)/(n_row-1) : 0.0;
+  distScale = 1.0/sqrt(1.0 + slope*slope);
+
+  // Row i is unpenalized in the columns within noBeef of mappedColumn(i), for any slope of the fit.
+  bandStart.resize(n_row);
+  bandEnd.resize(n_row);
+  for(int i = 0; i < n_row; i++){
+    double mapped = mappedColumn(i);
+    double lo = std::min(std::max(std::ceil(mapped - noBeef), 0.0), static_cast<double>(n_col));
+    double hi = std::min(std::max(std::floor(mapped + noBeef) + 1.0, lo), static_cast<double>(n_col));
+    bandStart[i] = lo;
+    bandEnd[i] = hi;
+  }
+}
+
+double NoBeefLinePenalty::mask(int y, int x) const{
+  if(x >= bandStart[y] && x < bandEnd[y]) return 0.0;
+  if(hardConstrain) return 1.0;
+  // Distance of the cell from the nearer boundary of the strip.
+  return (std::abs(x - mappedColumn(y)) - noBeef)*distScale;
+}
+
+void NoBeefLinePenalty::constrainRow(int i, double* row, int jStart, int jEnd) const{
+  // MASK is zero in [bandStart[i], bandEnd[i]). As in NoBeefPenalty, only the cells outside of it are penalized.
+  int lo = std::min(std::max(bandStart[i], jStart), jEnd);
+  int hi = std::min(std::max(bandEnd[i], lo), jEnd);
+  if(hardConstrain){
+    for(int j = jStart; j < lo; j++) row[j-jStart] += constrainVal;
+    for(int j = hi; j < jEnd; j++) row[j-jStart] += constrainVal;
+    return;
   }
+  double mapped = mappedColumn(i);
+  for(int j = jStart; j < lo; j++)
+    row[j-jStart] += constrainVal*((std::abs(j - mapped) - noBeef)*distScale);
+  for(int j = hi; j < jEnd; j++)
+    row[j-jStart] += constrainVal*((std::abs(j - mapped) - noBeef)*distScale);
 }
 
 } // namespace ConstrainMatrix
@@ -2,6 +2,7 @@
 #define CONSTRAINMAT_H
 
 #include <vector>
+#include <utility>
 #include <cmath>
 #include "utils.h"
 #include "similarityMatrix.h"
@@ -52,8 +53,147 @@ void calcNoBeefMask(SimMatrix& MASK, double A1, double A2, double B1, double B2,
  */
 void constrainSimilarity(SimMatrix& s, const SimMatrix& MASK, double constrainVal);
 
-void calcNoBeefMask2(SimMatrix& MASK, std::vector<double> tA, std::vector<double> tB,
-                     std::vector<double> tBp, int noBeef, bool hardConstrain);
+void calcNoBeefMask2(SimMatrix& MASK, const std::vector<double>& tA, const std::vector<double>& tB,
+                     const std::vector<double>& tBp, int noBeef, bool hardConstrain);
+
+/**
+ * @brief Calculates the band of cells that are within noBeef samples from the global fit.
+ *
+ * For row i, the band has all columns j that calcNoBeefMask2() would leave unpenalized, i.e. round(|tBp[i] - tB[j]|/deltaTime) <= noBeef.
+ * Each row is located with binary search, hence, the cost is O(n_row * log(n_col)) instead of O(n_row * n_col).
+ * Afterwards, the band is made a connected staircase so that every cell in it can be reached from the top-left corner:
+ * empty rows get one cell, start and end are made non-decreasing, a row never starts after the previous row ends,
+ * and the first and the last row are extended to the first and the last column, respectively.
+ * @param band Output band with n_row = tBp.size() and n_col = tB.size().
+ * @param tB equally spaced timepoints of signal B.
+ * @param tBp mapping of signal A timepoints to signal B through a global fit.
+ * @param noBeef half-width of the band in number of samples.
+ */
+void calcNoBeefBand(SimBand& band, const std::vector<double>& tB, const std::vector<double>& tBp, int noBeef);
+
+/**
+ * @brief Selects anchor cells of the similarity matrix and chains them monotonically.
+ *
+ * A cell is an anchor candidate if it has the highest score of its row and of its column, i.e. the apices of both signals
+ * co-elute there, and its score is above the anchorQuantile quantile of s. Out of the candidates, the chain with strictly
+ * increasing rows and columns that has the highest sum of scores is kept.
+ * @param s similarity score matrix.
+ * @param anchorQuantile Must be between 0 and 1.
+ * @param approxQuantile If true, the anchorQuantile quantile of s is estimated with Utils::getApproxQuantile().
+ * @return Chained anchors as (row, column) of s, sorted by row.
+ */
+std::vector<std::pair<int, int> > getAnchorChain(const SimMatrix& s, double anchorQuantile, bool approxQuantile = false);
+
+/**
+ * @brief Calculates the band of the rectangles between consecutive anchors.
+ *
+ * The top-left corner, the anchors and the bottom-right corner of matrix M are chained. Consecutive points of the chain span
+ * a rectangle of M, and each row of the band covers the columns of all rectangles that have that row. Therefore, an alignment
+ * path through the anchors fits in the band, and the number of cells is the total area of the rectangles.
+ * The band is a connected staircase as in calcNoBeefBand().
+ * @param band Output band with n_row rows and n_col columns.
+ * @param anchors Output of getAnchorChain() for a similarity matrix of n_row rows and n_col columns.
+ * @param n_row Number of rows of the similarity matrix.
+ * @param n_col Number of columns of the similarity matrix.
+ */
+void calcAnchorBand(SimBand& band, const std::vector<std::pair<int, int> >& anchors, int n_row, int n_col);
+
+/**
+ * @brief Row-wise form of calcNoBeefMask2() followed by constrainSimilarity().
+ *
+ * Penalizes the similarity scores of one row at a time, therefore, the MASK matrix is never built.
+ * The unpenalized columns of each row are found once, and only the cells outside of them are penalized. For a non-decreasing
+ * tBp, i.e. any monotone global fit, all rows are found in one sweep over tB in O(n_row + n_col), otherwise by binary search.
+ * Penalized scores are identical to those from calcNoBeefMask2() and constrainSimilarity() with the same parameters.
+ */
+struct NoBeefPenalty
+{
+  std::vector<double> tB; ///< equally spaced timepoints of signal B.
+  std::vector<double> tBp; ///< mapping of signal A timepoints to signal B through a global fit.
+  double deltaTime; ///< Sampling time of signal B.
+  int noBeef; ///< Distance from the global fit, in number of samples, upto which no penalization is performed.
+  bool hardConstrain; ///< If false, cells farther than noBeef are penalized by their distance from the global fit.
+  double constrainVal; ///< Penalizing factor for the mask.
+  std::vector<int> bandStart; ///< First unpenalized column of each row.
+  std::vector<int> bandEnd; ///< One past the last unpenalized column of each row. Equal to bandStart if the row has none.
+
+  /**
+   * @brief Constructor for NoBeefPenalty.
+   * @param tB equally spaced timepoints of signal B.
+   * @param tBp mapping of signal A timepoints to signal B through a global fit.
+   * @param noBeef half-width of the unpenalized window in number of samples.
+   * @param hardConstrain if false; indices farther from noBeef distance are filled with distance from linear fit line.
+   * @param constrainVal penalizing factor for the mask, as in constrainSimilarity().
+   */
+  NoBeefPenalty(const std::vector<double>& tB, const std::vector<double>& tBp, int noBeef, bool hardConstrain, double constrainVal);
+
+  /// Value of the MASK from calcNoBeefMask2() at (i, j).
+  double mask(int i, int j) const {
+    double dist = std::abs((tBp[i] - tB[j])/deltaTime);
+    if(round(dist) > noBeef){
+      return (hardConstrain) ? 1.0 : (dist-noBeef);
+    }
+    return 0.0;
+  }
+
+  /// Adds constrainVal*MASK of row i, columns [jStart, jEnd), to the jEnd-jStart scores pointed by row.
+  void constrainRow(int i, double* row, int jStart, int jEnd) const;
+
+  /// Adds constrainVal*MASK to the tB.size() scores of row i.
+  void constrainRow(int i, double* row) const {constrainRow(i, row, 0, tB.size());}
+};
+
+/**
+ * @brief Row-wise form of calcNoBeefMask() followed by constrainSimilarity().
+ *
+ * The no-beef strip is bounded by two lines parallel to the global fit, which maps row 0 to column startIdx and the last row
+ * to column endIdx of signal B. Rows between are mapped by linear interpolation, hence, the slope of the fit can be any value.
+ * Unpenalized columns of each row are derived once from the mapped column, and mask() is evaluated only outside of them.
+ * Penalized scores are identical to those from calcNoBeefMask() and constrainSimilarity() with the same parameters.
+ */
+struct NoBeefLinePenalty
+{
+  int n_row; ///< Number of rows of the similarity matrix.
+  int n_col; ///< Number of columns of the similarity matrix.
+  int startIdx; ///< Column of signal B that corresponds to B1p.
+  int endIdx; ///< Column of signal B that corresponds to B2p.
+  int noBeef; ///< Half-width of the unpenalized strip in number of samples.
+  double distScale; ///< Distance from a boundary per column of offset from it.
+  bool hardConstrain; ///< If false, cells outside of the strip are penalized by their distance from the boundary.
+  double constrainVal; ///< Penalizing factor for the mask.
+  std::vector<int> bandStart; ///< First unpenalized column of each row.
+  std::vector<int> bandEnd; ///< One past the last unpenalized column of each row. Equal to bandStart if the row has none.
+
+  /**
+   * @brief Constructor for NoBeefLinePenalty.
+   * @param n_row Number of rows of the similarity matrix.
+   * @param n_col Number of columns of the similarity matrix.
+   * @param A1 First timepoint of signal A.
+   * @param A2 Last timepoint of signal A.
+   * @param B1 First timepoint of signal B.
+   * @param B1p Mapping of A1 to signal B through a global fit.
+   * @param B2p Mapping of A2 to signal B through a global fit.
+   * @param noBeef half-width of the unpenalized strip in number of samples.
+   * @param hardConstrain if false; indices farther from noBeef distance are filled with distance from linear fit line.
+   * @param constrainVal penalizing factor for the mask, as in constrainSimilarity().
+   */
+  NoBeefLinePenalty(int n_row, int n_col, double A1, double A2, double B1, double B1p, double B2p, int noBeef,
+                    bool hardConstrain, double constrainVal);
+
+  /// Fractional column of signal B that row i is mapped to.
+  double mappedColumn(int i) const {
+    return (n_row > 1) ? startIdx + static_cast<double>(endIdx - startIdx)*i/(n_row-1) : startIdx;
+  }
+
+  /// Value of the MASK from calcNoBeefMask() at (i, j).
+  double mask(int i, int j) const;
+
+  /// Adds constrainVal*MASK of row i, columns [jStart, jEnd), to the jEnd-jStart scores pointed by row.
+  void constrainRow(int i, double* row, int jStart, int jEnd) const;
+
+  /// Adds constrainVal*MASK to the n_col scores of row i.
+  void constrainRow(int i, double* row) const {constrainRow(i, row, 0, n_col);}
+};
 } // namespace ConstrainMatrix
 } // namespace DIAlign
 
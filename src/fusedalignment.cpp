@@ -0,0 +1,217 @@
+#include "fusedalignment.h"
+#include "affineengine.h"
+#include <exception>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DIALIGN_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace {
+#ifdef DIALIGN_AVX2_KERNEL
+  // Fills M, A and their Traceback for columns 1 to 4*floor(n/4) of a row, four columns at a time. These depend only on the
+  // previous row, whereas B depends on the left cell and is left to the caller. Each lane repeats the comparisons of
+  // fillAffineCell() with blends, so scores, ties and the zero default of incomparable cells are bit-identical.
+  // Returns the first column that is not filled.
+  __attribute__((target("avx2")))
+  int fillDiagonalAndTopAVX2(int n, const double* sRow, const double* prevM, const double* prevA, const double* prevB,
+                             double go, double ge, double* curM, double* curA,
+                             DIAlign::Traceback::TracebackType* tbM, DIAlign::Traceback::TracebackType* tbA){
+    using namespace DIAlign::Traceback;
+    const __m256d goV = _mm256_set1_pd(go), geV = _mm256_set1_pd(ge), zero = _mm256_setzero_pd();
+    int code[4];
+    int j = 1;
+    for(; j+3 <= n; j += 4){
+      __m256d sij = _mm256_loadu_pd(&sRow[j-1]);
+      __m256d Diago = _mm256_add_pd(_mm256_loadu_pd(&prevM[j-1]), sij);
+      __m256d InsertInA = _mm256_add_pd(_mm256_loadu_pd(&prevA[j-1]), sij);
+      __m256d InsertInB = _mm256_add_pd(_mm256_loadu_pd(&prevB[j-1]), sij);
+      __m256d isDA = _mm256_and_pd(_mm256_cmp_pd(InsertInA, Diago, _CMP_GE_OQ), _mm256_cmp_pd(InsertInA, InsertInB, _CMP_GE_OQ));
+      __m256d isDB = _mm256_and_pd(_mm256_cmp_pd(InsertInB, Diago, _CMP_GE_OQ), _mm256_cmp_pd(InsertInB, InsertInA, _CMP_GE_OQ));
+      __m256d isDM = _mm256_and_pd(_mm256_cmp_pd(Diago, InsertInA, _CMP_GE_OQ), _mm256_cmp_pd(Diago, InsertInB, _CMP_GE_OQ));
+
+      __m256d AfromM = _mm256_sub_pd(_mm256_loadu_pd(&prevM[j]), goV);
+      __m256d AfromA = _mm256_sub_pd(_mm256_loadu_pd(&prevA[j]), geV);
+      __m256d AfromB = _mm256_sub_pd(_mm256_loadu_pd(&prevB[j]), goV);
+      __m256d isTA = _mm256_and_pd(_mm256_cmp_pd(AfromA, AfromM, _CMP_GE_OQ), _mm256_cmp_pd(AfromA, AfromB, _CMP_GE_OQ));
+      __m256d isTB = _mm256_and_pd(_mm256_cmp_pd(AfromB, AfromM, _CMP_GE_OQ), _mm256_cmp_pd(AfromB, AfromA, _CMP_GE_OQ));
+      __m256d isTM = _mm256_and_pd(_mm256_cmp_pd(AfromM, AfromA, _CMP_GE_OQ), _mm256_cmp_pd(AfromM, AfromB, _CMP_GE_OQ));
+
+      // Later blends override earlier ones, the same order as the if-statements of fillAffineCell().
+      _mm256_storeu_pd(&curM[j], _mm256_blendv_pd(_mm256_blendv_pd(_mm256_blendv_pd(zero, InsertInA, isDA), InsertInB, isDB), Diago, isDM));
+      _mm256_storeu_pd(&curA[j], _mm256_blendv_pd(_mm256_blendv_pd(_mm256_blendv_pd(zero, AfromA, isTA), AfromB, isTB), AfromM, isTM));
+      __m256d codeM = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_blendv_pd(zero, _mm256_set1_pd(DA), isDA), _mm256_set1_pd(DB), isDB),
+                                       _mm256_set1_pd(DM), isDM);
+      __m256d codeA = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_blendv_pd(zero, _mm256_set1_pd(TA), isTA), _mm256_set1_pd(TB), isTB),
+                                       _mm256_set1_pd(TM), isTM);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(code), _mm256_cvtpd_epi32(codeM));
+      for(int k = 0; k < 4; k++) tbM[j+k] = static_cast<TracebackType>(code[k]);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(code), _mm256_cvtpd_epi32(codeA));
+      for(int k = 0; k < 4; k++) tbA[j+k] = static_cast<TracebackType>(code[k]);
+    }
+    return j;
+  }
+#endif
+}
+
+namespace DIAlign
+{
+
+using namespace Traceback;
+
+FusedAffineAlignObj::FusedAffineAlignObj(int ROW_SIZE, int COL_SIZE){
+  packedTraceback.assign((std::size_t)ROW_SIZE*COL_SIZE, 0);
+  lastColM.assign(ROW_SIZE, 0.0);
+  lastColA.assign(ROW_SIZE, 0.0);
+  lastColB.assign(ROW_SIZE, 0.0);
+  lastRowM.assign(COL_SIZE, 0.0);
+  lastRowA.assign(COL_SIZE, 0.0);
+  lastRowB.assign(COL_SIZE, 0.0);
+  signalA_len = ROW_SIZE-1;
+  signalB_len = COL_SIZE-1;
+  GapOpen = 0.0;
+  GapExten = 0.0;
+  FreeEndGaps = true;
+  nGaps = 0;
+}
+
+double FusedAffineAlignObj::getBoundaryScore(tbJump MatName, int i, int j) const{
+  double Inf = std::numeric_limits<double>::infinity();
+  if(MatName == Traceback::M) return (i == 0 && j == 0) ? 0.0 : -Inf;
+  if(MatName == Traceback::A && j == 0 && i > 0) return FreeEndGaps ? 0.0 : -(i-1)*GapExten - GapOpen;
+  if(MatName == Traceback::B && i == 0 && j > 0) return FreeEndGaps ? 0.0 : -(j-1)*GapExten - GapOpen;
+  return -Inf;
+}
+
+namespace AffineAlignment
+{
+
+void fillAffineRow(const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty, int i, double go, double ge,
+                   const double* prevM, const double* prevA, const double* prevB, double* curM, double* curA, double* curB,
+                   TracebackType* tbM, TracebackType* tbA, TracebackType* tbB, std::vector<double>& sRow){
+  std::copy(s.data.begin() + (std::size_t)(i-1)*s.n_col, s.data.begin() + (std::size_t)i*s.n_col, sRow.begin());
+  if(penalty) penalty->constrainRow(i-1, &sRow[0]);
+  int j = 1;
+#ifdef DIALIGN_AVX2_KERNEL
+  if(hasSIMDKernel()){
+    j = fillDiagonalAndTopAVX2(s.n_col, &sRow[0], prevM, prevA, prevB, go, ge, curM, curA, tbM, tbA);
+    // B of the vectorized columns, with the comparisons of fillAffineCell().
+    for(int k = 1; k < j; k++){
+      double BfromM = curM[k-1] - go, BfromA = curA[k-1] - go, BfromB = curB[k-1] - ge;
+      curB[k] = 0.0;
+      tbB[k] = SS;
+      if(BfromA >= BfromM && BfromA >= BfromB){tbB[k] = LA; curB[k] = BfromA;}
+      if(BfromB >= BfromM && BfromB >= BfromA){tbB[k] = LB; curB[k] = BfromB;}
+      if(BfromM >= BfromA && BfromM >= BfromB){tbB[k] = LM; curB[k] = BfromM;}
+    }
+  }
+#endif
+  double leftM = curM[j-1], leftA = curA[j-1], leftB = curB[j-1];
+  for(; j <= s.n_col; j++){
+    // Cells not reached by any comparison keep the default zero, same as a cleared AffineAlignObj.
+    double cellM = 0.0, cellA = 0.0, cellB = 0.0;
+    tbM[j] = tbA[j] = tbB[j] = SS;
+    fillAffineCell(sRow[j-1], prevM[j-1], prevA[j-1], prevB[j-1], prevM[j], prevA[j], prevB[j],
+                   leftM, leftA, leftB, go, ge, cellM, cellA, cellB, tbM[j], tbA[j], tbB[j]);
+    curM[j] = leftM = cellM;
+    curA[j] = leftA = cellA;
+    curB[j] = leftB = cellB;
+  }
+}
+
+// It fills the Traceback row-by-row. Each row of s is constrained just before it is used.
+void doFusedAffineAlignment(FusedAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty,
+                            double go, double ge, bool OverlapAlignment){
+  validateAffineAlignment("FusedAffineAlignObj", obj.signalA_len, obj.signalB_len, s, penalty, go, ge);
+  obj.FreeEndGaps = OverlapAlignment;
+  obj.GapOpen = go;
+  obj.GapExten = ge;
+  int ROW_SIZE = obj.signalA_len + 1;
+  int COL_SIZE = obj.signalB_len + 1;
+  PackedTraceback* tb = &obj.packedTraceback[0];
+
+  // Traceback of the first row and column is the same as in doAffineAlignment().
+  tb[0] = packTraceback(SS, SS, SS);
+  for(int i = 1; i < ROW_SIZE; i++) tb[(std::size_t)i*COL_SIZE] = packTraceback(SS, (i == 1) ? TM : TA, SS);
+  for(int j = 1; j < COL_SIZE; j++) tb[j] = packTraceback(SS, SS, (j == 1) ? LM : LB);
+
+  // Row 0 of M, A and B.
+  std::vector<double> prevM(COL_SIZE), prevA(COL_SIZE), prevB(COL_SIZE);
+  std::vector<double> curM(COL_SIZE), curA(COL_SIZE), curB(COL_SIZE);
+  for(int j = 0; j < COL_SIZE; j++){
+    prevM[j] = obj.getBoundaryScore(Traceback::M, 0, j);
+    prevA[j] = obj.getBoundaryScore(Traceback::A, 0, j);
+    prevB[j] = obj.getBoundaryScore(Traceback::B, 0, j);
+  }
+  obj.lastColM[0] = prevM[COL_SIZE-1];
+  obj.lastColA[0] = prevA[COL_SIZE-1];
+  obj.lastColB[0] = prevB[COL_SIZE-1];
+
+  std::vector<double> sRow(s.n_col);
+  std::vector<TracebackType> tbM(COL_SIZE), tbA(COL_SIZE), tbB(COL_SIZE); // Traceback of a row before it is packed.
+  for(int i = 1; i < ROW_SIZE; i++){
+    curM[0] = obj.getBoundaryScore(Traceback::M, i, 0);
+    curA[0] = obj.getBoundaryScore(Traceback::A, i, 0);
+    curB[0] = obj.getBoundaryScore(Traceback::B, i, 0);
+    fillAffineRow(s, penalty, i, go, ge, &prevM[0], &prevA[0], &prevB[0], &curM[0], &curA[0], &curB[0],
+                  &tbM[0], &tbA[0], &tbB[0], sRow);
+    PackedTraceback* tbRow = tb + (std::size_t)i*COL_SIZE;
+    for(int j = 1; j < COL_SIZE; j++) tbRow[j] = packTraceback(tbM[j], tbA[j], tbB[j]);
+    obj.lastColM[i] = curM[COL_SIZE-1];
+    obj.lastColA[i] = curA[COL_SIZE-1];
+    obj.lastColB[i] = curB[COL_SIZE-1];
+    prevM.swap(curM);
+    prevA.swap(curA);
+    prevB.swap(curB);
+  }
+  obj.lastRowM = prevM;
+  obj.lastRowA = prevA;
+  obj.lastRowB = prevB;
+}
+
+void getFusedAffineAlignedIndices(FusedAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty){
+  // Start-cell is searched in the last row and column, which are kept.
+  auto getScore = [&](tbJump MatName, int i, int j){
+    if(j == obj.signalB_len){
+      if(MatName == Traceback::M) return obj.lastColM[i];
+      if(MatName == Traceback::A) return obj.lastColA[i];
+      return obj.lastColB[i];
+    }
+    if(MatName == Traceback::M) return obj.lastRowM[j];
+    if(MatName == Traceback::A) return obj.lastRowA[j];
+    return obj.lastRowB[j];
+  };
+  auto getTraceback = [&](tbJump MatName, int i, int j){ return obj.getTraceback(MatName, i, j); };
+  // Replay the recurrence from the end of the path. Each step repeats the addition done in fillAffineCell(), hence, values are exact.
+  traceAffinePath(obj, getScore, getTraceback, [&](const std::vector<PathCell>& path, std::vector<double>& pathScore){
+    std::size_t L = path.size() - 1;
+    const PathCell& last = path[L];
+    pathScore[L] = (last.i == 0 || last.j == 0) ? obj.getBoundaryScore(last.MatName, last.i, last.j) : 0.0;
+    for(std::size_t k = L; k-- > 0;){
+      const PathCell& c = path[k];
+      if(c.i == 0 || c.j == 0){
+        pathScore[k] = obj.getBoundaryScore(c.MatName, c.i, c.j);
+        continue;
+      }
+      TracebackType tb = obj.getTraceback(c.MatName, c.i, c.j);
+      switch(tb){
+      case DM: case DA: case DB:
+        {
+        double sij = s.data[(std::size_t)(c.i-1)*s.n_col + c.j-1];
+        if(penalty) penalty->constrainRow(c.i-1, &sij, c.j-1, c.j);
+        pathScore[k] = pathScore[k+1] + sij;
+        break;}
+      case TA: case LB:
+        pathScore[k] = pathScore[k+1] - obj.GapExten;
+        break;
+      default:
+        pathScore[k] = pathScore[k+1] - obj.GapOpen;
+        break;
+      }
+    }
+  });
+}
+
+} // namespace AffineAlignment
+} // namespace DIAlign
@@ -0,0 +1,109 @@
+#ifndef FUSEDALIGNMENT_H
+#define FUSEDALIGNMENT_H
+
+#include <vector>
+#include <limits>
+#include "affinealignobj.h"
+#include "affinealignment.h"
+#include "constrainMat.h"
+#include "similarityMatrix.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/**
+ * @brief An affine alignment object that keeps only the Traceback and the last row and column of M, A and B.
+ *
+ * Cumulative-score matrices are filled row-by-row with two rolling rows, hence, memory for M, A and B is O(COL_SIZE) instead of ROW_SIZE * COL_SIZE.
+ * The last row and the last column are kept for selecting the start-cell of the traceback.
+ * Traceback of M, A and B is packed in one byte per cell, same as in AffineAlignObj.
+ */
+struct FusedAffineAlignObj
+{
+  std::vector<Traceback::PackedTraceback> packedTraceback; ///< Traceback of M, A and B packed in one byte per cell. Use getTraceback().
+  std::vector<double> lastColM; ///< Last column of matrix M.
+  std::vector<double> lastColA; ///< Last column of matrix A.
+  std::vector<double> lastColB; ///< Last column of matrix B.
+  std::vector<double> lastRowM; ///< Last row of matrix M.
+  std::vector<double> lastRowA; ///< Last row of matrix A.
+  std::vector<double> lastRowB; ///< Last row of matrix B.
+  int signalA_len; ///< Number of data-points in signal A.
+  int signalB_len; ///< Number of data-points in signal B.
+  double GapOpen; ///< Penalty for Gap opening. For n consecutive gaps: Penalty = GapOpen + (n-1)*GapExten.
+  double GapExten; ///< Penalty for Gap extension. For n consecutive gaps: Penalty = GapOpen + (n-1)*GapExten.
+  bool FreeEndGaps; ///< True for Overlap alignment.
+  std::vector<int> indexA_aligned; ///< Aligned signalA indices after affine alignment.
+  std::vector<int> indexB_aligned; ///< Aligned signalB indices after affine alignment.
+  std::vector<double> score;  ///< Cumulative score along the aligned path.
+  int nGaps; ///< Total number of gaps in the alignment path.
+
+  /**
+   * @brief Constructor for FusedAffineAlignObj.
+   *
+   * Allocates Traceback and the last row and column of M, A and B.
+   * @param ROW_SIZE Number of rows in matrix M.
+   * @param COL_SIZE Number of columns in matrix M.
+   */
+  FusedAffineAlignObj(int ROW_SIZE, int COL_SIZE);
+
+  /// Score of the first row or column of matrix MatName at (i, j), as initialized in doAffineAlignment().
+  double getBoundaryScore(Traceback::tbJump MatName, int i, int j) const;
+
+  /// Traceback of matrix MatName at (i, j).
+  Traceback::TracebackType getTraceback(Traceback::tbJump MatName, int i, int j) const {
+    return Traceback::unpackTraceback(packedTraceback[(std::size_t)i*(signalB_len+1) + j], MatName);
+  }
+};
+
+namespace AffineAlignment
+{
+/**
+ * @brief Fills row i of M, A and B from row i-1 with fillAffineCell().
+ *
+ * Row i-1 of s is copied into sRow and penalized with penalty, if it is not NULL, just before it is used. Column 0 of
+ * curM, curA and curB is the boundary and must be set by the caller. Traceback of columns 1 to s.n_col is written to tbM, tbA
+ * and tbB. All engines that fill M, A and B row-by-row use it, hence, their scores and ties are identical.
+ * If hasSIMDKernel(), M and A are filled four columns at a time with AVX2, followed by a scalar pass for B. Results are identical.
+ */
+void fillAffineRow(const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty, int i, double go, double ge,
+                   const double* prevM, const double* prevA, const double* prevB, double* curM, double* curA, double* curB,
+                   Traceback::TracebackType* tbM, Traceback::TracebackType* tbA, Traceback::TracebackType* tbB,
+                   std::vector<double>& sRow);
+
+/**
+ * @brief Performs affine alignment while constraining the similarity matrix one row at a time.
+ *
+ * Row i-1 of s is copied into a buffer, penalized with NoBeefPenalty::constrainRow() and consumed immediately
+ * by the recurrence of M, A and B. Only two rows of M, A and B are kept, therefore, neither the MASK nor the full
+ * cumulative-score matrices are allocated. Scores, ties and Traceback are identical to applying calcNoBeefMask2()
+ * and constrainSimilarity() on s followed by doAffineAlignment().
+ *
+ * @param obj An object of class FusedAffineAlignObj. It must be initialized with ROW_SIZE and COL_SIZE one more than that of s.
+ * @param s similarity score matrix. It is not modified.
+ * @param penalty Penalty added to each row of s. If NULL, s is aligned as it is.
+ * @param go gap opening penalty in alignment path.
+ * @param ge gap extension penalty in alignment path.
+ * @param OverlapAlignment If true, end gaps are not penalized.
+ */
+void doFusedAffineAlignment(FusedAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty,
+                            double go, double ge, bool OverlapAlignment);
+
+/**
+ * @brief Calculates aligned indices for source signal A and B from FusedAffineAlignObj.
+ *
+ * The start-cell search and the traceback are the same as in getAffineAlignedIndices().
+ * Cumulative scores along the path are recovered by replaying the recurrence from the end of the path, which gives the same values as stored in M, A and B.
+ * @param obj An object of class FusedAffineAlignObj. Must have been operated by doFusedAffineAlignment() function before.
+ * @param s similarity score matrix passed to doFusedAffineAlignment().
+ * @param penalty penalty passed to doFusedAffineAlignment().
+ */
+void getFusedAffineAlignedIndices(FusedAffineAlignObj& obj, const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty);
+} // namespace AffineAlignment
+} // namespace DIAlign
+
+#endif // FUSEDALIGNMENT_H
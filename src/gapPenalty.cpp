@@ -1,28 +1,30 @@
 #include "gapPenalty.h"
+#include "chromSimMatrix.h"
 
 namespace DIAlign
 {
-double getGapPenalty(const SimMatrix& s, double gapQuantile, std::string SimType){
-  double gapPenalty;
-  if (SimType == "dotProductMasked")
-    gapPenalty = Utils::getQuantile(s.data, gapQuantile);
-    // gapPenalty = 0.96;
-  else if (SimType == "dotProduct")
-    gapPenalty = Utils::getQuantile(s.data, gapQuantile);
-  else if(SimType == "cosineAngle")
-    gapPenalty = 0.95;
-  else if(SimType == "cosine2Angle")
+double getGapPenalty(const SimMatrix& s, double gapQuantile, SimilarityType SimType, bool approxQuantile){
+  double gapPenalty = 0.0;
+  switch(SimType){
+  case SimilarityType::dotProductMasked:
+  case SimilarityType::dotProduct:
+  case SimilarityType::euclideanDist:
+  case SimilarityType::covariance:
+  case SimilarityType::correlation:
+    gapPenalty = approxQuantile ? Utils::getApproxQuantile(s.data, gapQuantile) : Utils::getQuantile(s.data, gapQuantile);
+    break;
+  case SimilarityType::cosineAngle:
+  case SimilarityType::cosine2Angle:
     gapPenalty = 0.95;
-  else if(SimType == "euclideanDist")
-    gapPenalty = Utils::getQuantile(s.data, gapQuantile);
-  else if(SimType == "covariance")
-    gapPenalty = Utils::getQuantile(s.data, gapQuantile);
-  else if(SimType == "correlation")
-    gapPenalty = Utils::getQuantile(s.data, gapQuantile);
-  else
-  {
+    break;
+  default:
     // Rcpp::Rcout << "getChromSimMat should have value from given choices only!" << std::endl;
+    break;
   }
   return std::max(0.01, gapPenalty); // gapPenalty must be positive.
 }
+
+double getGapPenalty(const SimMatrix& s, double gapQuantile, std::string SimType){
+  return getGapPenalty(s, gapQuantile, SimilarityMatrix::getSimilarityType(SimType));
+}
 } // namespace DIAlign
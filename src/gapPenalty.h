@@ -15,6 +15,14 @@ namespace DIAlign
    * gapQuantile must be between 0 and 1.
    */
   double getGapPenalty(const SimMatrix& s, double gapQuantile, std::string SimType);
+
+  /**
+   * @brief returns a gap penalty from the distribution of similarity scores for a SimilarityType.
+   *
+   * Same as getGapPenalty() with SimType converted by SimilarityMatrix::getSimilarityType().
+   * If approxQuantile is true, the quantile is estimated by Utils::getApproxQuantile().
+   */
+  double getGapPenalty(const SimMatrix& s, double gapQuantile, SimilarityType SimType, bool approxQuantile = false);
 } // namespace DIAlign
 
 #endif // GAPPENALTY_H
@@ -0,0 +1,278 @@
+#include "globalFit.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include "utils.h"
+
+namespace DIAlign
+{
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  /* Fitted value of lowess() at xs from points nleft to nright (0-based), with ties on the right included.
+   * w is a scratch buffer, rw has robustness weights if useRw. Returns false if all weights are zero. */
+  bool lowessPoint(const std::vector<double>& x, const std::vector<double>& y, double xs, int nleft, int nright,
+                   std::vector<double>& w, bool useRw, const std::vector<double>& rw, double& ys){
+    int n = x.size();
+    double range = x[n-1] - x[0];
+    double h = std::max(xs - x[nleft], x[nright] - xs);
+    double h9 = 0.999*h, h1 = 0.001*h;
+    double a = 0.0;
+    int j = nleft;
+    for(; j < n; j++){
+      w[j] = 0.0;
+      double r = std::abs(x[j] - xs);
+      if(r <= h9){
+        if(r <= h1){
+          w[j] = 1.0;
+        } else {
+          double q = r/h;
+          q = 1.0 - q*q*q;
+          w[j] = q*q*q; // Tricube weight
+        }
+        if(useRw) w[j] *= rw[j];
+        a += w[j];
+      } else if(x[j] > xs){
+        break;
+      }
+    }
+    int nrt = j - 1;
+    if(a <= 0.0) return false;
+    for(j = nleft; j <= nrt; j++) w[j] /= a;
+    if(h > 0.0){
+      // Linear fit about the weighted center of x.
+      a = 0.0;
+      for(j = nleft; j <= nrt; j++) a += w[j]*x[j];
+      double b = xs - a;
+      double c = 0.0;
+      for(j = nleft; j <= nrt; j++) c += w[j]*(x[j]-a)*(x[j]-a);
+      if(std::sqrt(c) > 0.001*range){
+        b /= c;
+        for(j = nleft; j <= nrt; j++) w[j] *= (b*(x[j]-a) + 1.0);
+      }
+    }
+    ys = 0.0;
+    for(j = nleft; j <= nrt; j++) ys += w[j]*y[j];
+    return true;
+  }
+}
+
+GlobalFit::GlobalFit(double intercept, double slope):
+  type(GlobalFitType::linear), intercept(intercept), slope(slope){}
+
+GlobalFit::GlobalFit(const std::vector<double>& x, const std::vector<double>& y, GlobalFitType type):
+  type(type), intercept(0.0), slope(0.0){
+  if(type == GlobalFitType::linear){
+    throw std::invalid_argument("Knots are only used by loess and spline fits.");
+  }
+  if(x.size() != y.size()){
+    throw std::invalid_argument("x and y must have the same number of knots.");
+  }
+  std::vector<std::size_t> order;
+  for(std::size_t i = 0; i < x.size(); i++){
+    if(!std::isnan(x[i]) && !std::isnan(y[i])) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&x](std::size_t a, std::size_t b){return x[a] < x[b];});
+  // Ties are averaged as in stats::approxfun(ties = mean).
+  for(std::size_t i = 0; i < order.size();){
+    std::size_t j = i;
+    double sum = 0.0;
+    while(j < order.size() && x[order[j]] == x[order[i]]) sum += y[order[j++]];
+    this->x.push_back(x[order[i]]);
+    this->y.push_back(sum/(j - i));
+    i = j;
+  }
+  int n = this->x.size();
+  if(n < 2){
+    throw std::invalid_argument("At least two unique knots are needed for a global fit.");
+  }
+  if(type != GlobalFitType::spline) return;
+
+  // Second derivatives of the natural cubic spline from the tridiagonal system, solved by Thomas algorithm.
+  ypp.assign(n, 0.0);
+  std::vector<double> diag(n, 1.0), upper(n, 0.0);
+  for(int i = 1; i < n-1; i++){
+    double hl = this->x[i] - this->x[i-1];
+    double hr = this->x[i+1] - this->x[i];
+    double rhs = 6.0*((this->y[i+1] - this->y[i])/hr - (this->y[i] - this->y[i-1])/hl);
+    diag[i] = 2.0*(hl + hr) - hl*upper[i-1];
+    upper[i] = hr/diag[i];
+    ypp[i] = (rhs - hl*ypp[i-1])/diag[i];
+  }
+  for(int i = n-2; i > 0; i--) ypp[i] -= upper[i]*ypp[i+1];
+}
+
+double GlobalFit::predict(double t) const{
+  if(type == GlobalFitType::linear) return intercept + slope*t;
+  if(std::isnan(t) || t < x.front() || t > x.back()) return std::numeric_limits<double>::quiet_NaN();
+  // x[i] <= t < x[j], except that t == x.back() falls in the last interval.
+  std::size_t j = std::upper_bound(x.begin(), x.end(), t) - x.begin();
+  if(j == x.size()) return y.back();
+  std::size_t i = j - 1;
+  if(t == x[i]) return y[i];
+  double h = x[j] - x[i];
+  if(type == GlobalFitType::loess) return y[i] + (y[j] - y[i])*((t - x[i])/h);
+  double a = (x[j] - t)/h;
+  double b = (t - x[i])/h;
+  return a*y[i] + b*y[j] + ((a*a*a - a)*ypp[i] + (b*b*b - b)*ypp[j])*h*h/6.0;
+}
+
+std::vector<double> GlobalFit::predict(const std::vector<double>& t) const{
+  std::vector<double> result(t.size());
+  for(std::size_t i = 0; i < t.size(); i++) result[i] = predict(t[i]);
+  return result;
+}
+
+GlobalFitType getGlobalFitType(const std::string& fitType){
+  if(fitType == "linear") return GlobalFitType::linear;
+  if(fitType == "loess") return GlobalFitType::loess;
+  if(fitType == "spline") return GlobalFitType::spline;
+  throw std::invalid_argument("fitType must be from linear, loess and spline.");
+}
+
+std::vector<double> getMappedTimes(const GlobalFit& fit, const std::vector<double>& tRef, const std::vector<double>& tExp){
+  if(tExp.empty()){
+    throw std::invalid_argument("Experiment times must not be empty.");
+  }
+  std::vector<double> Bp = fit.predict(tRef);
+  bool valid = std::all_of(Bp.begin(), Bp.end(), [](double t){return t > 0.0;}); // NaN is not positive.
+  if(valid) return Bp;
+  // Same as seq(from, to, length.out = n) in R.
+  int n = Bp.size();
+  double from = tExp.front(), to = tExp.back();
+  double by = (n > 1) ? (to - from)/(n - 1) : 0.0;
+  for(int i = 0; i < n; i++) Bp[i] = from + i*by;
+  if(n > 1) Bp[n-1] = to;
+  return Bp;
+}
+
+std::vector<double> lowess(const std::vector<double>& x, const std::vector<double>& y, double f, int iter, double delta){
+  int n = x.size();
+  if(n < 1 || (int)y.size() != n){
+    throw std::invalid_argument("x and y must be non-empty and of same size.");
+  }
+  if(!(f > 0.0) || iter < 0 || !(delta >= 0.0)){
+    throw std::invalid_argument("f must be positive, iter and delta must not be negative.");
+  }
+  std::vector<double> ys(n, y[0]);
+  if(n < 2) return ys;
+  int ns = std::max(2, std::min(n, (int)(f*n + 1e-7)));
+  std::vector<double> w(n), rw(n), res(n);
+  for(int it = 0; it <= iter; it++){
+    int nleft = 0, nright = ns - 1;
+    int last = -1; // Index of the previous fitted point.
+    int i = 0;
+    for(;;){
+      if(nright < n-1){
+        // Move the window to the right if its radius decreases.
+        if(x[i] - x[nleft] > x[nright+1] - x[i]){
+          nleft++;
+          nright++;
+          continue;
+        }
+      }
+      if(!lowessPoint(x, y, x[i], nleft, nright, w, it > 0, rw, ys[i])) ys[i] = y[i];
+      // Interpolate the points skipped since the last fitted point.
+      if(last < i-1){
+        double denom = x[i] - x[last];
+        for(int j = last+1; j < i; j++){
+          double alpha = (x[j] - x[last])/denom;
+          ys[j] = alpha*ys[i] + (1.0-alpha)*ys[last];
+        }
+      }
+      last = i;
+      double cut = x[last] + delta;
+      for(i = last+1; i < n; i++){
+        if(x[i] > cut) break;
+        if(x[i] == x[last]){
+          ys[i] = ys[last];
+          last = i;
+        }
+      }
+      i = std::max(last+1, i-1);
+      if(last >= n-1) break;
+    }
+    double sc = 0.0;
+    for(int j = 0; j < n; j++){
+      res[j] = y[j] - ys[j];
+      sc += std::abs(res[j]);
+    }
+    sc /= n;
+    if(it == iter) break;
+
+    // Robustness weights are bisquare of residuals scaled by 6 * median(|residuals|).
+    for(int j = 0; j < n; j++) rw[j] = std::abs(res[j]);
+    int m1 = n/2;
+    std::nth_element(rw.begin(), rw.begin()+m1, rw.end());
+    double cmad;
+    if(n % 2 == 0){
+      double upper = rw[m1];
+      int m2 = n - m1 - 1;
+      std::nth_element(rw.begin(), rw.begin()+m2, rw.end());
+      cmad = 3.0*(upper + rw[m2]);
+    } else {
+      cmad = 6.0*rw[m1];
+    }
+    if(cmad < 1e-7*sc) break;
+    double c9 = 0.999*cmad, c1 = 0.001*cmad;
+    for(int j = 0; j < n; j++){
+      double r = std::abs(res[j]);
+      if(r <= c1){
+        rw[j] = 1.0;
+      } else if(r <= c9){
+        double q = r/cmad;
+        q = 1.0 - q*q;
+        rw[j] = q*q;
+      } else {
+        rw[j] = 0.0;
+      }
+    }
+  }
+  return ys;
+}
+
+LoessFit getLOESSfit(const std::vector<double>& RTref, const std::vector<double>& RTeXp, double spanvalue, int iter){
+  int n = RTref.size();
+  if(n < 1 || (int)RTeXp.size() != n){
+    throw std::invalid_argument("RTref and RTeXp must be non-empty and of same size.");
+  }
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&RTref](int a, int b){return RTref[a] < RTref[b];});
+  LoessFit fit;
+  std::vector<double> y(n);
+  fit.x.resize(n);
+  for(int i = 0; i < n; i++){
+    fit.x[i] = RTref[order[i]];
+    y[i] = RTeXp[order[i]];
+  }
+  double delta = 0.01*(fit.x[n-1] - fit.x[0]);
+  fit.y = lowess(fit.x, y, spanvalue, iter, delta);
+
+  fit.RSE = std::numeric_limits<double>::quiet_NaN();
+  if(n > 2 && fit.x[0] < fit.x[n-1]){
+    GlobalFit interpolated(fit.x, fit.y, GlobalFitType::loess);
+    double sum = 0.0;
+    for(int i = 0; i < n; i++){
+      double r = RTeXp[i] - interpolated.predict(RTref[i]);
+      sum += r*r;
+    }
+    fit.RSE = std::sqrt(sum/(n-2));
+  }
+  return fit;
+}
+
+std::vector<LoessFit> getLOESSfits(const std::vector<std::vector<double>>& RTrefs, const std::vector<std::vector<double>>& RTeXps,
+                                   double spanvalue, int nThreads, int iter){
+  if(RTrefs.size() != RTeXps.size()){
+    throw std::invalid_argument("RTrefs and RTeXps must have one element for each pair of runs.");
+  }
+  std::vector<LoessFit> fits(RTrefs.size());
+  Utils::parallelFor(RTrefs.size(), nThreads, [&](int k){
+    fits[k] = getLOESSfit(RTrefs[k], RTeXps[k], spanvalue, iter);
+  });
+  return fits;
+}
+} // namespace DIAlign
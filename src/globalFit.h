@@ -0,0 +1,128 @@
+#ifndef GLOBALFIT_H
+#define GLOBALFIT_H
+
+#include <vector>
+#include <string>
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/// Type of a global fit between retention times of two runs.
+enum class GlobalFitType {linear, loess, spline};
+
+/**
+ * @brief Maps reference retention times onto an experiment run.
+ *
+ * A linear fit is intercept + slope*t. A loess fit interpolates linearly between the knots of a smoothed fit, as
+ * stats::approxfun(lowess(...), ties = mean) does. A spline fit interpolates the knots with a natural cubic spline, same as
+ * naturalSpline().
+ * Duplicated knots are replaced by a single knot with the mean of their y. Outside the knot range, loess and spline
+ * fits predict NaN. The object is built once per pair of runs and does not call R API, hence, it can be shared by threads.
+ */
+struct GlobalFit
+{
+  GlobalFitType type; ///< Type of the fit.
+  double intercept; ///< Intercept of a linear fit.
+  double slope; ///< Slope of a linear fit.
+  std::vector<double> x; ///< Sorted unique knots in reference time. Empty for a linear fit.
+  std::vector<double> y; ///< Experiment time at each knot. Empty for a linear fit.
+  std::vector<double> ypp; ///< Second derivative of the natural cubic spline at each knot. Empty unless a spline fit.
+
+  /**
+   * @brief Constructor for a linear GlobalFit.
+   *
+   * @param intercept Intercept of the fit.
+   * @param slope Slope of the fit.
+   */
+  GlobalFit(double intercept, double slope);
+
+  /**
+   * @brief Constructor for a loess or a spline GlobalFit.
+   *
+   * Pairs with a NaN are dropped. At least two unique knots must remain.
+   * @param x Reference times of knots. Need not be sorted.
+   * @param y Experiment times of knots. Must be of same size as x.
+   * @param type Must be GlobalFitType::loess or GlobalFitType::spline.
+   */
+  GlobalFit(const std::vector<double>& x, const std::vector<double>& y, GlobalFitType type);
+
+  /// Returns experiment time of the reference time t.
+  double predict(double t) const;
+
+  /// Returns experiment time of each reference time in t.
+  std::vector<double> predict(const std::vector<double>& t) const;
+};
+
+/// Returns GlobalFitType from "linear", "loess" and "spline".
+GlobalFitType getGlobalFitType(const std::string& fitType);
+
+/**
+ * @brief Experiment times mapped by the global fit for each reference time.
+ *
+ * If any predicted time is NaN or not positive, equally spaced times from tExp.front() to tExp.back() are returned
+ * instead, as seq(from, to, length.out) in R.
+ * @param fit Global fit from reference to experiment run.
+ * @param tRef Reference times.
+ * @param tExp Experiment times. Must not be empty.
+ */
+std::vector<double> getMappedTimes(const GlobalFit& fit, const std::vector<double>& tRef, const std::vector<double>& tExp);
+
+/**
+ * @brief LOESS fit between retention times of two runs.
+ *
+ * Same as the output of getLOESSfit() in R, with RSE from getRSE().
+ */
+struct LoessFit
+{
+  std::vector<double> x; ///< Sorted reference times.
+  std::vector<double> y; ///< Fitted experiment time at each x.
+  double RSE; ///< Residual standard error of the fit at the reference times. NaN if there are two or less pairs.
+};
+
+/**
+ * @brief Locally-weighted linear regression, identical to stats::lowess in R.
+ *
+ * At each fitted point, neighbours within the span get tricube weights and a weighted linear fit is evaluated.
+ * Fits are evaluated only on a grid of points that are at least delta apart, the points in between are interpolated
+ * linearly. Robustness iterations down-weight points with large residuals by bisquare weights.
+ * @param x Sorted x values.
+ * @param y y values. Must be of same size as x.
+ * @param f Fraction of points that influence each fitted value.
+ * @param iter Number of robustness iterations.
+ * @param delta Points within delta of the last fitted point are interpolated.
+ * @return Fitted y at each x.
+ */
+std::vector<double> lowess(const std::vector<double>& x, const std::vector<double>& y, double f, int iter, double delta);
+
+/**
+ * @brief Fits LOESS between retention times of the same peptides in two runs.
+ *
+ * Pairs are sorted by reference time and fitted with lowess() with delta as 1% of the reference time range.
+ * Residuals for RSE are calculated at each reference time by linear interpolation of the fit.
+ * @param RTref Retention times in reference run.
+ * @param RTeXp Retention times of the same peptides in experiment run.
+ * @param spanvalue Fraction of points that influence each fitted value.
+ * @param iter Number of robustness iterations.
+ */
+LoessFit getLOESSfit(const std::vector<double>& RTref, const std::vector<double>& RTeXp, double spanvalue, int iter = 3);
+
+/**
+ * @brief Fits LOESS for many pairs of runs on a pool of native threads.
+ *
+ * Result k is the same as getLOESSfit(RTrefs[k], RTeXps[k], spanvalue, iter).
+ * @param RTrefs Retention times in reference run of each pair.
+ * @param RTeXps Retention times in experiment run of each pair.
+ * @param spanvalue Fraction of points that influence each fitted value.
+ * @param nThreads Number of threads, including the calling thread.
+ * @param iter Number of robustness iterations.
+ */
+std::vector<LoessFit> getLOESSfits(const std::vector<std::vector<double>>& RTrefs, const std::vector<std::vector<double>>& RTeXps,
+                                   double spanvalue, int nThreads, int iter = 3);
+} // namespace DIAlign
+
+#endif // GLOBALFIT_H
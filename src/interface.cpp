@@ -1,4 +1,7 @@
 #include "interface.h"
+#include "SavitzkyGolayFilter.h"
+#include "miscell.h"
+#include <algorithm>
 
 namespace DIAlign
 {
@@ -31,6 +34,48 @@ std::vector<std::vector<double> > getIntensity(Rcpp::List l){
   return VecOfVec;
 }
 
+ChromatogramGroup getChromatogramGroup(Rcpp::List l, int kernelLen, int polyOrd){
+  int nFrag = l.size();
+  std::vector<NumericMatrix> chroms;
+  for (int i = 0; i < nFrag; i++) chroms.push_back(as<NumericMatrix>(l[i]));
+  bool sharedTime = nFrag > 0;
+  for (int i = 1; i < nFrag && sharedTime; i++){
+    sharedTime = (chroms[i].nrow() == chroms[0].nrow()) && std::equal(chroms[0].begin(), chroms[0].begin() + chroms[0].nrow(), chroms[i].begin());
+  }
+  SavitzkyGolayFilter sgolay(kernelLen, polyOrd);
+  if(kernelLen != 0) sgolay.setCoeff();
+  if(!sharedTime){
+    std::vector<std::vector<double> > time = getTime(l);
+    std::vector<std::vector<double> > intensity = getIntensity(l);
+    if(kernelLen != 0){
+      for (auto& v : intensity) sgolay.smoothChroms(v);
+    }
+    return ChromatogramGroup(std::move(time), std::move(intensity));
+  }
+
+  // Same range as xicIntersect() of a single time vector, found from indices that are intersected along with time.
+  int n = chroms[0].nrow();
+  std::vector<std::vector<double> > time(1, std::vector<double>(chroms[0].begin(), chroms[0].begin() + n));
+  std::vector<std::vector<double> > index(1, std::vector<double>(n));
+  for (int j = 0; j < n; j++) index[0][j] = j;
+  xicIntersect(time, index);
+  int start = index[0].front();
+  ChromatogramGroup g(std::move(time[0]), nFrag);
+
+  // Intensity is the second column of each matrix, which is stored column-major.
+  std::vector<double> smoothed(kernelLen != 0 ? n : 0);
+  for (int i = 0; i < nFrag; i++){
+    const double* intensity = chroms[i].begin() + n;
+    if(kernelLen != 0){
+      std::copy(intensity, intensity + n, smoothed.begin());
+      sgolay.smoothChroms(smoothed.data(), n);
+      intensity = smoothed.data();
+    }
+    std::copy(intensity + start, intensity + start + g.len, g.fragment(i));
+  }
+  return g;
+}
+
 void printVecOfVec(Rcpp::List l){
   // Printing output of list2VecOfVec function
   std::vector<std::vector<double> > VecOfVec = list2VecOfVec(l);
@@ -4,6 +4,7 @@
 #include <Rcpp.h>
 #include <vector>
 #include "simpleFcn.h"
+#include "chromatogramGroup.h"
 using namespace Rcpp;
 
 namespace DIAlign
@@ -14,6 +15,13 @@ std::vector<std::vector<double> > getTime(Rcpp::List l);
 
 std::vector<std::vector<double> > getIntensity(Rcpp::List l);
 
+/// Reads a list of chromatograms, as two-column matrices of time and intensity, into a ChromatogramGroup.
+///
+/// Intensities are smoothed with SavitzkyGolayFilter(kernelLen, polyOrd) unless kernelLen is zero, afterwards fragment-ions are
+/// intersected as xicIntersect(). When all fragment-ions share the time column, intensities are copied from R memory into the
+/// group directly, without a vector per fragment-ion.
+ChromatogramGroup getChromatogramGroup(Rcpp::List l, int kernelLen = 0, int polyOrd = 4);
+
 void printVecOfVec(Rcpp::List l);
 
 template<class T>
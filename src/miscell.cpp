@@ -102,25 +102,51 @@ std::vector<int> getNegIndices(const std::vector<double> & A){
   return B;
 }
 
-std::vector<std::vector<double>> imputeChromatogram(const std::vector<std::vector<double>> & A,
-                                                    const std::vector<double> & t,
-                                                    const std::vector<int> & index){
-  int nrow = index.size();
-  // Expand time to indices
-  std::vector<double> tnew(nrow, -1.0);
-  for(int i= 0; i<nrow; i++){
-    if(index[i] != 0){
-      tnew[i] = t[index[i]-1];
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Expands t to aligned indices and fills gaps like zoo::na.approx. Indices of filled gaps are written into middle.
+  std::vector<double> imputeTime(const std::vector<double> & t, const std::vector<int> & index, std::vector<int> & middle){
+    int nrow = index.size();
+    // Expand time to indices
+    std::vector<double> tnew(nrow, -1.0);
+    for(int i= 0; i<nrow; i++){
+      if(index[i] != 0){
+        tnew[i] = t[index[i]-1];
+      }
     }
+    std::vector<int> s1 = getNegIndices(tnew);
+
+    // Fill missing values like zoo::na.approx
+    interpolateZero(tnew);
+    std::vector<int> s2 = getNegIndices(tnew);
+    std::set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(),
+                        std::inserter(middle, middle.end()));
+    return tnew;
   }
-  std::vector<int> s1 = getNegIndices(tnew);
 
-  // Fill missing values like zoo::na.approx
-  interpolateZero(tnew);
-  std::vector<int> s2 = getNegIndices(tnew);
+  // Expands intensity y of a fragment-ion to aligned indices and spline-interpolates it at the filled gaps.
+  std::vector<double> imputeIntensity(const std::vector<double> & t, const std::vector<double> & y, const std::vector<int> & index,
+                                      const std::vector<int> & middle, const std::vector<double> & xout){
+    int nrow = index.size();
+    std::vector<double> intensity(nrow, -1.0);
+    for(int j= 0; j<nrow; j++){
+      if(index[j] != 0){
+        intensity[j] = y[index[j]-1];
+      }
+    }
+    std::vector<double> result = naturalSpline(t, y, xout);
+    for(int j=0; j<result.size(); j++){
+      intensity[middle[j]] = result[j];
+    }
+    return intensity;
+  }
+}
+
+std::vector<std::vector<double>> imputeChromatogram(const std::vector<std::vector<double>> & A,
+                                                    const std::vector<double> & t,
+                                                    const std::vector<int> & index){
   std::vector<int> middle;
-  std::set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(),
-                      std::inserter(middle, middle.end()));
+  std::vector<double> tnew = imputeTime(t, index, middle);
   std::vector<double> xout(middle.size());
   for(int i =0; i< middle.size(); i++){
     xout[i] = tnew[middle[i]];
@@ -129,17 +155,29 @@ std::vector<std::vector<double>> imputeChromatogram(const std::vector<std::vecto
   // Interpolate intensity for each fragment.
   std::vector<std::vector<double>> Anew(A.size()+1);
   for(int i =0; i < (Anew.size()-1); i++){
-    std::vector<double> intensity(nrow, -1.0);
-    for(int j= 0; j<nrow; j++){
-      if(index[j] != 0){
-        intensity[j] = A[i][index[j]-1];
-      }
-    }
-    std::vector<double> result = naturalSpline(t, A[i], xout);
-    for(int j=0; j<result.size(); j++){
-      intensity[middle[j]] = result[j];
-    }
-    Anew[i] = intensity;
+    Anew[i] = imputeIntensity(t, A[i], index, middle, xout);
+  }
+
+  // Append time vector with fragments intensities.
+  Anew.back() = tnew;
+  return Anew;
+}
+
+std::vector<std::vector<double>> imputeChromatogram(const ChromatogramView & A, const std::vector<int> & index){
+  std::vector<double> t(A.time, A.time + A.len);
+  std::vector<int> middle;
+  std::vector<double> tnew = imputeTime(t, index, middle);
+  std::vector<double> xout(middle.size());
+  for(int i =0; i< middle.size(); i++){
+    xout[i] = tnew[middle[i]];
+  }
+
+  // Interpolate intensity for each fragment.
+  std::vector<std::vector<double>> Anew(A.nFrag+1);
+  std::vector<double> y(A.len);
+  for(int i =0; i < A.nFrag; i++){
+    std::copy(A.fragment(i), A.fragment(i) + A.len, y.begin());
+    Anew[i] = imputeIntensity(t, y, index, middle, xout);
   }
 
   // Append time vector with fragments intensities.
@@ -365,4 +403,11 @@ std::vector<std::vector<double>> imputeChromatogram1(const std::vector<std::vect
   return intensity;
 }
 
+std::vector<std::vector<double>> imputeChromatogram1(const ChromatogramView & A, const std::vector<int> & tIndex,
+                                                     const std::vector<double> & tnew){
+  std::vector<std::vector<double>> vov(A.nFrag);
+  for(int j = 0; j < A.nFrag; j++) vov[j].assign(A.fragment(j), A.fragment(j) + A.len);
+  return imputeChromatogram1(vov, tIndex, std::vector<double>(A.time, A.time + A.len), tnew);
+}
+
 }
@@ -7,6 +7,7 @@
 #include <functional>
 #include <string>
 #include "spline.h"
+#include "chromatogramGroup.h"
 
 namespace DIAlign
 {
@@ -26,6 +27,9 @@ std::vector<int> getNegIndices(const std::vector<double> & A);
 std::vector<std::vector<double>> imputeChromatogram(const std::vector<std::vector<double>> & A,
                                        const std::vector<double> & t, const std::vector<int> & index);
 
+// Same as imputeChromatogram() with intensities and time of the chromatogram group A.
+std::vector<std::vector<double>> imputeChromatogram(const ChromatogramView & A, const std::vector<int> & index);
+
 std::vector<int> getFlank(const std::vector<double> & t1, const std::vector<double> & t2);
 std::vector<int> getSkip(const std::vector<int> & index, const std::vector<int> & flank);
 std::vector<int> getFlankN(const std::vector<double> & t, const std::vector<int> & flank);
@@ -52,5 +56,9 @@ std::vector<std::vector<double>> imputeChromatogram1(const std::vector<std::vect
                                                      const std::vector<int> & tIndex, const std::vector<double> & t,
                                                      const std::vector<double> & tnew);
 
+// Same as imputeChromatogram1() with intensities and time of the chromatogram group A.
+std::vector<std::vector<double>> imputeChromatogram1(const ChromatogramView & A, const std::vector<int> & tIndex,
+                                                     const std::vector<double> & tnew);
+
 } // namespace DIAlign
 #endif // XICINTERSECTS_H
@@ -0,0 +1,99 @@
+#include "preparedXICGroup.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace DIAlign
+{
+
+PreparedXICGroup::PreparedXICGroup(std::vector<std::vector<double>> time, std::vector<std::vector<double>> intensity,
+                                   NormalizationType normalization):
+  PreparedXICGroup(ChromatogramGroup(std::move(time), std::move(intensity)), normalization){}
+
+PreparedXICGroup::PreparedXICGroup(ChromatogramGroup xic, NormalizationType normalization):
+  xic(std::move(xic)), normalization(normalization){
+  if(this->xic.nFrag == 0){
+    throw std::invalid_argument("Each fragment-ion must have a time and an intensity vector.");
+  }
+  ChromatogramView d = SimilarityMatrix::normalizeVecOfVec(this->xic.view(), normalization, normalized);
+  eucLen = SimilarityMatrix::perSampleEucLenVecOfVec(d);
+  mean = SimilarityMatrix::perSampleMeanVecOfVec(d);
+  sum = SimilarityMatrix::perSampleSumVecOfVec(d);
+  sqrSum = SimilarityMatrix::perSampleSqrSumVecOfVec(d);
+}
+
+ChromatogramView PreparedXICGroup::normalizedIntensity() const{
+  return (normalization == NormalizationType::none) ? xic.view() : normalized.view();
+}
+
+namespace SimilarityMatrix
+{
+
+namespace {
+  // Copies the intensities of a view into a group that owns them.
+  ChromatogramGroup copyChromatogramGroup(const ChromatogramView& v){
+    ChromatogramGroup g(std::vector<double>(v.time, v.time + v.len), v.nFrag);
+    for(int k = 0; k < v.nFrag; k++) std::copy(v.fragment(k), v.fragment(k) + v.len, g.fragment(k));
+    return g;
+  }
+}
+
+SimMatrix getSimilarityMatrix(const PreparedXICGroup& g1, const PreparedXICGroup& g2, SimilarityType SimType,
+                              double cosAngleThresh, double dotProdThresh, int kerLen, bool approxQuantile){
+  if(g1.normalization != g2.normalization){
+    throw std::invalid_argument("Both groups must have the same normalization.");
+  }
+  if(g1.xic.nFrag != g2.xic.nFrag){
+    throw std::invalid_argument("Number of fragments needs to be equal");
+  }
+  ChromatogramView d1 = g1.normalizedIntensity();
+  ChromatogramView d2 = g2.normalizedIntensity();
+  SimMatrix s;
+  s.n_row = g1.size();
+  s.n_col = g2.size();
+  s.data.resize(s.n_row*s.n_col, 0.0);
+  switch(SimType){
+  case SimilarityType::dotProductMasked:
+    SumOuterProdMasked(d1, d2, g1.eucLen, g2.eucLen, s, cosAngleThresh, dotProdThresh, approxQuantile);
+    break;
+  case SimilarityType::dotProduct:
+    SumOuterProd(d1, d2, s);
+    break;
+  case SimilarityType::cosineAngle:
+    SumOuterCosine(d1, d2, g1.eucLen, g2.eucLen, s);
+    break;
+  case SimilarityType::cosine2Angle:
+    SumOuterCosine(d1, d2, g1.eucLen, g2.eucLen, s);
+    for(auto& i : s.data) i = cos2Angle(i);
+    clamp(s.data, -1.0, 1.0); // Clamp the cosine similarity between -1.0 and 1.0
+    break;
+  case SimilarityType::euclideanDist:
+    SumOuterEucl(d1, d2, s);
+    break;
+  case SimilarityType::covariance:
+    SumOuterCov(d1, d2, g1.mean, g2.mean, s);
+    break;
+  case SimilarityType::correlation:
+    SumOuterCorr(d1, d2, g1.sum, g2.sum, g1.sqrSum, g2.sqrSum, s);
+    break;
+  case SimilarityType::crossCorrelation:
+    SumXcorr(d1, d2, s, kerLen);
+    break;
+  default:
+    throw std::invalid_argument("Similarity type must be from the choices of getSimilarityMatrix().");
+  }
+  return s;
+}
+
+SimMatrix getSimilarityMatrix(const ChromatogramView& d1, const ChromatogramView& d2, NormalizationType Norm, SimilarityType SimType,
+                              double cosAngleThresh, double dotProdThresh, int kerLen){
+  if(d1.nFrag == 0 || d1.nFrag != d2.nFrag){
+    throw std::invalid_argument("Number of fragments needs to be equal");
+  }
+  PreparedXICGroup g1(copyChromatogramGroup(d1), Norm);
+  PreparedXICGroup g2(copyChromatogramGroup(d2), Norm);
+  return getSimilarityMatrix(g1, g2, SimType, cosAngleThresh, dotProdThresh, kerLen);
+}
+
+} // namespace SimilarityMatrix
+} // namespace DIAlign
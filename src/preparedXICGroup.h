@@ -0,0 +1,79 @@
+#ifndef PREPAREDXICGROUP_H
+#define PREPAREDXICGROUP_H
+
+#include <vector>
+#include "similarityMatrix.h"
+#include "chromSimMatrix.h"
+#include "chromatogramGroup.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+
+/**
+ * @brief A fragment-ion chromatogram group that is ready for computing similarity.
+ *
+ * Time and intensity vectors are intersected to a common time range (xicIntersect()) and stored in a ChromatogramGroup, intensities
+ * are normalized once.
+ * Per-sample statistics used by the similarity measures are cached as well. When the same reference group is aligned against
+ * many experiment runs, the reference-side work is done only once.
+ * Intensities must be smoothed before constructing the group.
+ */
+struct PreparedXICGroup
+{
+  ChromatogramGroup xic; ///< Intersected chromatograms of fragment-ions with a shared time axis.
+  NormalizationType normalization; ///< Normalization applied to intensity.
+  ChromatogramGroup normalized; ///< Normalized intensity. Empty for NormalizationType::none, use normalizedIntensity().
+  std::vector<double> eucLen; ///< perSampleEucLenVecOfVec() of normalized intensity.
+  std::vector<double> mean; ///< perSampleMeanVecOfVec() of normalized intensity.
+  std::vector<double> sum; ///< perSampleSumVecOfVec() of normalized intensity.
+  std::vector<double> sqrSum; ///< perSampleSqrSumVecOfVec() of normalized intensity.
+
+  /**
+   * @brief Constructor for PreparedXICGroup.
+   *
+   * @param time Time vectors of fragment-ions.
+   * @param intensity Smoothed intensity vectors of fragment-ions. Must be of same size as time.
+   * @param normalization Normalization applied to intensity before similarity is calculated.
+   */
+  PreparedXICGroup(std::vector<std::vector<double>> time, std::vector<std::vector<double>> intensity, NormalizationType normalization);
+
+  /**
+   * @brief Constructor for PreparedXICGroup from already intersected chromatograms.
+   *
+   * @param xic Smoothed chromatograms of fragment-ions. Must have at least one fragment-ion.
+   * @param normalization Normalization applied to intensity before similarity is calculated.
+   */
+  PreparedXICGroup(ChromatogramGroup xic, NormalizationType normalization);
+
+  /// Returns intensity after normalization. For NormalizationType::none it is the intensity itself.
+  ChromatogramView normalizedIntensity() const;
+
+  /// Number of samples after intersection.
+  int size() const {return xic.len;}
+};
+
+namespace SimilarityMatrix
+{
+  /// Returns the similarity matrix between two prepared groups.
+  ///
+  /// It is identical to getSimilarityMatrix() on the intensities of g1 and g2 with their normalization.
+  /// Normalized intensities and per-sample statistics are taken from the groups instead of being recomputed.
+  /// Both groups must have the same normalization and number of fragment-ions.
+  /// @param g1 corresponds to signal A.
+  /// @param g2 corresponds to signal B.
+  /// @param SimType Similarity type. Must not be SimilarityType::unknown.
+  /// @param cosAngleThresh In simType = dotProductMasked mode, angular similarity should be higher than cosAngleThresh otherwise similarity is forced to zero.
+  /// @param dotProdThresh In simType = dotProductMasked mode, values in similarity matrix higher than dotProdThresh quantile are checked for angular similarity.
+  /// @param kerLen In simType = crossCorrelation, length of the kernel used to sum similarity score. Must be an odd number.
+  /// @param approxQuantile If true, the dotProdThresh quantile is estimated by Utils::getApproxQuantile().
+  SimMatrix getSimilarityMatrix(const PreparedXICGroup& g1, const PreparedXICGroup& g2, SimilarityType SimType,
+                                double cosAngleThresh, double dotProdThresh, int kerLen, bool approxQuantile = false);
+} // namespace SimilarityMatrix
+} // namespace DIAlign
+
+#endif // PREPAREDXICGROUP_H
@@ -96,19 +96,14 @@ void alignChromatogramsCpp( AffineAlignObj& obj,
   double gapPenalty = getGapPenalty(s, gapQuantile, simType);
   if (alignType == "hybrid")
   {
-    SimMatrix MASK;
-    MASK.n_row = tA.size();
-    MASK.n_col = tB.size();
-    MASK.data.resize(MASK.n_row*MASK.n_col, 0.0);
-    double A1 = tA[0], A2 = tA[MASK.n_row-1];
-    double B1 = tB[0], B2 = tB[MASK.n_col-1];
-    calcNoBeefMask(MASK, A1, A2, B1, B2, B1p, B2p, noBeef, hardConstrain);
     auto maxIt = max_element(std::begin(s.data), std::end(s.data));
     double maxVal = *maxIt;
-    constrainSimilarity(s, MASK, -2.0*maxVal/samples4gradient);
+    NoBeefLinePenalty penalty(tA.size(), tB.size(), tA.front(), tA.back(), tB.front(), B1p, B2p, noBeef, hardConstrain,
+                              -2.0*maxVal/samples4gradient);
+    for(int i = 0; i < s.n_row; i++) penalty.constrainRow(i, &s.data[i*s.n_col]);
   }
   doAffineAlignment(obj, s, gapPenalty*goFactor, gapPenalty*geFactor, OverlapAlignment); // Performs alignment on s matrix and returns AffineAlignObj struct
-  getAffineAlignedIndices(obj); // Performs traceback and fills aligned indices in AffineAlignObj struct
+  getAffineAlignedIndices(obj, 0, AlignOutput::indices); // Performs traceback and fills aligned indices in AffineAlignObj struct
 }
 
 void doAlignment()
@@ -0,0 +1,68 @@
+#include "scorealignment.h"
+#include "fusedalignment.h"
+#include "affineengine.h"
+#include <limits>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace {
+  // Same update as getOlapAffineAlignStartIndices(): M before A before B, the first one not below maxScore wins.
+  void updateStartScore(double& maxScore, double cellM, double cellA, double cellB){
+    if(cellM >= maxScore) maxScore = cellM;
+    else if(cellA >= maxScore) maxScore = cellA;
+    else if(cellB >= maxScore) maxScore = cellB;
+  }
+}
+
+namespace DIAlign
+{
+
+using namespace Traceback;
+
+namespace AffineAlignment
+{
+
+double getAffineAlignmentScore(const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty,
+                               double go, double ge, bool OverlapAlignment){
+  validateAffineAlignment("similarity matrix s", s.n_row, s.n_col, s, penalty, go, ge);
+  double Inf = std::numeric_limits<double>::infinity();
+  int COL_SIZE = s.n_col + 1;
+
+  // Row 0 of M, A and B, initialized as in doAffineAlignment().
+  std::vector<double> prevM(COL_SIZE, -Inf), prevA(COL_SIZE, -Inf), prevB(COL_SIZE);
+  std::vector<double> curM(COL_SIZE), curA(COL_SIZE), curB(COL_SIZE);
+  prevM[0] = 0.0;
+  prevB[0] = -Inf;
+  for(int j = 1; j < COL_SIZE; j++) prevB[j] = OverlapAlignment ? 0.0 : -(j-1)*ge - go;
+
+  // Start-cell search along the last column, then the last row, as in getAffineAlignedIndices().
+  double maxScore = -Inf;
+  updateStartScore(maxScore, prevM[COL_SIZE-1], prevA[COL_SIZE-1], prevB[COL_SIZE-1]);
+  std::vector<double> sRow(s.n_col);
+  std::vector<TracebackType> tbM(COL_SIZE), tbA(COL_SIZE), tbB(COL_SIZE); // Traceback of a row is not kept.
+  for(int i = 1; i <= s.n_row; i++){
+    curM[0] = -Inf;
+    curA[0] = OverlapAlignment ? 0.0 : -(i-1)*ge - go;
+    curB[0] = -Inf;
+    fillAffineRow(s, penalty, i, go, ge, &prevM[0], &prevA[0], &prevB[0], &curM[0], &curA[0], &curB[0],
+                  &tbM[0], &tbA[0], &tbB[0], sRow);
+    updateStartScore(maxScore, curM[COL_SIZE-1], curA[COL_SIZE-1], curB[COL_SIZE-1]);
+    prevM.swap(curM);
+    prevA.swap(curA);
+    prevB.swap(curB);
+  }
+
+  if(!OverlapAlignment){
+    // Global alignment ends at the bottom-right cell.
+    double Mscore = prevM[COL_SIZE-1], Ascore = prevA[COL_SIZE-1], Bscore = prevB[COL_SIZE-1];
+    if (Mscore >= Ascore && Mscore >= Bscore) return Mscore;
+    if (Ascore >= Mscore && Ascore >= Bscore) return Ascore;
+    return Bscore;
+  }
+  for(int j = 0; j < COL_SIZE; j++) updateStartScore(maxScore, prevM[j], prevA[j], prevB[j]);
+  return maxScore;
+}
+
+} // namespace AffineAlignment
+} // namespace DIAlign
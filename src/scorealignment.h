@@ -0,0 +1,38 @@
+#ifndef SCOREALIGNMENT_H
+#define SCOREALIGNMENT_H
+
+#include <vector>
+#include "affinealignment.h"
+#include "constrainMat.h"
+#include "similarityMatrix.h"
+
+/**
+ * @namespace DIAlign
+ * @brief Generic namespace for all classes and functions of DIAlign
+ *
+ */
+namespace DIAlign
+{
+namespace AffineAlignment
+{
+/**
+ * @brief Calculates the score of the best affine alignment without finding its path.
+ *
+ * M, A and B are filled with fillAffineRow() using two rolling rows. Neither Traceback nor Path are kept,
+ * hence, memory is O(n_col) instead of O(n_row * n_col). The score is that of the cell from which getAffineAlignedIndices()
+ * starts its traceback, i.e. the last element of AffineAlignObj::score. For overlap alignment, the last column and the
+ * last row are searched as in getOlapAffineAlignStartIndices(); for global alignment, it is the bottom-right cell.
+ *
+ * @param s similarity score matrix. It is not modified.
+ * @param penalty Penalty added to each row of s. If NULL, s is aligned as it is.
+ * @param go gap opening penalty in alignment path.
+ * @param ge gap extension penalty in alignment path.
+ * @param OverlapAlignment If true, end gaps are not penalized.
+ * @return Score of the best alignment.
+ */
+double getAffineAlignmentScore(const SimMatrix& s, const ConstrainMatrix::NoBeefPenalty* penalty,
+                               double go, double ge, bool OverlapAlignment);
+} // namespace AffineAlignment
+} // namespace DIAlign
+
+#endif // SCOREALIGNMENT_H
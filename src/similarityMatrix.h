@@ -18,6 +18,18 @@ namespace DIAlign
     int n_col;
   };
 
+  /**
+   @brief Similarity measures between two groups of chromatograms. See SimilarityMatrix::getSimilarityMatrix().
+
+   Enumerators are named after the simType strings accepted by the R interface.
+   */
+  enum class SimilarityType {dotProductMasked, dotProduct, cosineAngle, cosine2Angle, euclideanDist, covariance, correlation, crossCorrelation, unknown};
+
+  /**
+   @brief Normalization applied to chromatograms before calculating similarity.
+   */
+  enum class NormalizationType {none, mean, L2};
+
   /**
    @brief Path matrix
 
@@ -30,6 +42,20 @@ namespace DIAlign
     int n_row;
     int n_col;
   };
+
+  /**
+   @brief Band of a similarity matrix
+
+   For each row i of an n_row x n_col similarity matrix, only the columns [start[i], end[i]) are part of the band.
+   Banded alignment fills only these cells, all other cells are treated as unreachable. See calcNoBeefBand().
+   */
+  struct SimBand
+  {
+    std::vector<int> start; ///< First column of the band in each row.
+    std::vector<int> end; ///< One past the last column of the band in each row.
+    int n_row;
+    int n_col;
+  };
 } // namespace DIAlign
 
 #endif // SIMILARITY_MATRIX_H
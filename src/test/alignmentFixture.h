@@ -0,0 +1,52 @@
+#ifndef TEST_ALIGNMENTFIXTURE_H
+#define TEST_ALIGNMENTFIXTURE_H
+
+#include <vector>
+#include <random>
+#include "../affinealignobj.h"
+#include "../affinealignment.h"
+#include "../constrainMat.h"
+#include "../similarityMatrix.h"
+
+// Helpers shared by the tests of the alignment engines. The full-matrix doAffineAlignment() is the reference for others.
+namespace AlignmentFixture
+{
+/// Similarity matrix with random scores. Integer-valued scores produce a lot of ties.
+inline DIAlign::SimMatrix randomSim(int n_row, int n_col, unsigned int seed){
+  std::mt19937 gen(seed);
+  DIAlign::SimMatrix s;
+  s.n_row = n_row;
+  s.n_col = n_col;
+  s.data.resize(n_row*n_col);
+  for(auto& v : s.data) v = (double)(gen() % 7) - 3.0;
+  return s;
+}
+
+/// Aligns s with doAffineAlignment() after penalizing it with the MASK of calcNoBeefMask2(), unless penalty is NULL.
+inline DIAlign::AffineAlignObj alignWithFull(const DIAlign::SimMatrix& s, const DIAlign::ConstrainMatrix::NoBeefPenalty* penalty,
+                                             double go, double ge, bool OverlapAlignment){
+  DIAlign::SimMatrix sc = s;
+  if(penalty){
+    DIAlign::SimMatrix MASK;
+    MASK.n_row = s.n_row;
+    MASK.n_col = s.n_col;
+    MASK.data.resize(s.n_row*s.n_col, 0.0);
+    DIAlign::ConstrainMatrix::calcNoBeefMask2(MASK, penalty->tBp, penalty->tB, penalty->tBp, penalty->noBeef,
+                                              penalty->hardConstrain);
+    DIAlign::ConstrainMatrix::constrainSimilarity(sc, MASK, penalty->constrainVal);
+  }
+  DIAlign::AffineAlignObj obj(s.n_row+1, s.n_col+1);
+  DIAlign::AffineAlignment::doAffineAlignment(obj, sc, go, ge, OverlapAlignment);
+  DIAlign::AffineAlignment::getAffineAlignedIndices(obj);
+  return obj;
+}
+
+/// True if aligned indices, cumulative scores and number of gaps of obj are the same as those of the reference.
+template<typename T>
+bool samePath(const T& obj, const DIAlign::AffineAlignObj& reference){
+  return obj.indexA_aligned == reference.indexA_aligned && obj.indexB_aligned == reference.indexB_aligned &&
+    obj.score == reference.score && obj.nGaps == reference.nGaps;
+}
+} // namespace AlignmentFixture
+
+#endif // TEST_ALIGNMENTFIXTURE_H
@@ -1,5 +1,6 @@
 #include <vector>
 #include <cmath> // require for std::abs
+#include <random>
 #include <assert.h>
 #include "../affinealignment.h"
 #include "../utils.h" //To propagate #define USE_Rcpp
@@ -440,8 +441,12 @@ namespace {
      }*/
 
     // Traceback
-    std::vector<TracebackType> traceback =  vov2v(assertThisTraceback(caseNum));
-    std::copy(traceback.begin(), traceback.end(), obj.Traceback );
+    std::vector< std::vector< TracebackType > > traceback = assertThisTraceback(caseNum);
+    for (int i = 0; i < 15; i++){
+      for (int j = 0; j < 6; j++){
+        obj.setTraceback(static_cast<tbJump>(i/5), i%5, j, traceback[i][j]);
+      }
+    }
 
     // M
     std::vector<double> M =  vov2v(assertThisM(caseNum));
@@ -463,7 +468,7 @@ void test_doAffineAlignment_cases(AffineAlignObj& obj, int caseNum){
   // Traceback
   for (int i = 0; i < 15; i++){
     for (int j = 0; j < 6; j++){
-      ASSERT(obj.Traceback[i*6+j] == cmp_arr_Traceback[i][j]);
+      ASSERT(obj.getTraceback(static_cast<tbJump>(i/5), i%5, j) == cmp_arr_Traceback[i][j]);
     }
   }
   // M
@@ -608,7 +613,7 @@ void test_getAffineAlignedIndices_cases(AffineAlignObj& obj, int caseNum){
   // Traceback
   for (int i = 0; i < 15; i++){
     for (int j = 0; j < 6; j++){
-      ASSERT(obj.Traceback[i*6+j] == cmp_arr_Traceback[i][j]);
+      ASSERT(obj.getTraceback(static_cast<tbJump>(i/5), i%5, j) == cmp_arr_Traceback[i][j]);
     }
   }
   // M
@@ -828,6 +833,132 @@ void test_getOlapAffineAlignStartIndices(){
   ASSERT(std::abs(affineAlignmentScore - 0.0) < 1e-6);
 }
 
+void test_doAffineAlignment_SIMD(){
+  // Integer-valued scores produce a lot of ties, and a few NaN leave cells untouched.
+  std::mt19937 gen(7);
+  int sizes[][2] = {{2, 2}, {4, 5}, {9, 3}, {6, 17}, {37, 41}, {64, 50}};
+  for(const auto& size : sizes){
+    SimMatrix s;
+    s.n_row = size[0];
+    s.n_col = size[1];
+    s.data.resize(s.n_row*s.n_col);
+    for(auto& v : s.data) v = (gen() % 53 == 0) ? NAN : (double)(gen() % 7) - 3.0;
+    for(bool OverlapAlignment : {true, false}){
+      for(double go : {0.0, 2.0}){
+        AffineAlignObj scalar(s.n_row+1, s.n_col+1), simd(s.n_row+1, s.n_col+1);
+        doAffineAlignment(scalar, s, go, go/4, OverlapAlignment, false);
+        doAffineAlignment(simd, s, go, go/4, OverlapAlignment, true);
+        for(int i = 0; i <= s.n_row; i++){
+          for(int j = 0; j <= s.n_col; j++){
+            int idx = i*(s.n_col+1) + j;
+            ASSERT(scalar.M[idx] == simd.M[idx] && scalar.A[idx] == simd.A[idx] && scalar.B[idx] == simd.B[idx]);
+            ASSERT(scalar.packedTraceback[idx] == simd.packedTraceback[idx]);
+          }
+        }
+        getAffineAlignedIndices(scalar);
+        getAffineAlignedIndices(simd);
+        ASSERT(scalar.indexA_aligned == simd.indexA_aligned);
+        ASSERT(scalar.indexB_aligned == simd.indexB_aligned);
+        ASSERT(scalar.score == simd.score);
+      }
+    }
+  }
+}
+
+void test_doTiledAffineAlignment(){
+  std::mt19937 gen(11);
+  SimMatrix s;
+  s.n_row = 45;
+  s.n_col = 31;
+  s.data.resize(s.n_row*s.n_col);
+  for(auto& v : s.data) v = (gen() % 53 == 0) ? NAN : (double)(gen() % 7) - 3.0;
+  for(bool OverlapAlignment : {true, false}){
+    AffineAlignObj serial(s.n_row+1, s.n_col+1);
+    doAffineAlignment(serial, s, 2.0, 0.5, OverlapAlignment, false);
+    getAffineAlignedIndices(serial);
+    for(int tileSize : {1, 4, 7, 64}){
+      for(int nThreads : {1, 3, 8}){
+        AffineAlignObj tiled(s.n_row+1, s.n_col+1);
+        doTiledAffineAlignment(tiled, s, 2.0, 0.5, OverlapAlignment, nThreads, tileSize);
+        for(int idx = 0; idx < (s.n_row+1)*(s.n_col+1); idx++){
+          ASSERT(serial.M[idx] == tiled.M[idx] && serial.A[idx] == tiled.A[idx] && serial.B[idx] == tiled.B[idx]);
+          ASSERT(serial.packedTraceback[idx] == tiled.packedTraceback[idx]);
+        }
+        getAffineAlignedIndices(tiled);
+        ASSERT(serial.indexA_aligned == tiled.indexA_aligned);
+        ASSERT(serial.indexB_aligned == tiled.indexB_aligned);
+      }
+    }
+  }
+
+  bool thrown = false;
+  try{
+    AffineAlignObj obj(s.n_row+1, s.n_col+1);
+    doTiledAffineAlignment(obj, s, 2.0, 0.5, true, 2, 0);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_getAffineAlignedIndices_output(){
+  std::mt19937 gen(5);
+  SimMatrix s;
+  s.n_row = 40;
+  s.n_col = 33;
+  s.data.resize(s.n_row*s.n_col);
+  for(auto& v : s.data) v = (double)(gen() % 11) - 4.0;
+  int ROW_SIZE = s.n_row+1, COL_SIZE = s.n_col+1;
+  for(bool OverlapAlignment : {true, false}){
+    for(int bandwidth : {0, 2, 9}){
+      AffineAlignObj heavy(ROW_SIZE, COL_SIZE);
+      doAffineAlignment(heavy, s, 3.0, 1.0, OverlapAlignment);
+      getAffineAlignedIndices(heavy, bandwidth, AlignOutput::heavy, &s);
+      // Reference: mark cells within bandwidth of path cells along their rows and columns.
+      std::vector<bool> simPath(ROW_SIZE*COL_SIZE, false);
+      for(int i = 0; i < ROW_SIZE; i++){
+        for(int j = 0; j < COL_SIZE; j++){
+          if(!heavy.Path[i*COL_SIZE+j]) continue;
+          for(int k = std::max(0, i-bandwidth); k <= std::min(ROW_SIZE-1, i+bandwidth); k++) simPath[k*COL_SIZE+j] = true;
+          for(int k = std::max(0, j-bandwidth); k <= std::min(COL_SIZE-1, j+bandwidth); k++) simPath[i*COL_SIZE+k] = true;
+        }
+      }
+      double forwardSim = 0;
+      for(int i = 0; i < s.n_row; i++){
+        for(int j = 0; j < s.n_col; j++){
+          if(simPath[(i+1)*COL_SIZE+(j+1)]) forwardSim += s.data[i*s.n_col + j];
+        }
+      }
+      ASSERT(heavy.simScore_forw == forwardSim);
+
+      for(AlignOutput output : {AlignOutput::indices, AlignOutput::light, AlignOutput::medium}){
+        AffineAlignObj obj(ROW_SIZE, COL_SIZE, true, output);
+        doAffineAlignment(obj, s, 3.0, 1.0, OverlapAlignment);
+        getAffineAlignedIndices(obj, bandwidth, output);
+        ASSERT(obj.indexA_aligned == heavy.indexA_aligned);
+        ASSERT(obj.indexB_aligned == heavy.indexB_aligned);
+        ASSERT(obj.nGaps == heavy.nGaps);
+        ASSERT(obj.simScore_forw == 0.0);
+        if(output == AlignOutput::indices) ASSERT(obj.score.empty());
+        if(output != AlignOutput::indices) ASSERT(obj.score == heavy.score);
+        if(output == AlignOutput::medium){
+          for(int idx = 0; idx < ROW_SIZE*COL_SIZE; idx++) ASSERT(obj.Path[idx] == heavy.Path[idx]);
+        }
+      }
+    }
+  }
+
+  bool thrown = false;
+  try{
+    AffineAlignObj obj(ROW_SIZE, COL_SIZE, true, AlignOutput::light);
+    doAffineAlignment(obj, s, 3.0, 1.0, true);
+    getAffineAlignedIndices(obj, 0, AlignOutput::medium);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
 #ifdef DIALIGN_USE_Rcpp
 int main_affinealignment(){
 #else
@@ -836,6 +967,9 @@ int main(){
   test_doAffineAlignment();
   test_getAffineAlignedIndices();
   test_getOlapAffineAlignStartIndices();
+  test_doAffineAlignment_SIMD();
+  test_doTiledAffineAlignment();
+  test_getAffineAlignedIndices_output();
   std::cout << "test affinealignment successful" << std::endl;
   return 0;
 }
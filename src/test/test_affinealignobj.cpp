@@ -20,12 +20,128 @@ void test_EnumToChar(){
   }
 }
 
+void test_packedTraceback(){
+  std::vector<TracebackType> tbM = {SS, DM, DA, DB};
+  std::vector<TracebackType> tbA = {TA, SS, TM, TB};
+  std::vector<TracebackType> tbB = {LB, LM, SS, LA};
+  std::vector<PackedTraceback> packed;
+  for(int k = 0; k < 4; k++){
+    packed.push_back(packTraceback(tbM[k], tbA[k], tbB[k]));
+    ASSERT(unpackTraceback(packed[k], M) == tbM[k]);
+    ASSERT(unpackTraceback(packed[k], A) == tbA[k]);
+    ASSERT(unpackTraceback(packed[k], B) == tbB[k]);
+  }
+  ASSERT(packTraceback(SS, SS, SS) == 0);
+
+  // Expanded in three blocks, same as the unpacked traceback.
+  std::vector<TracebackType> tb(tbM);
+  tb.insert(tb.end(), tbA.begin(), tbA.end());
+  tb.insert(tb.end(), tbB.begin(), tbB.end());
+  ASSERT(EnumToChar(&packed[0], 4) == EnumToChar(tb));
+
+  // Setting one matrix does not change the others.
+  AffineAlignObj obj(3, 4);
+  ASSERT(obj.getTraceback(A, 2, 3) == SS);
+  obj.setTraceback(A, 2, 3, TB);
+  obj.setTraceback(B, 2, 3, LM);
+  obj.setTraceback(M, 2, 3, DA);
+  obj.setTraceback(A, 2, 3, TM);
+  ASSERT(obj.getTraceback(M, 2, 3) == DA);
+  ASSERT(obj.getTraceback(A, 2, 3) == TM);
+  ASSERT(obj.getTraceback(B, 2, 3) == LM);
+  ASSERT(obj.getTraceback(B, 2, 2) == SS);
+  AffineAlignObj copied(3, 4);
+  copied = obj;
+  ASSERT(copied.getTraceback(B, 2, 3) == LM);
+  // Reset clears the first row and column. Other cells are overwritten by the alignment.
+  obj.setTraceback(A, 2, 0, TM);
+  obj.setTraceback(B, 0, 3, LB);
+  obj.reset(3, 4);
+  ASSERT(obj.getTraceback(A, 2, 0) == SS && obj.getTraceback(B, 0, 3) == SS);
+}
+
+void test_AlignOutput(){
+  AffineAlignObj light(4, 5, true, AlignOutput::light);
+  ASSERT(light.getOutput() == AlignOutput::light);
+  ASSERT(light.Path == NULL && light.s_data == NULL);
+  AffineAlignObj medium(4, 5, true, AlignOutput::medium);
+  ASSERT(medium.Path != NULL && medium.s_data == NULL);
+  // Reset allocates the matrices needed by output and frees others.
+  light.reset(3, 4, AlignOutput::heavy);
+  ASSERT(light.getOutput() == AlignOutput::heavy);
+  ASSERT(light.signalA_len == 2 && light.signalB_len == 3);
+  ASSERT(light.Path[11] == false && light.s_data[5] == 0.0);
+  light.reset(4, 5, AlignOutput::medium);
+  ASSERT(light.Path != NULL && light.s_data == NULL);
+  AffineAlignObj copied(medium);
+  ASSERT(copied.getOutput() == AlignOutput::medium);
+}
+
+void test_PooledAffineAlignObj(){
+  PooledAffineAlignObj::clear();
+  ASSERT(PooledAffineAlignObj::idleBytes() == 0);
+  AffineAlignObj* first;
+  {
+    PooledAffineAlignObj pooled(41, 31, AlignOutput::light);
+    first = &(*pooled);
+    ASSERT(pooled->signalA_len == 40 && pooled->signalB_len == 30);
+    ASSERT(pooled->getRowCapacity() == 65 && pooled->getColCapacity() == 65);
+    ASSERT(pooled->Path == NULL);
+    pooled->setTraceback(M, 40, 30, DA);
+    pooled->score.push_back(1.0);
+  }
+  ASSERT(PooledAffineAlignObj::idleCount() == 1);
+  ASSERT(PooledAffineAlignObj::idleBytes() == first->allocatedBytes());
+  ASSERT(first->allocatedBytes() == 65*65*(3*sizeof(double) + sizeof(PackedTraceback)));
+  {
+    // Same size-class reuses the object, first row and column and Path are reset to zero.
+    PooledAffineAlignObj pooled(50, 20, AlignOutput::medium);
+    ASSERT(&(*pooled) == first);
+    ASSERT(PooledAffineAlignObj::idleCount() == 0);
+    ASSERT(pooled->signalA_len == 49 && pooled->signalB_len == 19);
+    ASSERT(pooled->Path != NULL && pooled->score.empty());
+    ASSERT(PooledAffineAlignObj::idleBytes() == 0);
+    for(int k = 0; k < 50*20; k++) ASSERT(pooled->Path[k] == false);
+    for(int j = 0; j < 20; j++) ASSERT(pooled->packedTraceback[j] == 0 && pooled->M[j] == 0.0 && pooled->B[j] == 0.0);
+    for(int i = 0; i < 50; i++) ASSERT(pooled->packedTraceback[i*20] == 0 && pooled->A[i*20] == 0.0);
+    // Objects in use are not shared.
+    PooledAffineAlignObj other(50, 20, AlignOutput::medium);
+    ASSERT(&(*other) != first);
+    // Next size-class
+    PooledAffineAlignObj larger(70, 20);
+    ASSERT(larger->getRowCapacity() == 129 && larger->getColCapacity() == 65);
+  }
+  ASSERT(PooledAffineAlignObj::idleCount() == 3);
+  {
+    // Larger than maxPooledBytes are not kept.
+    PooledAffineAlignObj huge(3000, 2000, AlignOutput::light);
+    ASSERT(huge->getRowCapacity() == 3000 && huge->getColCapacity() == 2000);
+    ASSERT(AffineAlignObj::matrixBytes(4096, 2048) > PooledAffineAlignObj::maxPooledBytes);
+  }
+  ASSERT(PooledAffineAlignObj::idleCount() == 3);
+  std::size_t bytes = PooledAffineAlignObj::idleBytes();
+  ASSERT(PooledAffineAlignObj::clear() == bytes);
+  // Idle objects of a thread never exceed maxPooledBytes. Each of these takes about 26 MB.
+  { PooledAffineAlignObj big(1025, 1025, AlignOutput::light); }
+  { PooledAffineAlignObj big(2049, 513, AlignOutput::light); }
+  ASSERT(PooledAffineAlignObj::idleCount() == 2);
+  { PooledAffineAlignObj big(513, 2049, AlignOutput::light); }
+  ASSERT(PooledAffineAlignObj::idleCount() == 2);
+  ASSERT(PooledAffineAlignObj::idleBytes() <= PooledAffineAlignObj::maxPooledBytes);
+  bytes = PooledAffineAlignObj::idleBytes();
+  ASSERT(PooledAffineAlignObj::clear() == bytes);
+  ASSERT(PooledAffineAlignObj::idleCount() == 0 && PooledAffineAlignObj::idleBytes() == 0);
+}
+
 #ifdef DIALIGN_USE_Rcpp
 int main_affinealignobj(){
 #else
 int main(){
 #endif
   test_EnumToChar();
+  test_packedTraceback();
+  test_AlignOutput();
+  test_PooledAffineAlignObj();
   std::cout << "test affinealignobj successful" << std::endl;
   return 0;
 }
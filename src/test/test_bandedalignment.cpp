@@ -0,0 +1,197 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <assert.h>
+#include "../bandedalignment.h"
+#include "../constrainMat.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+#include "alignmentFixture.h"
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+using namespace AffineAlignment;
+using namespace ConstrainMatrix;
+using namespace Traceback;
+using namespace AlignmentFixture;
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  SimBand fullBand(int n_row, int n_col){
+    SimBand band;
+    band.n_row = n_row;
+    band.n_col = n_col;
+    band.start.assign(n_row, 0);
+    band.end.assign(n_row, n_col);
+    return band;
+  }
+
+  // Aligns s with both engines and checks that the banded cells and the path are identical.
+  void compareWithFull(const SimMatrix& s, const SimBand& band, double go, double ge, bool OverlapAlignment){
+    AffineAlignObj obj = alignWithFull(s, NULL, go, ge, OverlapAlignment);
+
+    BandedAffineAlignObj bObj(band);
+    doBandedAffineAlignment(bObj, s, go, ge, OverlapAlignment);
+    getBandedAffineAlignedIndices(bObj);
+
+    int COL_SIZE = s.n_col+1;
+    for(int i = 0; i <= s.n_row; i++){
+      for(int j = 0; j <= s.n_col; j++){
+        if(i != 0 && j != 0 && !bObj.inBand(i, j)) continue;
+        ASSERT(bObj.getScore(Traceback::M, i, j) == obj.M[i*COL_SIZE+j]);
+        ASSERT(bObj.getScore(Traceback::A, i, j) == obj.A[i*COL_SIZE+j]);
+        ASSERT(bObj.getScore(Traceback::B, i, j) == obj.B[i*COL_SIZE+j]);
+        ASSERT(bObj.getTraceback(Traceback::M, i, j) == obj.getTraceback(Traceback::M, i, j));
+        ASSERT(bObj.getTraceback(Traceback::A, i, j) == obj.getTraceback(Traceback::A, i, j));
+        ASSERT(bObj.getTraceback(Traceback::B, i, j) == obj.getTraceback(Traceback::B, i, j));
+      }
+    }
+    ASSERT(samePath(bObj, obj));
+  }
+}
+
+void test_calcNoBeefBand(){
+  std::vector<double> tB = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<double> tBp = {0.3, 1.3, 2.3, 3.3, 4.3, 5.3};
+  SimBand band;
+  calcNoBeefBand(band, tB, tBp, 1);
+  ASSERT(band.n_row == 6);
+  ASSERT(band.n_col == 10);
+  std::vector<int> start = {0, 0, 1, 2, 3, 4};
+  std::vector<int> end = {2, 3, 4, 5, 6, 10};
+  ASSERT(band.start == start);
+  ASSERT(band.end == end);
+
+  // Band must have the unpenalized cells of calcNoBeefMask2.
+  SimMatrix MASK;
+  MASK.n_row = 6;
+  MASK.n_col = 10;
+  MASK.data.resize(60, 0.0);
+  calcNoBeefMask2(MASK, tBp, tB, tBp, 1, true);
+  for(int i = 0; i < MASK.n_row; i++)
+    for(int j = 0; j < MASK.n_col; j++)
+      if(MASK.data[i*MASK.n_col + j] == 0.0) ASSERT(j >= band.start[i] && j < band.end[i]);
+
+  // Global fit outside of signal B still gives a connected band.
+  tBp = {20.0, 21.0, 22.0};
+  calcNoBeefBand(band, tB, tBp, 0);
+  start = {0, 9, 9};
+  end = {10, 10, 10};
+  ASSERT(band.start == start);
+  ASSERT(band.end == end);
+}
+
+void test_calcAnchorBand(){
+  SimMatrix s;
+  s.data = {1, 0, 0, 0, 0, 0,
+            0, 9, 0, 0, 0, 0,
+            0, 0, 2, 0, 0, 0,
+            0, 0, 0, 0, 7, 0,
+            0, 0, 0, 8, 0, 0,
+            0, 0, 0, 0, 0, 1};
+  s.n_row = 6;
+  s.n_col = 6;
+  // (3, 4) and (4, 3) are both mutual best but cannot be chained together. (4, 3) is heavier.
+  std::vector<std::pair<int, int> > anchors = getAnchorChain(s, 0.0);
+  std::vector<std::pair<int, int> > expected = {{0, 0}, {1, 1}, {2, 2}, {4, 3}, {5, 5}};
+  ASSERT(anchors == expected);
+  // Only the cells above the quantile are anchors.
+  anchors = getAnchorChain(s, 0.95);
+  expected = {{1, 1}, {4, 3}};
+  ASSERT(anchors == expected);
+  // Histogram estimate of the quantile selects the same anchors.
+  ASSERT(getAnchorChain(s, 0.95, true) == expected);
+
+  SimBand band;
+  calcAnchorBand(band, anchors, 6, 6);
+  ASSERT(band.n_row == 6 && band.n_col == 6);
+  std::vector<int> start = {0, 0, 1, 1, 1, 3};
+  std::vector<int> end = {2, 4, 4, 4, 6, 6};
+  ASSERT(band.start == start);
+  ASSERT(band.end == end);
+
+  // Without anchors, the band is the full matrix.
+  calcAnchorBand(band, std::vector<std::pair<int, int> >(), 3, 4);
+  ASSERT(band.start == std::vector<int>(3, 0));
+  ASSERT(band.end == std::vector<int>(3, 4));
+
+  bool thrown = false;
+  try{
+    getAnchorChain(s, 1.5);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_doBandedAffineAlignment(){
+  SimMatrix s;
+  s.data = {-2, -2, 10, -2, 10,
+            10, -2, -2, -2, -2,
+            -2, 10, -2, -2, -2,
+            -2, -2, -2, 10, -2};
+  s.n_row = 4;
+  s.n_col = 5;
+  // Full band reproduces doAffineAlignment.
+  compareWithFull(s, fullBand(4, 5), 22, 7, true);
+  compareWithFull(s, fullBand(4, 5), 22, 7, false);
+  compareWithFull(s, fullBand(4, 5), 0, 0, true);
+
+  for(unsigned int seed = 1; seed <= 20; seed++){
+    SimMatrix r = randomSim(15 + seed % 4, 12 + seed % 5, seed);
+    compareWithFull(r, fullBand(r.n_row, r.n_col), 2.0, 0.5, true);
+    compareWithFull(r, fullBand(r.n_row, r.n_col), 2.0, 0.5, false);
+  }
+
+  // Narrow band around the diagonal keeps in-band cells identical as long as they are not reached from outside.
+  SimMatrix d;
+  d.n_row = 30;
+  d.n_col = 30;
+  d.data.assign(30*30, -1.0);
+  for(int i = 0; i < 30; i++) d.data[i*30 + i] = 5.0;
+  std::vector<double> t(30), tp(30);
+  for(int i = 0; i < 30; i++){
+    t[i] = 10.0 + 2.0*i;
+    tp[i] = 10.1 + 2.0*i;
+  }
+  SimBand band;
+  calcNoBeefBand(band, t, tp, 2);
+  BandedAffineAlignObj bObj(band);
+  ASSERT(bObj.size() < 30*30/4);
+  ASSERT(!bObj.inBand(1, 10));
+  ASSERT(bObj.getScore(Traceback::M, 1, 10) == -std::numeric_limits<double>::infinity());
+  ASSERT(bObj.getTraceback(Traceback::M, 1, 10) == SS);
+  doBandedAffineAlignment(bObj, d, 3.0, 1.0, true);
+  getBandedAffineAlignedIndices(bObj);
+
+  AffineAlignObj obj(31, 31);
+  doAffineAlignment(obj, d, 3.0, 1.0, true);
+  getAffineAlignedIndices(obj);
+  ASSERT(bObj.indexA_aligned == obj.indexA_aligned);
+  ASSERT(bObj.indexB_aligned == obj.indexB_aligned);
+  ASSERT(bObj.score == obj.score);
+  for(int i = 0; i < 30; i++){
+    ASSERT(bObj.indexA_aligned[i] == i+1);
+    ASSERT(bObj.indexB_aligned[i] == i+1);
+  }
+
+  // Size mismatch is rejected.
+  bool thrown = false;
+  try{
+    doBandedAffineAlignment(bObj, s, 3.0, 1.0, true);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_bandedalignment(){
+#else
+int main(){
+#endif
+  test_calcNoBeefBand();
+  test_calcAnchorBand();
+  test_doBandedAffineAlignment();
+  std::cout << "test bandedalignment successful" << std::endl;
+  return 0;
+}
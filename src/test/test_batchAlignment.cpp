@@ -0,0 +1,197 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <assert.h>
+#include "../batchAlignment.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+using namespace AffineAlignment;
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // XIC group of nFrag fragment-ions with a peak at apex.
+  PreparedXICGroup peakGroup(int nFrag, double t0, int len, double apex, NormalizationType norm){
+    std::vector<std::vector<double>> time, intensity;
+    for(int k = 0; k < nFrag; k++){
+      std::vector<double> t, x;
+      for(int i = 0; i < len; i++){
+        t.push_back(t0 + 3.4*i);
+        x.push_back((k+1)*std::exp(-0.5*std::pow((t0 + 3.4*i - apex)/8.0, 2)) + 0.01*((i*7 + k) % 5));
+      }
+      time.push_back(t);
+      intensity.push_back(x);
+    }
+    return PreparedXICGroup(time, intensity, norm);
+  }
+}
+
+void test_alignXICGroups(){
+  XICAlignParams params;
+  PreparedXICGroup g = peakGroup(3, 100.0, 40, 160.0, NormalizationType::mean);
+  // A group aligned with itself follows the diagonal.
+  AlignedTimes self = alignXICGroups(g, g, "local", 20.0, std::vector<double>(), params);
+  ASSERT(self.tRef == g.xic.time);
+  ASSERT(self.tExp == g.xic.time);
+
+  // Global fit maps reference times onto the experiment run.
+  PreparedXICGroup e = peakGroup(3, 110.0, 40, 175.0, NormalizationType::mean);
+  std::vector<double> Bp(g.size());
+  for(int i = 0; i < g.size(); i++) Bp[i] = g.xic.time[i] + 15.0;
+  for(const auto& alignType : {"hybrid", "global"}){
+    AlignedTimes aligned = alignXICGroups(g, e, alignType, 20.0, Bp, params);
+    ASSERT(aligned.tRef == g.xic.time);
+    ASSERT(aligned.tExp.size() == aligned.tRef.size());
+    // Checkpointed alignment finds the same path.
+    XICAlignParams checkpointed = params;
+    checkpointed.checkpointCells = 0;
+    AlignedTimes same = alignXICGroups(g, e, alignType, 20.0, Bp, checkpointed);
+    ASSERT(same.tRef == aligned.tRef && same.tExp == aligned.tExp);
+    // Approximate quantiles change gap penalties and the mask slightly, not the path of a single peak.
+    XICAlignParams approx = params;
+    approx.approxQuantile = true;
+    AlignedTimes approxAligned = alignXICGroups(g, e, alignType, 20.0, Bp, approx);
+    ASSERT(approxAligned.tRef == aligned.tRef && approxAligned.tExp == aligned.tExp);
+  }
+
+  bool thrown = false;
+  try{
+    params.simType = SimilarityType::unknown;
+    alignXICGroups(g, e, "local", 20.0, Bp, params);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_coarseToFine(){
+  PreparedXICGroup g = peakGroup(3, 100.0, 120, 260.0, NormalizationType::mean);
+  PreparedXICGroup e = peakGroup(3, 104.0, 117, 281.0, NormalizationType::mean);
+  std::vector<double> Bp(g.size());
+  for(int i = 0; i < g.size(); i++) Bp[i] = g.xic.time[i] + 20.0;
+  for(const auto& alignType : {"local", "hybrid", "global"}){
+    XICAlignParams params;
+    AlignedTimes full = alignXICGroups(g, e, alignType, 20.0, Bp, params);
+    params.coarseFactor = 4;
+    AlignedTimes coarse = alignXICGroups(g, e, alignType, 20.0, Bp, params);
+    // The corridor around the coarse path contains the full-resolution path of smooth peaks.
+    ASSERT(coarse.tRef == full.tRef && coarse.tExp == full.tExp);
+  }
+  XICAlignParams params;
+  params.coarseFactor = 4;
+  params.corridor = 0;
+  AlignedTimes narrow = alignXICGroups(g, e, "local", 20.0, Bp, params);
+  ASSERT(narrow.tRef == g.xic.time);
+  // Groups shorter than two coarse samples are aligned at full resolution.
+  params.coarseFactor = 100;
+  AlignedTimes self = alignXICGroups(g, g, "local", 20.0, Bp, params);
+  ASSERT(self.tExp == g.xic.time);
+
+  bool thrown = false;
+  try{
+    params.coarseFactor = 0;
+    alignXICGroups(g, e, "local", 20.0, Bp, params);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_anchoredAlignment(){
+  PreparedXICGroup g = peakGroup(3, 100.0, 120, 260.0, NormalizationType::mean);
+  PreparedXICGroup e = peakGroup(3, 104.0, 117, 281.0, NormalizationType::mean);
+  std::vector<double> Bp(g.size());
+  for(int i = 0; i < g.size(); i++) Bp[i] = g.xic.time[i] + 20.0;
+  for(const auto& alignType : {"local", "hybrid", "global"}){
+    XICAlignParams params;
+    AlignedTimes full = alignXICGroups(g, e, alignType, 20.0, Bp, params);
+    params.anchorQuantile = 0.99;
+    AlignedTimes anchored = alignXICGroups(g, e, alignType, 20.0, Bp, params);
+    // Path of a single peak goes through the co-eluting apices.
+    ASSERT(anchored.tRef == full.tRef && anchored.tExp == full.tExp);
+  }
+}
+
+void test_alignXICGroupBatch(){
+  XICAlignParams params;
+  params.simType = SimilarityType::crossCorrelation;
+  PreparedXICGroup ref = peakGroup(4, 100.0, 50, 180.0, NormalizationType::L2);
+  std::vector<PreparedXICGroup> groups;
+  for(int k = 0; k < 6; k++) groups.push_back(peakGroup(4, 95.0 + 2.0*k, 50 - k, 185.0 + 3.0*k, NormalizationType::L2));
+  groups.push_back(peakGroup(3, 100.0, 50, 180.0, NormalizationType::L2)); // Number of fragment-ions differs.
+  std::vector<const PreparedXICGroup*> eXps;
+  std::vector<std::string> alignTypes;
+  std::vector<double> adaptiveRTs;
+  std::vector<std::vector<double>> Bps;
+  for(std::size_t k = 0; k < groups.size(); k++){
+    eXps.push_back(&groups[k]);
+    alignTypes.push_back(k % 3 == 0 ? "local" : "hybrid");
+    adaptiveRTs.push_back(10.0 + k);
+    std::vector<double> Bp(ref.size());
+    for(int i = 0; i < ref.size(); i++) Bp[i] = ref.xic.time[i] + 3.0*k;
+    Bps.push_back(Bp);
+  }
+  std::vector<std::string> errors1, errors4;
+  std::vector<AlignedTimes> serial = alignXICGroupBatch(ref, eXps, alignTypes, adaptiveRTs, Bps, params, 1, errors1);
+  std::vector<AlignedTimes> parallel = alignXICGroupBatch(ref, eXps, alignTypes, adaptiveRTs, Bps, params, 4, errors4);
+  ASSERT(errors1 == errors4);
+  for(std::size_t k = 0; k < groups.size() - 1; k++){
+    AlignedTimes pair = alignXICGroups(ref, groups[k], alignTypes[k], adaptiveRTs[k], Bps[k], params);
+    ASSERT(errors1[k].empty());
+    ASSERT(serial[k].tRef == pair.tRef && serial[k].tExp == pair.tExp);
+    ASSERT(parallel[k].tRef == pair.tRef && parallel[k].tExp == pair.tExp);
+  }
+  ASSERT(!errors1.back().empty());
+  ASSERT(parallel.back().tRef.empty());
+
+  bool thrown = false;
+  try{
+    alignTypes.pop_back();
+    alignXICGroupBatch(ref, eXps, alignTypes, adaptiveRTs, Bps, params, 4, errors4);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_alignXICGroupDistances(){
+  XICAlignParams params;
+  std::vector<PreparedXICGroup> groups;
+  for(int k = 0; k < 5; k++) groups.push_back(peakGroup(3, 100.0 + k, 40, 160.0 + 4.0*k, NormalizationType::mean));
+  groups.push_back(peakGroup(2, 100.0, 40, 160.0, NormalizationType::mean)); // Number of fragment-ions differs.
+  std::vector<const PreparedXICGroup*> runs;
+  for(const auto& g : groups) runs.push_back(&g);
+  std::vector<double> serial = alignXICGroupDistances(runs, params, 1);
+  std::vector<double> parallel = alignXICGroupDistances(runs, params, 3);
+  int n = groups.size();
+  ASSERT(serial.size() == (std::size_t)(n*n));
+  for(int a = 0; a < n-1; a++){
+    ASSERT(serial[a*n + a] == 0.0);
+    ASSERT(std::isnan(serial[a*n + n-1]) && std::isnan(serial[(n-1)*n + a]));
+    for(int b = 0; b < n-1; b++){
+      ASSERT(serial[a*n + b] == serial[b*n + a]);
+      ASSERT(serial[a*n + b] == parallel[a*n + b]);
+    }
+  }
+  double sAB = alignXICGroupScore(groups[0], groups[3], params);
+  double sAA = alignXICGroupScore(groups[0], groups[0], params);
+  double sBB = alignXICGroupScore(groups[3], groups[3], params);
+  ASSERT(std::abs(serial[0*n + 3] - (1.0 - sAB/std::sqrt(sAA*sBB))) < 1e-12);
+  // Farther peaks are farther runs.
+  ASSERT(serial[0*n + 1] < serial[0*n + 4]);
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_batchAlignment(){
+#else
+int main(){
+#endif
+  test_alignXICGroups();
+  test_coarseToFine();
+  test_anchoredAlignment();
+  test_alignXICGroupBatch();
+  test_alignXICGroupDistances();
+  std::cout << "test batchAlignment successful" << std::endl;
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <assert.h>
+#include "../checkpointalignment.h"
+#include "../constrainMat.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+#include "alignmentFixture.h"
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+using namespace AffineAlignment;
+using namespace ConstrainMatrix;
+using namespace AlignmentFixture;
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Aligns s with MASK and doAffineAlignment, and with checkpoints of several block sizes. Checks that the paths are identical.
+  void compareWithFull(const SimMatrix& s, const NoBeefPenalty* penalty, double go, double ge, bool OverlapAlignment){
+    AffineAlignObj obj = alignWithFull(s, penalty, go, ge, OverlapAlignment);
+
+    for(const auto& blockSize : {0, 1, 2, 3, 7, s.n_row + 5}){
+      CheckpointAffineAlignObj cObj(s.n_row+1, s.n_col+1, blockSize);
+      doCheckpointAffineAlignment(cObj, s, penalty, go, ge, OverlapAlignment);
+      getCheckpointAffineAlignedIndices(cObj, s, penalty);
+      ASSERT(samePath(cObj, obj));
+    }
+  }
+}
+
+void test_CheckpointAffineAlignObj(){
+  CheckpointAffineAlignObj obj(101, 51);
+  ASSERT(obj.blockSize == 11);
+  ASSERT(obj.checkM.size() == 10*51);
+  CheckpointAffineAlignObj obj2(101, 51, 25);
+  ASSERT(obj2.checkM.size() == 5*51);
+}
+
+void test_doCheckpointAffineAlignment(){
+  SimMatrix s;
+  s.data = {-2, -2, 10, -2, 10,
+            10, -2, -2, -2, -2,
+            -2, 10, -2, -2, -2,
+            -2, -2, -2, 10, -2};
+  s.n_row = 4;
+  s.n_col = 5;
+  compareWithFull(s, NULL, 22, 7, true);
+  compareWithFull(s, NULL, 22, 7, false);
+  compareWithFull(s, NULL, 0, 0, true);
+
+  for(unsigned int seed = 1; seed <= 20; seed++){
+    SimMatrix r = randomSim(15 + 3*seed, 12 + 2*(seed % 5), seed);
+    std::vector<double> tB(r.n_col), tBp(r.n_row);
+    for(int j = 0; j < r.n_col; j++) tB[j] = 2.0 + 3.3*j;
+    for(int i = 0; i < r.n_row; i++) tBp[i] = 1.0 + 3.3*0.8*i + 0.1*(seed % 3);
+    NoBeefPenalty hard(tB, tBp, 2, true, -2.0*3.0/1.0);
+    NoBeefPenalty soft(tB, tBp, 2, false, -2.0*3.0/7.0);
+    compareWithFull(r, NULL, 2.0, 0.5, true);
+    compareWithFull(r, NULL, 2.0, 0.5, false);
+    compareWithFull(r, &hard, 2.0, 0.5, true);
+    compareWithFull(r, &soft, 1.3, 0.7, false);
+  }
+
+  // Size mismatch is rejected.
+  bool thrown = false;
+  try{
+    CheckpointAffineAlignObj small(4, 6);
+    doCheckpointAffineAlignment(small, s, NULL, 3.0, 1.0, true);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_checkpointalignment(){
+#else
+int main(){
+#endif
+  test_CheckpointAffineAlignObj();
+  test_doCheckpointAffineAlignment();
+  std::cout << "test checkpointalignment successful" << std::endl;
+  return 0;
+}
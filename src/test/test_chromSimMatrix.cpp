@@ -249,6 +249,31 @@ void test_ElemWiseSumXcorr(){
       ASSERT(std::abs(s.data[i*s.n_col+j] - cmp_arr[i][j]) < 1e-06);
     }
   }
+
+  //........................  CASE 2 ........................................
+  // Wide kernels on rectangular matrices are compared with direct summation of the kernel.
+  d1.resize(57);
+  d2.resize(40);
+  for (std::size_t i = 0; i < d1.size(); i++) d1[i] = std::sin(0.3*i) + 1.5;
+  for (std::size_t j = 0; j < d2.size(); j++) d2[j] = std::cos(0.2*j) + 1.2;
+  s.n_row = d1.size();
+  s.n_col = d2.size();
+  for (int halfKer = 0; halfKer <= 15; halfKer++){
+    s.data.assign(s.n_row*s.n_col, 0.0);
+    ElemWiseSumXcorr(d1, d2, s, halfKer);
+    for (int i = 0; i < s.n_row; i++){
+      for (int j = 0; j < s.n_col; j++){
+        double count = 0.0, sum = 0.0;
+        for(int temp = -halfKer; temp < halfKer+1; ++temp){
+          int row = i + temp, col = j + temp;
+          if(row < 0 || col < 0 || row >= s.n_row || col >= s.n_col) continue;
+          count += 1.0;
+          sum += d1[row]*d2[col];
+        }
+        ASSERT(std::abs(s.data[i*s.n_col+j] - sum/count) < 1e-12);
+      }
+    }
+  }
 }
 
 void test_ElemWiseSumOuterProd(){
@@ -291,6 +316,26 @@ void test_ElemWiseSumOuterProd(){
   }
 }
 
+void test_BlockedSumOuterProd(){
+  // More columns than a block, so that the last block is partial.
+  int n_frag = 6, nrow = 37, ncol = 300;
+  std::vector< std::vector< double > > d1(n_frag, std::vector< double >(nrow));
+  std::vector< std::vector< double > > d2(n_frag, std::vector< double >(ncol));
+  for (int k = 0; k < n_frag; k++){
+    for (int i = 0; i < nrow; i++) d1[k][i] = std::sin(0.37*i + k) * (k+1);
+    for (int j = 0; j < ncol; j++) d2[k][j] = std::cos(0.11*j - k) / (k+1);
+  }
+  SimMatrix s, s_cmp;
+  s.n_row = s_cmp.n_row = nrow;
+  s.n_col = s_cmp.n_col = ncol;
+  s.data.resize(nrow*ncol, 0.5);
+  s_cmp.data.resize(nrow*ncol, 0.5);
+  BlockedSumOuterProd(d1, d2, s);
+  for (int k = 0; k < n_frag; k++) ElemWiseSumOuterProd(d1[k], d2[k], s_cmp);
+  // Fragment-ions are added in the same order, hence, results are identical.
+  ASSERT(s.data == s_cmp.data);
+}
+
 void test_ElemWiseSumOuterProdMeanSub(){
   std::vector< double > d1 = {1.0, 0.0, 0.5, -0.2};
   std::vector< double > d2 = {11.0, -6.0, 0.0};
@@ -928,6 +973,51 @@ void test_SumOuterCosine(){
   }
 }
 
+void test_cos2Angle(){
+  for (int k = -100; k <= 100; k++){
+    double x = k/100.0;
+    ASSERT(std::abs(cos2Angle(x) - std::cos(2*std::acos(x))) < 1e-12);
+  }
+  ASSERT(cos2Angle(1.0) == 1.0);
+  ASSERT(cos2Angle(-1.0) == 1.0);
+  ASSERT(cos2Angle(0.0) == -1.0);
+}
+
+void test_SumOuterProdMasked(){
+  int n_frag = 3, nrow = 20, ncol = 25;
+  std::vector< std::vector< double > > d1(n_frag, std::vector< double >(nrow));
+  std::vector< std::vector< double > > d2(n_frag, std::vector< double >(ncol));
+  for (int k = 0; k < n_frag; k++){
+    for (int i = 0; i < nrow; i++) d1[k][i] = 1.5 + std::sin(0.4*i + 2*k);
+    for (int j = 0; j < ncol; j++) d2[k][j] = 1.5 + std::cos(0.3*j - k);
+  }
+  double cosAngleThresh[2] = {0.3, 0.9};
+  for (int c = 0; c < 2; c++){
+    SimMatrix s, s_cmp, s2;
+    s.n_row = s_cmp.n_row = s2.n_row = nrow;
+    s.n_col = s_cmp.n_col = s2.n_col = ncol;
+    s.data.resize(nrow*ncol, 0.0);
+    s_cmp.data.resize(nrow*ncol, 0.0);
+    s2.data.resize(nrow*ncol, 0.0);
+    SumOuterProdMasked(d1, d2, "L2", s, cosAngleThresh[c], 0.5);
+
+    // Two-pass computation with a full cosine matrix and a mask.
+    SumOuterProd(d1, d2, "L2", s_cmp);
+    SumOuterCosine(d1, d2, "L2", s2);
+    double Quant = Utils::getQuantile(s_cmp.data, 0.5);
+    int nMasked = 0;
+    for (int k = 0; k < nrow*ncol; k++){
+      double cos2 = std::cos(2*std::acos(s2.data[k]));
+      double mask = (s_cmp.data[k] < Quant) ? 0.0 : 1.0;
+      mask = (mask*cos2 + (1.0-mask) > cosAngleThresh[c]) ? 1.0 : 0.0;
+      nMasked += (mask == 0.0);
+      s_cmp.data[k] = s_cmp.data[k] * mask;
+    }
+    ASSERT(s.data == s_cmp.data);
+    if (c == 1) ASSERT(nMasked > 0);
+  }
+}
+
 void test_getSimilarityMatrix(){
   std::vector< std::vector< double > > d1;
   std::vector< double > tmp;
@@ -1079,6 +1169,48 @@ void test_getSimilarityMatrix(){
   }
 }
 
+void test_getSimilarityMatrixTemplate(){
+  std::vector< std::vector< double > > d1, d2;
+  for (int k = 0; k < 3; k++){
+    std::vector< double > a(13), b(11);
+    for (std::size_t i = 0; i < a.size(); i++) a[i] = std::abs(std::sin(0.7*i + k)) + 0.1*k;
+    for (std::size_t j = 0; j < b.size(); j++) b[j] = std::abs(std::cos(0.5*j + k)) + 0.2;
+    d1.push_back(a);
+    d2.push_back(b);
+  }
+  // Scratch is shared across calls, as in a loop over many alignments.
+  NormalizationScratch scratch;
+  SimMatrix s;
+
+  getSimilarityMatrix<SimilarityType::dotProductMasked, NormalizationType::L2>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "L2", "dotProductMasked", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::dotProduct, NormalizationType::mean>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "mean", "dotProduct", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::cosineAngle, NormalizationType::none>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "none", "cosineAngle", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::cosine2Angle, NormalizationType::L2>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "L2", "cosine2Angle", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::euclideanDist, NormalizationType::mean>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "mean", "euclideanDist", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::covariance, NormalizationType::L2>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "L2", "covariance", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::correlation, NormalizationType::none>(d1, d2, s, scratch, 0.3, 0.8, 9);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "none", "correlation", 0.3, 0.8, 9).data);
+  getSimilarityMatrix<SimilarityType::crossCorrelation, NormalizationType::mean>(d1, d2, s, scratch, 0.3, 0.8, 5);
+  ASSERT(s.data == getSimilarityMatrix(d1, d2, "mean", "crossCorrelation", 0.3, 0.8, 5).data);
+  ASSERT(s.n_row == 13 && s.n_col == 11);
+
+  // Normalized values are the same as those of the copying normalizers.
+  ASSERT((normalizeVecOfVec<NormalizationType::mean>(d1, scratch.d1) == meanNormalizeVecOfVec(d1)));
+  ASSERT((normalizeVecOfVec<NormalizationType::L2>(d1, scratch.d1) == L2NormalizeVecOfVec(d1)));
+  ASSERT((&normalizeVecOfVec<NormalizationType::none>(d1, scratch.d1) == &d1));
+
+  ASSERT(getSimilarityType("crossCorrelation") == SimilarityType::crossCorrelation);
+  ASSERT(getSimilarityType("dotproduct") == SimilarityType::unknown);
+  ASSERT(getNormalizationType("L2") == NormalizationType::L2);
+  ASSERT(getNormalizationType("None") == NormalizationType::none);
+}
+
 #ifdef DIALIGN_USE_Rcpp
 int main_chromSimMatrix(){
 #else
@@ -1097,6 +1229,7 @@ int main(){
   test_divideVecOfVec();
   test_ElemWiseSumXcorr();
   test_ElemWiseSumOuterProd();
+  test_BlockedSumOuterProd();
   test_ElemWiseSumOuterProdMeanSub();
   test_ElemWiseSumOuterEucl();
   test_ElemWiseOuterCosine();
@@ -1106,7 +1239,10 @@ int main(){
   test_SumOuterCorr();
   test_SumOuterEucl();
   test_SumOuterCosine();
+  test_cos2Angle();
+  test_SumOuterProdMasked();
   test_getSimilarityMatrix();
+  test_getSimilarityMatrixTemplate();
   std::cout << "test chromSimMatrix successful" << std::endl;
   return 0;
 }
@@ -0,0 +1,136 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <cstdint>
+#include <assert.h>
+#include "../chromatogramGroup.h"
+#include "../chromSimMatrix.h"
+#include "../miscell.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+using namespace SimilarityMatrix;
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  bool isAligned(const double* p){
+    return reinterpret_cast<std::uintptr_t>(p) % ChromatogramAlignment == 0;
+  }
+}
+
+void test_ChromatogramGroup(){
+  // Fragment-ions have different time ranges, therefore, they are intersected.
+  std::vector<std::vector<double>> time = {{1, 2, 3, 4, 5, 6}, {2, 3, 4, 5, 6, 7}, {1, 2, 3, 4, 5, 6}};
+  std::vector<std::vector<double>> intensity = {{0.5, 1.0, 3.0, 2.0, 1.0, 0.2}, {1.0, 4.0, 5.0, 2.5, 0.7, 0.1},
+                                                {0.1, 0.2, 0.3, 0.4, 0.5, 0.6}};
+  ChromatogramGroup g(time, intensity);
+  ASSERT(g.nFrag == 3 && g.len == 5 && g.stride == 8);
+  ASSERT(g.intensity.size() == 24);
+  ASSERT((g.time == std::vector<double>{2, 3, 4, 5, 6}));
+  ASSERT((g.intensityVecOfVec() == std::vector<std::vector<double>>{{1.0, 3.0, 2.0, 1.0, 0.2}, {1.0, 4.0, 5.0, 2.5, 0.7},
+                                                                    {0.2, 0.3, 0.4, 0.5, 0.6}}));
+  // Every fragment-ion starts at an aligned address and is padded with zeros.
+  for(int k = 0; k < g.nFrag; k++){
+    ASSERT(isAligned(g.fragment(k)));
+    for(int i = g.len; i < g.stride; i++) ASSERT(g.fragment(k)[i] == 0.0);
+  }
+
+  ChromatogramView v = g.view();
+  ASSERT(v.time == g.time.data() && v.nFrag == 3 && v.len == 5);
+  ASSERT(v(1, 2) == 5.0);
+  ASSERT(v.fragment(2) == g.fragment(2));
+
+  // Copies own their buffer, which is aligned as well.
+  ChromatogramGroup c = g;
+  ASSERT(c.intensity.data() != g.intensity.data() && isAligned(c.intensity.data()));
+  ASSERT(c.intensityVecOfVec() == g.intensityVecOfVec());
+
+  ChromatogramGroup z(std::vector<double>(17, 1.0), 2);
+  ASSERT(z.stride == 24 && z.intensity.size() == 48);
+  ASSERT(ChromatogramGroup::paddedLength(0) == 0 && ChromatogramGroup::paddedLength(16) == 16);
+
+  // Groups without samples or without fragment-ions have an empty buffer.
+  ChromatogramGroup e(std::vector<double>(), 3);
+  ASSERT(e.stride == 0 && e.fragment(2) == e.intensity.data());
+  ASSERT(e.view().fragment(1) == e.fragment(1));
+  ASSERT(ChromatogramGroup().intensityVecOfVec().empty());
+
+  bool thrown = false;
+  try{
+    ChromatogramGroup bad(time, std::vector<std::vector<double>>(1, intensity[0]));
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_getSimilarityMatrixView(){
+  std::vector<std::vector<double>> t1, t2, i1, i2;
+  for(int k = 0; k < 4; k++){
+    std::vector<double> a, b, ia, ib;
+    for(int i = 0; i < 25; i++){
+      a.push_back(10 + i);
+      ia.push_back(std::abs(std::sin(0.3*i + k)) + 0.05*k);
+    }
+    for(int j = 0; j < 19; j++){
+      b.push_back(30 + j);
+      ib.push_back(std::abs(std::cos(0.4*j + k)) + 0.1);
+    }
+    t1.push_back(a); t2.push_back(b); i1.push_back(ia); i2.push_back(ib);
+  }
+  ChromatogramGroup g1(t1, i1), g2(t2, i2);
+  ASSERT(perSampleEucLenVecOfVec(g1.view()) == perSampleEucLenVecOfVec(i1));
+  ASSERT(perSampleMeanVecOfVec(g1.view()) == perSampleMeanVecOfVec(i1));
+  ASSERT(perSampleSumVecOfVec(g1.view()) == perSampleSumVecOfVec(i1));
+  ASSERT(perSampleSqrSumVecOfVec(g1.view()) == perSampleSqrSumVecOfVec(i1));
+  ChromatogramGroup scratch;
+  ASSERT(normalizeVecOfVec(g1.view(), NormalizationType::mean, scratch).fragment(0) == scratch.fragment(0));
+  ASSERT(scratch.intensityVecOfVec() == meanNormalizeVecOfVec(i1));
+  ASSERT(scratch.time == g1.time);
+
+  const std::vector<std::string> norms = {"none", "mean", "L2"};
+  const std::vector<std::string> sims = {"dotProductMasked", "dotProduct", "cosineAngle", "cosine2Angle", "euclideanDist",
+                                         "covariance", "correlation", "crossCorrelation"};
+  for(const auto& norm : norms){
+    for(const auto& sim : sims){
+      SimMatrix s = getSimilarityMatrix(g1.view(), g2.view(), getNormalizationType(norm), getSimilarityType(sim), 0.3, 0.9, 5);
+      SimMatrix s_cmp = getSimilarityMatrix(i1, i2, norm, sim, 0.3, 0.9, 5);
+      ASSERT(s.n_row == s_cmp.n_row);
+      ASSERT(s.n_col == s_cmp.n_col);
+      ASSERT(s.data == s_cmp.data);
+    }
+  }
+
+  bool thrown = false;
+  try{
+    ChromatogramGroup g3(std::vector<double>(19, 1.0), 3);
+    getSimilarityMatrix(g1.view(), g3.view(), NormalizationType::none, SimilarityType::dotProduct, 0.3, 0.9, 5);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_imputeChromatogramView(){
+  std::vector<double> t = {2.0, 5.0, 8.0, 11.0, 14.0, 17.0};
+  std::vector<std::vector<double>> intensity = {{0.5, 1.0, 3.0, 2.0, 1.0, 0.2}, {1.0, 4.0, 5.0, 2.5, 0.7, 0.1}};
+  ChromatogramGroup g(std::vector<std::vector<double>>(2, t), intensity);
+  std::vector<int> index = {0, 1, 2, 0, 3, 4, 0, 0, 5, 6, 0};
+  ASSERT(imputeChromatogram(g.view(), index) == imputeChromatogram(intensity, t, index));
+  std::vector<double> tnew = {-1.0, 5.0, 6.5, 8.0, 12.0, 17.0};
+  std::vector<int> tIndex = getMatchingIdx(tnew, t);
+  ASSERT(imputeChromatogram1(g.view(), tIndex, tnew) == imputeChromatogram1(intensity, tIndex, t, tnew));
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_chromatogramGroup(){
+#else
+int main(){
+#endif
+  test_ChromatogramGroup();
+  test_getSimilarityMatrixView();
+  test_imputeChromatogramView();
+  std::cout << "test chromatogramGroup successful" << std::endl;
+  return 0;
+}
@@ -242,6 +242,91 @@ void test_calcNoBeefMask2(){
 
 }
 
+void test_NoBeefLinePenalty(){
+  double A1 = 3353.2, A2 = 3363.5;
+  double B1 = 3325.9, B2 = 3339.5;
+  double B1p = 3324.7;
+  // Slope of one and a steeper global fit.
+  for(double B2p : {3336.119, 3342.5}){
+    for(int hard = 0; hard < 2; hard++){
+      SimMatrix MASK;
+      MASK.n_row = 4;
+      MASK.n_col = 5;
+      MASK.data.resize(20, 0.0);
+      calcNoBeefMask(MASK, A1, A2, B1, B2, B1p, B2p, 1, hard);
+      SimMatrix s = MASK;
+      for(int k = 0; k < 20; k++) s.data[k] = 0.3*k - 2.0;
+      SimMatrix s2 = s;
+      constrainSimilarity(s, MASK, -1.7);
+      NoBeefLinePenalty penalty(4, 5, A1, A2, B1, B1p, B2p, 1, hard, -1.7);
+      for(int i = 0; i < 4; i++){
+        for(int j = 0; j < 5; j++) ASSERT(penalty.mask(i, j) == MASK.data[i*5 + j]);
+        if(i % 2 == 0){
+          penalty.constrainRow(i, &s2.data[i*5]);
+        } else {
+          penalty.constrainRow(i, &s2.data[i*5], 0, 2);
+          penalty.constrainRow(i, &s2.data[i*5 + 2], 2, 5);
+        }
+      }
+      ASSERT(s.data == s2.data);
+    }
+  }
+}
+
+void test_unpenalizedIntervals(){
+  // Global fits whose slope is far from one. Unpenalized cells of each row are exactly the interval of the band.
+  for(double slope : {0.4, 1.0, 2.5}){
+    for(int hard = 0; hard < 2; hard++){
+      NoBeefLinePenalty penalty(30, 60, 100.0, 129.0, 90.0, 95.0, 95.0 + 29.0*slope, 3, hard, -1.0);
+      for(int i = 0; i < 30; i++){
+        ASSERT(penalty.bandStart[i] <= penalty.bandEnd[i]);
+        for(int j = 0; j < 60; j++){
+          ASSERT((penalty.mask(i, j) == 0.0) == (j >= penalty.bandStart[i] && j < penalty.bandEnd[i]));
+        }
+      }
+    }
+  }
+
+  // Slope of 1.5. Rows are mapped to columns 1, 2.5, 4, 5.5 and 7.
+  std::vector< std::vector< double > > cmp_arr;
+  cmp_arr.push_back({0, 0, 0, 1, 1, 1, 1, 1, 1, 1});
+  cmp_arr.push_back({1, 1, 0, 0, 1, 1, 1, 1, 1, 1});
+  cmp_arr.push_back({1, 1, 1, 0, 0, 0, 1, 1, 1, 1});
+  cmp_arr.push_back({1, 1, 1, 1, 1, 0, 0, 1, 1, 1});
+  cmp_arr.push_back({1, 1, 1, 1, 1, 1, 0, 0, 0, 1});
+  NoBeefLinePenalty steep(5, 10, 0.0, 4.0, 0.0, 0.5, 6.5, 1, true, -1.0);
+  for(int i = 0; i < 5; i++)
+    for(int j = 0; j < 10; j++) ASSERT(steep.mask(i, j) == cmp_arr[i][j]);
+  NoBeefLinePenalty steepSoft(5, 10, 0.0, 4.0, 0.0, 0.5, 6.5, 1, false, -1.0);
+  ASSERT(std::abs(steepSoft.mask(1, 1) - 0.5/std::sqrt(3.25)) < 1e-12);
+  ASSERT(std::abs(steepSoft.mask(1, 4) - 0.5/std::sqrt(3.25)) < 1e-12);
+
+  // B1p and B2p less than a sample apart.
+  NoBeefLinePenalty flat(5, 10, 0.0, 4.0, 0.0, 3.0, 3.0, 1, true, -1.0);
+  ASSERT(flat.mask(0, 4) == 0.0 && flat.mask(4, 3) == 0.0);
+  ASSERT(flat.mask(0, 2) == 1.0 && flat.mask(4, 5) == 1.0);
+
+  // Non-linear monotone mapping, and a mapping that is not monotone.
+  std::vector<double> tB;
+  for(int j = 0; j < 50; j++) tB.push_back(10.0 + 2.0*j);
+  std::vector<double> curved, unsorted;
+  for(int i = 0; i < 40; i++){
+    curved.push_back(2.0 + 0.08*i*i);
+    unsorted.push_back(60.0 + 30.0*std::sin(0.3*i));
+  }
+  unsorted[5] = NAN;
+  for(const auto& tBp : {curved, unsorted}){
+    for(int hard = 0; hard < 2; hard++){
+      NoBeefPenalty penalty(tB, tBp, 2, hard, -1.0);
+      for(int i = 0; i < 40; i++){
+        for(int j = 0; j < 50; j++){
+          ASSERT((penalty.mask(i, j) == 0.0) == (j >= penalty.bandStart[i] && j < penalty.bandEnd[i]));
+        }
+      }
+    }
+  }
+}
+
 #ifdef DIALIGN_USE_Rcpp
 int main_constrainMat(){
 #else
@@ -250,6 +335,8 @@ int main(){
   test_calcNoBeefMask();
   test_constrainSimilarity();
   test_calcNoBeefMask2();
+  test_NoBeefLinePenalty();
+  test_unpenalizedIntervals();
   std::cout << "test constrainMat successful" << std::endl;
   return 0;
 }
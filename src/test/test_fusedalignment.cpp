@@ -0,0 +1,131 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <assert.h>
+#include "../fusedalignment.h"
+#include "../constrainMat.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+#include "alignmentFixture.h"
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+using namespace AffineAlignment;
+using namespace ConstrainMatrix;
+using namespace Traceback;
+using namespace AlignmentFixture;
+
+// Anonymous namespace: Only valid for this file.
+namespace {
+  // Aligns s with MASK and doAffineAlignment, and with the fused engine. Checks that Traceback and the path are identical.
+  void compareWithFull(const SimMatrix& s, const NoBeefPenalty* penalty, double go, double ge, bool OverlapAlignment){
+    AffineAlignObj obj = alignWithFull(s, penalty, go, ge, OverlapAlignment);
+
+    FusedAffineAlignObj fObj(s.n_row+1, s.n_col+1);
+    doFusedAffineAlignment(fObj, s, penalty, go, ge, OverlapAlignment);
+    getFusedAffineAlignedIndices(fObj, s, penalty);
+
+    int ROW_SIZE = s.n_row+1, COL_SIZE = s.n_col+1;
+    ASSERT(fObj.packedTraceback.size() == (std::size_t)ROW_SIZE*COL_SIZE);
+    for(int k = 0; k < ROW_SIZE*COL_SIZE; k++) ASSERT(fObj.packedTraceback[k] == obj.packedTraceback[k]);
+    for(int i = 0; i < ROW_SIZE; i++){
+      ASSERT(fObj.lastColM[i] == obj.M[i*COL_SIZE + COL_SIZE-1]);
+      ASSERT(fObj.lastColA[i] == obj.A[i*COL_SIZE + COL_SIZE-1]);
+      ASSERT(fObj.lastColB[i] == obj.B[i*COL_SIZE + COL_SIZE-1]);
+    }
+    for(int j = 0; j < COL_SIZE; j++){
+      ASSERT(fObj.lastRowM[j] == obj.M[(ROW_SIZE-1)*COL_SIZE + j]);
+      ASSERT(fObj.lastRowA[j] == obj.A[(ROW_SIZE-1)*COL_SIZE + j]);
+      ASSERT(fObj.lastRowB[j] == obj.B[(ROW_SIZE-1)*COL_SIZE + j]);
+    }
+    ASSERT(samePath(fObj, obj));
+  }
+}
+
+void test_NoBeefPenalty(){
+  std::vector<double> tB = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<double> tBp = {0.3, 1.3, 2.3, 3.3, 4.6, 5.3};
+  for(int hard = 0; hard < 2; hard++){
+    SimMatrix MASK;
+    MASK.n_row = 6;
+    MASK.n_col = 10;
+    MASK.data.resize(60, 0.0);
+    calcNoBeefMask2(MASK, tBp, tB, tBp, 1, hard);
+    NoBeefPenalty penalty(tB, tBp, 1, hard, -2.5);
+    ASSERT(penalty.deltaTime == 1.0);
+    SimMatrix s;
+    s.n_row = 6;
+    s.n_col = 10;
+    s.data.resize(60);
+    for(int k = 0; k < 60; k++) s.data[k] = 0.1*k;
+    std::vector<double> row(10);
+    for(int i = 0; i < 6; i++){
+      for(int j = 0; j < 10; j++){
+        ASSERT(penalty.mask(i, j) == MASK.data[i*10 + j]);
+        // Only the cells between bandStart and bandEnd are unpenalized.
+        ASSERT((MASK.data[i*10 + j] == 0.0) == (j >= penalty.bandStart[i] && j < penalty.bandEnd[i]));
+        row[j] = s.data[i*10 + j];
+      }
+      if(i % 2 == 0){
+        penalty.constrainRow(i, &row[0]);
+      } else {
+        // Partial rows that start or end inside of the unpenalized columns.
+        penalty.constrainRow(i, &row[0], 0, 3);
+        penalty.constrainRow(i, &row[3], 3, 10);
+      }
+      for(int j = 0; j < 10; j++) s.data[i*10 + j] = row[j];
+    }
+    SimMatrix s2 = s;
+    for(int k = 0; k < 60; k++) s2.data[k] = 0.1*k;
+    constrainSimilarity(s2, MASK, -2.5);
+    ASSERT(s.data == s2.data);
+  }
+}
+
+void test_doFusedAffineAlignment(){
+  SimMatrix s;
+  s.data = {-2, -2, 10, -2, 10,
+            10, -2, -2, -2, -2,
+            -2, 10, -2, -2, -2,
+            -2, -2, -2, 10, -2};
+  s.n_row = 4;
+  s.n_col = 5;
+  compareWithFull(s, NULL, 22, 7, true);
+  compareWithFull(s, NULL, 22, 7, false);
+  compareWithFull(s, NULL, 0, 0, true);
+
+  for(unsigned int seed = 1; seed <= 20; seed++){
+    SimMatrix r = randomSim(15 + seed % 4, 12 + seed % 5, seed);
+    std::vector<double> tB(r.n_col), tBp(r.n_row);
+    for(int j = 0; j < r.n_col; j++) tB[j] = 2.0 + 3.3*j;
+    for(int i = 0; i < r.n_row; i++) tBp[i] = 1.0 + 3.3*0.8*i + 0.1*(seed % 3);
+    NoBeefPenalty hard(tB, tBp, 2, true, -2.0*3.0/1.0);
+    NoBeefPenalty soft(tB, tBp, 2, false, -2.0*3.0/7.0);
+    compareWithFull(r, NULL, 2.0, 0.5, true);
+    compareWithFull(r, NULL, 2.0, 0.5, false);
+    compareWithFull(r, &hard, 2.0, 0.5, true);
+    compareWithFull(r, &hard, 2.0, 0.5, false);
+    compareWithFull(r, &soft, 1.3, 0.7, true);
+    compareWithFull(r, &soft, 1.3, 0.7, false);
+  }
+
+  // Size mismatch is rejected.
+  bool thrown = false;
+  try{
+    FusedAffineAlignObj small(4, 6);
+    doFusedAffineAlignment(small, s, NULL, 3.0, 1.0, true);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_fusedalignment(){
+#else
+int main(){
+#endif
+  test_NoBeefPenalty();
+  test_doFusedAffineAlignment();
+  std::cout << "test fusedalignment successful" << std::endl;
+  return 0;
+}
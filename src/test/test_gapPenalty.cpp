@@ -45,6 +45,12 @@ void test_getGapPenalty(){
   // TODO How to check this case?
   //ASSERT(std::abs(gNONE50 - 0.0) < 1e-6);
 
+  // Approximate quantile is within (max - min)/1024 of the exact one.
+  double range = 6.85511916 + 6.77245762;
+  ASSERT(std::abs(getGapPenalty(s, 0.7, SimilarityType::dotProductMasked, true) - gPM70) <= range/1024);
+  ASSERT(std::abs(getGapPenalty(s, 0.9, SimilarityType::covariance, true) - gCOV90) <= range/1024);
+  ASSERT(getGapPenalty(s, 0.75, SimilarityType::cosineAngle, true) == gCA75);
+
   std::fill(s.data.begin(), s.data.end(), 0.0);
   gPM70 = getGapPenalty(s, 0.7, "dotProductMasked");
   gP80 = getGapPenalty(s, 0.8, "dotProduct");
@@ -99,6 +105,10 @@ void test_getGapPenalty(){
   ASSERT(std::abs(gED20 - 0.01) < 1e-6);
   ASSERT(std::abs(gCOV90 - 0.3622603) < 1e-6);
   ASSERT(std::abs(gCOR95 - 1.8472916) < 1e-6);
+
+  ASSERT(getGapPenalty(s, 0.95, SimilarityType::correlation) == gCOR95);
+  ASSERT(getGapPenalty(s, 0.75, SimilarityType::cosineAngle) == gCA75);
+  ASSERT(getGapPenalty(s, 0.5, SimilarityType::unknown) == 0.01);
   // TODO How to check this case?
   //ASSERT(std::abs(gNONE50 - 0.0) < 1e-6);
 }
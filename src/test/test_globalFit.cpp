@@ -0,0 +1,140 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <assert.h>
+#include "../globalFit.h"
+#include "../spline.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+
+void test_linearFit(){
+  GlobalFit fit(5.0, 1.5);
+  ASSERT(fit.type == GlobalFitType::linear);
+  ASSERT(fit.predict(10.0) == 20.0);
+  ASSERT((fit.predict(std::vector<double>{0.0, 2.0, -4.0}) == std::vector<double>{5.0, 8.0, -1.0}));
+  ASSERT(getGlobalFitType("spline") == GlobalFitType::spline);
+}
+
+void test_loessFit(){
+  // Same as stats::approxfun(x, y, ties = mean).
+  std::vector<double> x = {4.0, 1.0, 2.0, 2.0, NAN, 6.0};
+  std::vector<double> y = {7.0, 1.0, 2.0, 4.0, 3.0, 11.0};
+  GlobalFit fit(x, y, GlobalFitType::loess);
+  ASSERT((fit.x == std::vector<double>{1.0, 2.0, 4.0, 6.0}));
+  ASSERT((fit.y == std::vector<double>{1.0, 3.0, 7.0, 11.0}));
+  ASSERT(fit.predict(1.0) == 1.0);
+  ASSERT(fit.predict(1.5) == 2.0);
+  ASSERT(fit.predict(2.0) == 3.0);
+  ASSERT(fit.predict(5.0) == 9.0);
+  ASSERT(fit.predict(6.0) == 11.0);
+  ASSERT(std::isnan(fit.predict(0.5)));
+  ASSERT(std::isnan(fit.predict(6.5)));
+
+  bool thrown = false;
+  try{
+    GlobalFit single(std::vector<double>{3.0, 3.0}, std::vector<double>{1.0, 2.0}, GlobalFitType::loess);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_splineFit(){
+  std::vector<double> x = {1.0, 2.5, 3.0, 5.0, 7.5, 9.0};
+  std::vector<double> y = {2.0, 3.1, 4.5, 4.9, 8.0, 8.4};
+  GlobalFit fit(x, y, GlobalFitType::spline);
+  std::vector<double> t = {1.0, 1.7, 2.5, 2.9, 4.2, 6.0, 8.8, 9.0};
+  std::vector<double> expected = naturalSpline(x, y, t);
+  std::vector<double> predicted = fit.predict(t);
+  for(std::size_t i = 0; i < t.size(); i++) ASSERT(std::abs(predicted[i] - expected[i]) < 1e-10);
+  // Natural spline of two knots is a straight line.
+  GlobalFit line(std::vector<double>{0.0, 10.0}, std::vector<double>{5.0, 25.0}, GlobalFitType::spline);
+  ASSERT(std::abs(line.predict(2.5) - 10.0) < 1e-12);
+}
+
+void test_getMappedTimes(){
+  GlobalFit fit(std::vector<double>{10.0, 20.0, 30.0}, std::vector<double>{15.0, 30.0, 35.0}, GlobalFitType::loess);
+  std::vector<double> tExp = {12.0, 14.0, 16.0, 18.0};
+  ASSERT((getMappedTimes(fit, {10.0, 15.0, 25.0}, tExp) == std::vector<double>{15.0, 22.5, 32.5}));
+  // Outside the knots, experiment times are equally spaced as seq(12, 18, length.out = 4).
+  ASSERT((getMappedTimes(fit, {5.0, 15.0, 25.0, 35.0}, tExp) == std::vector<double>{12.0, 14.0, 16.0, 18.0}));
+  // Non-positive times are invalid as well.
+  GlobalFit shift(-20.0, 1.0);
+  ASSERT((getMappedTimes(shift, {10.0, 25.0}, tExp) == std::vector<double>{12.0, 18.0}));
+  ASSERT((getMappedTimes(shift, {10.0}, tExp) == std::vector<double>{12.0}));
+}
+
+void test_lowess(){
+  // Same as lowess(cars) in R.
+  std::vector<double> speed = {4, 4, 7, 7, 8, 9, 10, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15,
+                               15, 16, 16, 17, 17, 17, 18, 18, 18, 18, 19, 19, 19, 20, 20, 20, 20, 20, 22, 23, 24, 24, 24, 24, 25};
+  std::vector<double> dist = {2, 10, 4, 22, 16, 10, 18, 26, 34, 17, 28, 14, 20, 24, 28, 26, 34, 34, 46, 26, 36, 60, 80, 20, 26,
+                              54, 32, 40, 32, 40, 50, 42, 56, 76, 84, 36, 46, 68, 32, 48, 52, 56, 64, 66, 54, 70, 92, 93, 120, 85};
+  std::vector<double> expected = {4.965459, 4.965459, 13.124495, 13.124495, 15.858633, 18.579691, 21.280313, 21.280313,
+                                  21.280313, 24.129277, 24.129277, 27.119549, 27.119549, 27.119549, 27.119549, 30.027276,
+                                  30.027276, 30.027276, 30.027276, 32.962506, 32.962506, 32.962506, 32.962506, 36.757728,
+                                  36.757728, 36.757728, 40.435075, 40.435075, 43.463492, 43.463492, 43.463492, 46.885479,
+                                  46.885479, 46.885479, 46.885479, 50.793152, 50.793152, 50.793152, 56.491224, 56.491224,
+                                  56.491224, 56.491224, 56.491224, 67.585824, 73.079695, 78.643164, 78.643164, 78.643164,
+                                  78.643164, 84.328698};
+  std::vector<double> outData = lowess(speed, dist, 2.0/3.0, 3, 0.01*(25 - 4));
+  for(std::size_t i = 0; i < speed.size(); i++) ASSERT(std::abs(outData[i] - expected[i]) < 1e-6);
+
+  // Unsorted pairs are sorted by reference time.
+  std::vector<double> RTref(speed.rbegin(), speed.rend()), RTeXp(dist.rbegin(), dist.rend());
+  LoessFit fit = getLOESSfit(RTref, RTeXp, 2.0/3.0);
+  ASSERT(fit.x == speed);
+  for(std::size_t i = 0; i < speed.size(); i++) ASSERT(std::abs(fit.y[i] - expected[i]) < 1e-6);
+  GlobalFit interpolated(fit.x, fit.y, GlobalFitType::loess);
+  double sum = 0.0;
+  for(std::size_t i = 0; i < speed.size(); i++) sum += std::pow(dist[i] - interpolated.predict(speed[i]), 2);
+  ASSERT(std::abs(fit.RSE - std::sqrt(sum/48)) < 1e-12);
+  ASSERT(std::isnan(getLOESSfit({1.0, 2.0}, {3.0, 4.0}, 0.5).RSE));
+}
+
+void test_getLOESSfits(){
+  std::vector<std::vector<double>> RTrefs, RTeXps;
+  for(int k = 0; k < 7; k++){
+    std::vector<double> ref, eXp;
+    for(int i = 0; i < 200 + 10*k; i++){
+      ref.push_back(1000.0 + 17.0*((i*37) % (200 + 10*k)));
+      eXp.push_back(1.05*ref.back() + 30.0*std::sin(ref.back()/500.0) + ((i*13 + k) % 7));
+    }
+    RTrefs.push_back(ref);
+    RTeXps.push_back(eXp);
+  }
+  std::vector<LoessFit> serial = getLOESSfits(RTrefs, RTeXps, 0.1, 1);
+  std::vector<LoessFit> parallel = getLOESSfits(RTrefs, RTeXps, 0.1, 4);
+  for(std::size_t k = 0; k < RTrefs.size(); k++){
+    LoessFit fit = getLOESSfit(RTrefs[k], RTeXps[k], 0.1);
+    ASSERT(serial[k].x == fit.x && serial[k].y == fit.y && serial[k].RSE == fit.RSE);
+    ASSERT(parallel[k].x == fit.x && parallel[k].y == fit.y && parallel[k].RSE == fit.RSE);
+    ASSERT(fit.RSE < 5.0);
+  }
+
+  bool thrown = false;
+  try{
+    RTeXps.pop_back();
+    getLOESSfits(RTrefs, RTeXps, 0.1, 4);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_globalFit(){
+#else
+int main(){
+#endif
+  test_linearFit();
+  test_loessFit();
+  test_splineFit();
+  test_getMappedTimes();
+  test_lowess();
+  test_getLOESSfits();
+  std::cout << "test globalFit successful" << std::endl;
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <vector>
+#include <cmath> // require for std::abs
+#include <assert.h>
+#include "../preparedXICGroup.h"
+#include "../miscell.h"
+#include "../utils.h" //To propagate #define USE_Rcpp
+
+#define ASSERT(condition) if(!(condition)) {std::cout << "FAILED ON LINE " << __LINE__ << std::endl; throw 1;} // If you don't put the message, C++ will output the code.
+
+using namespace DIAlign;
+using namespace SimilarityMatrix;
+
+void test_PreparedXICGroup(){
+  // Fragment-ions have different time ranges, therefore, they are intersected.
+  std::vector<std::vector<double>> time = {{1, 2, 3, 4, 5, 6}, {2, 3, 4, 5, 6, 7}};
+  std::vector<std::vector<double>> intensity = {{0.5, 1.0, 3.0, 2.0, 1.0, 0.2}, {1.0, 4.0, 5.0, 2.5, 0.7, 0.1}};
+  PreparedXICGroup g(time, intensity, NormalizationType::L2);
+  ASSERT(g.size() == 5);
+  ASSERT((g.xic.time == std::vector<double>{2, 3, 4, 5, 6}));
+  std::vector<std::vector<double>> vov = g.xic.intensityVecOfVec();
+  ASSERT((vov[0] == std::vector<double>{1.0, 3.0, 2.0, 1.0, 0.2}));
+  ASSERT((vov[1] == std::vector<double>{1.0, 4.0, 5.0, 2.5, 0.7}));
+  ASSERT(g.normalized.intensityVecOfVec() == L2NormalizeVecOfVec(vov));
+  ASSERT(g.eucLen == perSampleEucLenVecOfVec(g.normalizedIntensity()));
+  ASSERT(g.mean == perSampleMeanVecOfVec(g.normalizedIntensity()));
+
+  PreparedXICGroup n(time, intensity, NormalizationType::none);
+  ASSERT(n.normalized.nFrag == 0);
+  ASSERT(n.normalizedIntensity().intensity == n.xic.intensity.data());
+
+  bool thrown = false;
+  try{
+    PreparedXICGroup bad(time, std::vector<std::vector<double>>(1, intensity[0]), NormalizationType::none);
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void test_getSimilarityMatrixPrepared(){
+  std::vector<std::vector<double>> t1, t2, i1, i2;
+  for(int k = 0; k < 4; k++){
+    std::vector<double> a, b, ia, ib;
+    for(int i = 0; i < 25; i++){
+      a.push_back(10 + i + k%2);
+      ia.push_back(std::abs(std::sin(0.3*i + k)) + 0.05*k);
+    }
+    for(int j = 0; j < 19; j++){
+      b.push_back(30 + j);
+      ib.push_back(std::abs(std::cos(0.4*j + k)) + 0.1);
+    }
+    t1.push_back(a); t2.push_back(b); i1.push_back(ia); i2.push_back(ib);
+  }
+  const std::vector<std::string> norms = {"none", "mean", "L2"};
+  const std::vector<std::string> sims = {"dotProductMasked", "dotProduct", "cosineAngle", "cosine2Angle", "euclideanDist",
+                                         "covariance", "correlation", "crossCorrelation"};
+  for(const auto& norm : norms){
+    PreparedXICGroup g1(t1, i1, getNormalizationType(norm));
+    PreparedXICGroup g2(t2, i2, getNormalizationType(norm));
+    for(const auto& sim : sims){
+      SimMatrix s = getSimilarityMatrix(g1, g2, getSimilarityType(sim), 0.3, 0.9, 5);
+      SimMatrix s_cmp = getSimilarityMatrix(g1.xic.intensityVecOfVec(), g2.xic.intensityVecOfVec(), norm, sim, 0.3, 0.9, 5);
+      ASSERT(s.n_row == s_cmp.n_row);
+      ASSERT(s.n_col == s_cmp.n_col);
+      ASSERT(s.data == s_cmp.data);
+    }
+  }
+}
+
+#ifdef DIALIGN_USE_Rcpp
+int main_preparedXICGroup(){
+#else
+int main(){
+#endif
+  test_PreparedXICGroup();
+  test_getSimilarityMatrixPrepared();
+  std::cout << "test preparedXICGroup successful" << std::endl;
+  return 0;
+}
@@ -1,6 +1,8 @@
 #include <vector>
 #include <cmath> // require for std::abs
 #include <assert.h>
+#include <algorithm>
+#include <stdexcept>
 #include "../utils.h"
 
 //TODO update this statement so we know which line failed.
@@ -57,12 +59,69 @@ void test_getQuantile(){
   ASSERT(std::abs(q95 - 0.0) < 1e-6);
 }
 
+void test_getQuantileSkewed(){
+  std::vector<double> vec;
+  // Skewed values: most values are in the first bin of the histogram.
+  for(int i = 0; i < 5000; i++) vec.push_back(std::exp(0.01*((i*7919) % 5000)) - 1.0);
+  vec[10] = 3.0; vec[11] = 3.0; vec[12] = 3.0; // ties
+  std::vector<double> p = {0.0, 0.001, 0.1, 0.25, 0.5, 0.75, 0.95, 0.999, 1.0};
+  std::vector<double> sorted = vec;
+  std::sort(sorted.begin(), sorted.end());
+  int n = vec.size();
+  for(std::size_t k = 0; k < p.size(); k++){
+    double q = getQuantile(vec, p[k]);
+    double h = (n-1)*p[k];
+    int lo = floor(h);
+    int hi = std::min(lo+1, n-1);
+    ASSERT(std::abs(q - (sorted[lo] + (h - lo)*(sorted[hi] - sorted[lo]))) < 1e-9);
+  }
+  std::vector<double> single = {2.5};
+  ASSERT(getQuantile(single, 0.3) == 2.5);
+}
+
+void test_getApproxQuantile(){
+  std::vector<double> vec;
+  for(int i = 0; i < 5000; i++) vec.push_back(std::exp(0.01*((i*7919) % 5000)) - 1.0);
+  double width = *std::max_element(vec.begin(), vec.end()) - *std::min_element(vec.begin(), vec.end());
+  std::vector<double> p = {0.0, 0.1, 0.25, 0.5, 0.75, 0.95, 0.999, 1.0};
+  for(const auto& nBins : {16, 1024}){
+    for(const auto& pk : p){
+      double approx = getApproxQuantile(vec, pk, nBins);
+      ASSERT(std::abs(approx - getQuantile(vec, pk)) <= width/nBins);
+    }
+  }
+  // Constant vector falls back to exact quantile.
+  std::vector<double> zeros(100, 0.0);
+  ASSERT(getApproxQuantile(zeros, 0.5) == 0.0);
+}
+
+void test_parallelFor(){
+  for(const auto& nThreads : {1, 4}){
+    std::vector<int> visited(100, 0);
+    parallelFor(100, nThreads, [&](int i){ visited[i] += i; });
+    for(int i = 0; i < 100; i++) ASSERT(visited[i] == i);
+  }
+  parallelFor(0, 4, [&](int i){ throw 1; });
+
+  // First exception is rethrown on the calling thread.
+  bool thrown = false;
+  try{
+    parallelFor(10, 3, [&](int i){ if(i == 5) throw std::invalid_argument("task"); });
+  } catch(std::invalid_argument& e){
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
 #ifdef DIALIGN_USE_Rcpp
 int main_utils(){
 #else
 int main(){
 #endif
   test_getQuantile();
+  test_getQuantileSkewed();
+  test_getApproxQuantile();
+  test_parallelFor();
   std::cout << "test utils successful" << std::endl;
   return 0;
 }
@@ -3,6 +3,13 @@
 #include <iostream>
 #include <iomanip>
 #include <functional>
+#include <numeric>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 #include "utils.h"
 
@@ -11,50 +18,184 @@ namespace DIAlign
 namespace Utils
 {
 
-#if 1
-double getQuantile(std::vector<double> vec, double quantile){
+namespace {
+  // Type 7 definition as implemented in R. Quantile is interpolated between ascending order statistics j-1 and j (0-based).
+  void getQuantileRank(int n, double p, int& j, double& gamma){
+    double m = 1-p;
+    j = floor(n*p + m);
+    gamma = n*p + m - j;
+  }
+
+  // Both branches keep the floating-point operations of the former nth_element implementation.
+  double interpolateQuantile(double p, double gamma, double lower, double upper){
+    double sampleQuant;
+    if (p <= 0.5){
+      sampleQuant = gamma*upper;
+      sampleQuant = sampleQuant + (1.0 - gamma)*lower;
+    }
+    else {
+      sampleQuant = (1.0-gamma)*lower;
+      sampleQuant = sampleQuant + gamma*upper;
+    }
+    return sampleQuant;
+  }
+
+  // Finds minimum and maximum of vec. Returns false if vec has non-finite values.
+  bool getRange(const std::vector<double>& vec, double& minVal, double& maxVal){
+    minVal = std::numeric_limits<double>::infinity();
+    maxVal = -std::numeric_limits<double>::infinity();
+    bool finite = true;
+    for(const auto& x : vec){
+      finite = finite && std::isfinite(x);
+      minVal = (x < minVal) ? x : minVal;
+      maxVal = (x > maxVal) ? x : maxVal;
+    }
+    return finite;
+  }
+
+  // Maps values to nBins equally wide bins between minVal and maxVal. Mapping is monotone, hence, bins are ordered.
+  struct Histogram {
+    double minVal;
+    double scale;
+    int nBins;
+    std::vector<int> cumCount; ///< Number of values in the bins before bin b. Last element is the total number of values.
+
+    Histogram(const std::vector<double>& vec, double minVal, double maxVal, int nBins):
+      minVal(minVal), scale(nBins/(maxVal - minVal)), nBins(nBins), cumCount(nBins+1, 0) {
+      for(const auto& x : vec) cumCount[bin(x)+1]++;
+      std::partial_sum(cumCount.begin(), cumCount.end(), cumCount.begin());
+    }
+
+    int bin(double x) const {
+      double b = (x - minVal)*scale;
+      return (b < nBins) ? (int)b : nBins-1;
+    }
+
+    // Bin that has the value of the given ascending rank.
+    int binOfRank(int rank) const {
+      return std::upper_bound(cumCount.begin(), cumCount.end(), rank) - cumCount.begin() - 1;
+    }
+  };
+
+  // Exact order statistics for ascending ranks. Only the values in the bins of the requested ranks are copied.
+  std::vector<double> selectRanks(const std::vector<double>& vec, const std::vector<int>& ranks){
+    std::vector<double> values(ranks.size());
+    double minVal, maxVal;
+    const int nBins = 1024;
+    bool finite = getRange(vec, minVal, maxVal);
+    double width = maxVal - minVal;
+    if(!finite || !(width > 0.0) || !std::isfinite(nBins/width)){
+      // Histogram cannot be built. Select on a copy of vec.
+      std::vector<double> v = vec;
+      for(std::size_t k = 0; k < ranks.size(); k++){
+        std::nth_element(v.begin(), v.begin()+ranks[k], v.end(), std::less<double>());
+        values[k] = v[ranks[k]];
+      }
+      return values;
+    }
+    Histogram hist(vec, minVal, maxVal, nBins);
+    std::vector<int> slot(nBins, -1);
+    std::vector<std::vector<double>> buffers;
+    for(const auto& r : ranks){
+      int b = hist.binOfRank(r);
+      if(slot[b] < 0){
+        slot[b] = buffers.size();
+        buffers.push_back(std::vector<double>());
+        buffers.back().reserve(hist.cumCount[b+1] - hist.cumCount[b]);
+      }
+    }
+    for(const auto& x : vec){
+      int s = slot[hist.bin(x)];
+      if(s >= 0) buffers[s].push_back(x);
+    }
+    for(std::size_t k = 0; k < ranks.size(); k++){
+      int b = hist.binOfRank(ranks[k]);
+      std::vector<double>& buf = buffers[slot[b]];
+      int idx = ranks[k] - hist.cumCount[b];
+      std::nth_element(buf.begin(), buf.begin()+idx, buf.end(), std::less<double>());
+      values[k] = buf[idx];
+    }
+    return values;
+  }
+}
+
+double getQuantile(const std::vector<double>& vec, double quantile){
+  int n = vec.size();
+  if(n == 0) return std::numeric_limits<double>::quiet_NaN();
+  int j;
+  double gamma;
+  getQuantileRank(n, quantile, j, gamma);
+  std::vector<int> ranks = {std::max(j-1, 0), std::min(j, n-1)};
+  std::vector<double> values = selectRanks(vec, ranks);
+  return interpolateQuantile(quantile, gamma, values[0], values[1]);
+}
+
+double getApproxQuantile(const std::vector<double>& vec, double quantile, int nBins){
   int n = vec.size();
-  double p = quantile;
-  double m = 1-p; // Type 7 definition as implemented in R.
-  int j = floor(n*p + m);
-  double g = n*p + m - j;
-  double gamma = g;
-
-  // sort(vec.begin(), vec.end()); This algorithm is O(n^2). Takes ca 10x longer in benchmarks.
-  //
-  // nth_element does partial sorting and take O(n) in worst case. With having if condition
-  // we are utilizing its O(log(n)) performance. With one nth_element, we get substantial error
-  // in certain edge cases if results are compared to R output.
-  //
-  // nth_element is a partial sorting algorithm that rearranges elements in [first, last) such that:
-  //
-  // The element pointed at by nth is changed to whatever element would occur in that position if [first, last) were sorted.
-  // All of the elements before this new nth element are less than or equal to the elements after the new nth element.
-  //
-  // Note: we are exploiting the fact that after the first call of nth_element,
-  // the vector is partially sorted and we only need to look at the elements
-  // before the new nth element to find the second largest value.
-  double sampleQuant;
-  if (p <= 0.5)
-  {
-    std::nth_element(vec.begin(), vec.begin()+j, vec.end(), std::less<double>());
-    // takes 100 ms
-    sampleQuant = gamma*vec[j];
-    std::nth_element(vec.begin(), vec.begin()+j-1, vec.begin()+j, std::less<double>()); // second largest value
-    sampleQuant = sampleQuant + (1.0 - gamma)*vec[j-1];
+  if(n == 0) return std::numeric_limits<double>::quiet_NaN();
+  double minVal, maxVal;
+  bool finite = getRange(vec, minVal, maxVal);
+  double width = maxVal - minVal;
+  if(!finite || !(width > 0.0) || !std::isfinite(nBins/width) || nBins < 1){
+    return getQuantile(vec, quantile);
   }
-  else
-  {
-    int idx = n*(1-p);
-    std::nth_element(vec.begin(), vec.begin()+n-j, vec.end(), std::greater<double>());
-    sampleQuant = (1.0-gamma)*vec[n-j];
-
-    std::nth_element(vec.begin(), vec.begin()+n-j-1, vec.begin()+n-j, std::greater<double>()); // second largest value
-    sampleQuant = sampleQuant + gamma*vec[n-j-1];
+  Histogram hist(vec, minVal, maxVal, nBins);
+  // An order statistic is placed inside its bin assuming that values are spread uniformly in the bin.
+  auto estimate = [&](int rank){
+    int b = hist.binOfRank(rank);
+    double inBin = (rank - hist.cumCount[b] + 0.5)/(hist.cumCount[b+1] - hist.cumCount[b]);
+    double value = minVal + (b + inBin)/hist.scale;
+    return std::min(std::max(value, minVal), maxVal);
+  };
+  int j;
+  double gamma;
+  getQuantileRank(n, quantile, j, gamma);
+  return interpolateQuantile(quantile, gamma, estimate(std::max(j-1, 0)), estimate(std::min(j, n-1)));
+}
+
+void parallelFor(int nTasks, int nThreads, const std::function<void(int)>& task){
+  if(nTasks <= 0) return;
+  nThreads = std::max(1, std::min(nThreads, nTasks));
+  if(nThreads == 1){
+    for(int i = 0; i < nTasks; i++) task(i);
+    return;
   }
-  return sampleQuant;
+  std::atomic<int> next(0);
+  std::atomic<bool> failed(false);
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  auto worker = [&](){
+    int i;
+    while(!failed && (i = next++) < nTasks){
+      try{
+        task(i);
+      } catch(...){
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if(!error) error = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  pool.reserve(nThreads-1);
+  for(int k = 1; k < nThreads; k++) pool.emplace_back(worker);
+  worker();
+  for(auto& th : pool) th.join();
+  if(error) std::rethrow_exception(error);
 }
 
-#endif
+Barrier::Barrier(int nThreads) : nThreads_(std::max(1, nThreads)), nWaiting_(0), step_(0){}
+
+void Barrier::wait(){
+  std::unique_lock<std::mutex> lock(mutex_);
+  unsigned int step = step_;
+  if(++nWaiting_ == nThreads_){
+    nWaiting_ = 0;
+    step_++;
+    cond_.notify_all();
+    return;
+  }
+  cond_.wait(lock, [&](){ return step_ != step; });
+}
 } // namespace Utils
 } // namespace DIAlign
@@ -21,6 +21,9 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 namespace DIAlign
 {
@@ -30,11 +33,62 @@ namespace Utils
   /**
    * @brief Returns the quantile of the vector
    *
+   * Quantile is calculated with the type 7 definition of R. vec is not copied, values are first counted in a histogram
+   * and only the bins that have the required order statistics are copied for selection. Hence, result is exact.
    * @param vec The vector with the values
    * @param quantile The n-th quantile to compute
    *
   */
-  double getQuantile(std::vector<double> vec, double quantile);
+  double getQuantile(const std::vector<double>& vec, double quantile);
+
+  /**
+   * @brief Returns an approximate quantile of the vector from a histogram of its values.
+   *
+   * It makes two passes over vec and does not copy it. Order statistics are interpolated within their bins,
+   * hence, the absolute error is at most (max(vec) - min(vec))/nBins.
+   * If vec has non-finite values or all values are equal, the exact getQuantile() is returned.
+   * It is used instead of getQuantile() for the gap penalty, the dotProdThresh mask and the anchor threshold if XICAlignParams::approxQuantile is set.
+   * @param vec The vector with the values
+   * @param quantile The n-th quantile to compute
+   * @param nBins Number of bins in the histogram.
+   *
+  */
+  double getApproxQuantile(const std::vector<double>& vec, double quantile, int nBins = 1024);
+
+  /**
+   * @brief Calls task(i) for i in [0, nTasks) on a pool of native threads.
+   *
+   * Tasks are handed out one at a time from a shared counter, hence, tasks of uneven cost are balanced.
+   * The calling thread is one of the workers. With nThreads <= 1 tasks are run in order on the calling thread.
+   * task must not call R API. If a task throws, the remaining tasks are skipped and the first exception is rethrown
+   * after all threads are joined.
+   * @param nTasks Number of tasks.
+   * @param nThreads Maximum number of threads, including the calling thread.
+   * @param task Function called with the task index.
+   *
+  */
+  void parallelFor(int nTasks, int nThreads, const std::function<void(int)>& task);
+
+  /**
+   * @brief Blocks threads until all nThreads of them have called wait().
+   *
+   * It can be reused, hence, workers of parallelFor() that are started once can be synchronized after each step.
+   * Every worker must call wait() the same number of times, otherwise, the others are blocked forever.
+   *
+  */
+  class Barrier
+  {
+  public:
+    explicit Barrier(int nThreads);
+    /// Returns once all threads have reached this step.
+    void wait();
+  private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    int nThreads_;
+    int nWaiting_;
+    unsigned int step_;
+  };
 } // namespace Utils
 } // namespace DIAlign
 